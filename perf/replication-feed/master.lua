@@ -0,0 +1,89 @@
+#!/usr/bin/env tarantool
+
+-- An instance file for the master. It starts the replicas and then
+-- measures the commit rate while they replicate everything it writes.
+
+local feed_size = tonumber(arg[1]) or 0
+local replica_count = tonumber(arg[2]) or 4
+
+local fiber = require('fiber')
+local fio = require('fio')
+
+-- The replicas are started from here, box.cfg changes the directory.
+local dir = fio.cwd()
+
+box.cfg{
+    listen = 3301,
+    replication_feed_size = feed_size,
+    work_dir = 'master',
+    log = 'master.log',
+}
+
+box.schema.user.grant('guest', 'replication', nil, nil, {if_not_exists = true})
+box.schema.space.create('test', {if_not_exists = true})
+box.space.test:create_index('pk', {if_not_exists = true})
+
+for i = 1, replica_count do
+    os.execute(('cd %s && ./replica.lua %d'):format(dir, i))
+end
+while #box.info.replication < replica_count + 1 do
+    fiber.sleep(0.1)
+end
+
+local function replace_func(from, num_iters)
+    for i = from, from + num_iters - 1 do
+        box.space.test:replace{i, i}
+    end
+end
+
+local function wait_replicas()
+    local lag = 0
+    for _, r in pairs(box.info.replication) do
+        if r.downstream ~= nil then
+            while r.downstream.vclock == nil or
+                  (r.downstream.vclock[box.info.id] or 0) < box.info.lsn do
+                fiber.sleep(0.001)
+                r = box.info.replication[r.id]
+            end
+            lag = math.max(lag, r.downstream.lag or 0)
+        end
+    end
+    return lag
+end
+
+local function test(num_fibers)
+    local fibers = {}
+    local num_replaces = 1e6
+    local num_iters = num_replaces / num_fibers
+    local start = fiber.time()
+    for i = 1, num_fibers do
+        local fib = fiber.new(replace_func, (i - 1) * num_iters, num_iters)
+        fib:set_joinable(true)
+        table.insert(fibers, fib)
+    end
+    for _, fib in pairs(fibers) do
+        fib:join()
+    end
+    local dt = fiber.time() - start
+    return dt, num_replaces / dt, wait_replicas()
+end
+
+local mean_rps = 0
+local mean_lag = 0
+local num_iters = 10
+for test_iter = 1, num_iters do
+    local time, rps, lag = test(100)
+    print(('Iteration #%d finished in %f seconds. RPS: %f, lag: %f'):format(
+          test_iter, time, rps, lag))
+    mean_rps = mean_rps + rps / num_iters
+    mean_lag = mean_lag + lag / num_iters
+end
+print(('replication_feed_size = %d, mean RPS: %f, mean lag: %f'):format(
+      feed_size, mean_rps, mean_lag))
+for _, r in pairs(box.info.replication) do
+    if r.downstream ~= nil and r.downstream.feed ~= nil then
+        print(('Replica %d feed hits: %d, misses: %d'):format(
+              r.id, r.downstream.feed.hits, r.downstream.feed.misses))
+    end
+end
+os.exit()
@@ -0,0 +1,16 @@
+#!/usr/bin/env tarantool
+
+-- Instance file for a replica. It only follows the master.
+
+local id = tonumber(arg[1])
+assert(id ~= nil, 'Please pass a numeric replica number')
+
+box.cfg{
+    listen = 3301 + id,
+    replication = {3301},
+    read_only = true,
+    background = true,
+    work_dir = 'replica' .. id,
+    pid_file = 'replica.pid',
+    log = 'replica.log',
+}
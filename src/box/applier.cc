@@ -121,6 +121,7 @@ applier_log_error(struct applier *applier, struct error *e)
 	case ER_NO_SUCH_USER:
 	case ER_SYSTEM:
 	case ER_SSL:
+	case ER_DECOMPRESSION:
 	case ER_UNKNOWN_REPLICA:
 	case ER_PASSWORD_MISMATCH:
 	case ER_XLOG_GAP:
@@ -555,6 +556,8 @@ applier_fetch_snapshot(struct applier *applier)
 
 struct applier_read_ctx {
 	struct ibuf *ibuf;
+	/** Decompression context if the stream is compressed. */
+	ZSTD_DStream *zstd;
 	struct applier_tx_row *(*alloc_row)(struct applier *);
 	void (*save_body)(struct applier *, struct xrow_header *);
 };
@@ -655,6 +658,7 @@ applier_wait_register(struct applier *applier, uint64_t row_count)
 
 	const struct applier_read_ctx ctx = {
 		.ibuf = &applier->ibuf,
+		.zstd = NULL,
 		.alloc_row = tx_alloc_row,
 		.save_body = tx_save_body,
 	};
@@ -751,6 +755,76 @@ applier_join(struct applier *applier)
 	applier_set_state(applier, APPLIER_READY);
 }
 
+/**
+ * Make sure there are at least @a count bytes of the decompressed
+ * replication stream in @a in, reading compressed data from the
+ * socket as needed.
+ */
+static void
+applier_zstd_breadn(struct applier *applier, struct ibuf *in, size_t count,
+		    ev_tstamp timeout)
+{
+	ZSTD_DStream *zstd = applier->thread.zstd;
+	struct ibuf *zbuf = &applier->thread.zstd_ibuf;
+	ev_tstamp start, delay;
+	coio_timeout_init(&start, &delay, timeout);
+	/* Set if zstd may hold decompressed data it had no room for. */
+	bool has_pending = false;
+	while (ibuf_used(in) < count) {
+		if (ibuf_used(zbuf) == 0 && !has_pending) {
+			ibuf_reset(zbuf);
+			coio_breadn_timeout(&applier->io, zbuf, 1, delay);
+			coio_timeout_update(&start, &delay);
+		}
+		size_t size = MAX(count - ibuf_used(in), ZSTD_DStreamOutSize());
+		void *dst = ibuf_reserve_xc(in, size);
+		ZSTD_inBuffer zin = {zbuf->rpos, ibuf_used(zbuf), 0};
+		ZSTD_outBuffer zout = {dst, size, 0};
+		size_t rc = ZSTD_decompressStream(zstd, &zout, &zin);
+		if (ZSTD_isError(rc)) {
+			tnt_raise(ClientError, ER_DECOMPRESSION,
+				  ZSTD_getErrorName(rc));
+		}
+		zbuf->rpos += zin.pos;
+		in->wpos += zout.pos;
+		has_pending = zout.pos == zout.size;
+	}
+}
+
+/**
+ * Same as coio_read_xrow_timeout_xc(), but for a compressed
+ * replication stream.
+ */
+static void
+applier_read_zstd_xrow(struct applier *applier, struct ibuf *in,
+		       struct xrow_header *row, ev_tstamp timeout)
+{
+	ev_tstamp start, delay;
+	coio_timeout_init(&start, &delay, timeout);
+	/* Read fixed header */
+	applier_zstd_breadn(applier, in, 1, delay);
+	coio_timeout_update(&start, &delay);
+
+	/* Read length */
+	if (mp_typeof(*in->rpos) != MP_UINT) {
+		tnt_raise(ClientError, ER_INVALID_MSGPACK,
+			  "packet length");
+	}
+	ssize_t to_read = mp_check_uint(in->rpos, in->wpos);
+	if (to_read > 0)
+		applier_zstd_breadn(applier, in, ibuf_used(in) + to_read,
+				    delay);
+	coio_timeout_update(&start, &delay);
+
+	uint32_t len = mp_decode_uint((const char **)&in->rpos);
+
+	/* Read header and body */
+	applier_zstd_breadn(applier, in, len, delay);
+
+	xrow_header_decode_xc(row, (const char **)&in->rpos, in->rpos + len,
+			      true);
+}
+
 static struct applier_tx_row *
 applier_read_tx_row(struct applier *applier, const struct applier_read_ctx *ctx,
 		    double timeout)
@@ -761,7 +835,10 @@ applier_read_tx_row(struct applier *applier, const struct applier_read_ctx *ctx,
 
 	ERROR_INJECT_YIELD(ERRINJ_APPLIER_READ_TX_ROW_DELAY);
 
-	coio_read_xrow_timeout_xc(io, ctx->ibuf, row, timeout);
+	if (ctx->zstd != NULL)
+		applier_read_zstd_xrow(applier, ctx->ibuf, row, timeout);
+	else
+		coio_read_xrow_timeout_xc(io, ctx->ibuf, row, timeout);
 
 	if (row->tm > 0)
 		applier->lag = ev_now(loop()) - row->tm;
@@ -1652,6 +1729,7 @@ applier_thread_reader_f(va_list ap)
 	struct lsregion *lsr = &applier->thread.lsr;
 	const struct applier_read_ctx ctx = {
 		.ibuf = &applier->thread.ibuf,
+		.zstd = applier->thread.zstd,
 		.alloc_row = thread_alloc_row,
 		.save_body = thread_save_body,
 	};
@@ -1785,13 +1863,18 @@ static void
 applier_thread_ibuf_init(struct applier *applier)
 {
 	ibuf_create(&applier->thread.ibuf, &cord()->slabc, 1024);
+	struct ibuf *ibuf = &applier->thread.ibuf;
+	if (applier->thread.zstd != NULL) {
+		ibuf_create(&applier->thread.zstd_ibuf, &cord()->slabc, 1024);
+		ibuf = &applier->thread.zstd_ibuf;
+	}
 	/*
 	 * Move unparsed data, if any, from the previously used tx ibuf to the
-	 * new buf.
+	 * new buf. If the stream is compressed, the data is compressed, too.
 	 */
 	size_t parse_size = ibuf_used(&applier->ibuf);
 	if (parse_size > 0)
-		ibuf_move_tail(&applier->ibuf, &applier->thread.ibuf, parse_size);
+		ibuf_move_tail(&applier->ibuf, ibuf, parse_size);
 }
 
 /** Initialize applier thread messages. */
@@ -1862,6 +1945,11 @@ applier_thread_detach_applier(struct cbus_call_msg *base)
 	fiber_cancel(applier->thread.reader);
 	fiber_join(applier->thread.reader);
 	applier->thread.reader = NULL;
+	if (applier->thread.zstd != NULL) {
+		ZSTD_freeDStream(applier->thread.zstd);
+		applier->thread.zstd = NULL;
+		ibuf_destroy(&applier->thread.zstd_ibuf);
+	}
 	lsregion_destroy(&applier->thread.lsr);
 	fiber_cond_destroy(&applier->thread.writer_cond);
 	return 0;
@@ -1973,8 +2061,15 @@ applier_subscribe(struct applier *applier)
 	 */
 	uint32_t id_filter = box_is_orphan() ? 0 : 1 << instance_id;
 	xrow_encode_subscribe_xc(&row, &REPLICASET_UUID, &INSTANCE_UUID,
-				 &vclock, replication_anon, id_filter);
+				 &vclock, replication_anon, id_filter,
+				 replication_compression ?
+				 IPROTO_COMPRESSION_ZSTD :
+				 IPROTO_COMPRESSION_NONE,
+				 replication_spaces, replication_space_count);
 	coio_write_xrow(io, &row);
+	if (replication_space_count > 0)
+		replication_spaces_are_used = true;
+	applier->compression = IPROTO_COMPRESSION_NONE;
 
 	/* Read SUBSCRIBE response */
 	if (applier->version_id >= version_id(1, 6, 7)) {
@@ -1994,7 +2089,8 @@ applier_subscribe(struct applier *applier)
 		 * its and master's cluster ids match.
 		 */
 		xrow_decode_subscribe_response_xc(&row, &cluster_id,
-					&applier->remote_vclock_at_subscribe);
+					&applier->remote_vclock_at_subscribe,
+					&applier->compression);
 		applier->instance_id = row.replica_id;
 		/*
 		 * If master didn't send us its cluster id
@@ -2046,6 +2142,24 @@ applier_subscribe(struct applier *applier)
 	applier->last_logged_errcode = 0;
 	applier->lag = TIMEOUT_INFINITY;
 
+	/*
+	 * Everything the master sends after the response is a zstd
+	 * stream, decompressed in the applier thread.
+	 */
+	applier->thread.zstd = NULL;
+	if (applier->compression == IPROTO_COMPRESSION_ZSTD) {
+		say_info("replication stream is compressed");
+		applier->thread.zstd = ZSTD_createDStream();
+		if (applier->thread.zstd == NULL) {
+			tnt_raise(OutOfMemory, 0, "ZSTD_createDStream",
+				  "zstd");
+		}
+		ZSTD_initDStream(applier->thread.zstd);
+	} else if (applier->compression != IPROTO_COMPRESSION_NONE) {
+		tnt_raise(ClientError, ER_PROTOCOL,
+			  "Unknown replication stream compression");
+	}
+
 	/** Attach the applier to a thread. */
 	struct applier_thread *thread = applier_thread_next();
 	if (applier_thread_data_create(applier, thread) != 0)
@@ -2204,6 +2318,16 @@ applier_f(va_list ap)
 				applier_log_error(applier, e);
 				applier_disconnect(applier, APPLIER_DISCONNECTED);
 				goto reconnect;
+			} else if (e->errcode() == ER_DECOMPRESSION) {
+				/*
+				 * The compressed replication stream is
+				 * broken, e.g. the master failed before its
+				 * relay started and wrote the error as is.
+				 * A new connection starts a new stream.
+				 */
+				applier_log_error(applier, e);
+				applier_disconnect(applier, APPLIER_DISCONNECTED);
+				goto reconnect;
 			} else {
 				/* Unrecoverable errors */
 				applier_log_error(applier, e);
@@ -36,6 +36,7 @@
 #include <tarantool_ev.h>
 
 #include <small/ibuf.h>
+#include <zstd.h>
 
 #include "fiber_cond.h"
 #include "iostream.h"
@@ -185,6 +186,11 @@ struct applier {
 	struct diag diag;
 	/* Master's vclock at the time of SUBSCRIBE. */
 	struct vclock remote_vclock_at_subscribe;
+	/**
+	 * Compression of the stream received from the master, agreed
+	 * upon on SUBSCRIBE. See enum iproto_compression.
+	 */
+	uint8_t compression;
 	/** A pointer to the thread handling this applier's data stream. */
 	struct applier_thread *applier_thread;
 	/**
@@ -221,6 +227,16 @@ struct applier {
 		struct applier_data_msg msgs[2];
 		/** The input buffer used in thread to read rows. */
 		struct ibuf ibuf;
+		/**
+		 * zstd context decompressing the stream received from
+		 * the master, NULL if the stream isn't compressed.
+		 */
+		ZSTD_DStream *zstd;
+		/**
+		 * Compressed data read from the socket and not yet
+		 * decompressed into ibuf. Used only if zstd is set.
+		 */
+		struct ibuf zstd_ibuf;
 		/** The lsregion for allocating rows in thread. */
 		struct lsregion lsr;
 		/** A growing identifier to track lsregion allocations. */
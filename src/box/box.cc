@@ -42,6 +42,7 @@
 #include "recovery.h"
 #include "wal.h"
 #include "relay.h"
+#include "relay_feed.h"
 #include "applier.h"
 #include <rmean.h>
 #include "main.h"
@@ -896,6 +897,68 @@ box_check_replication_threads(void)
 	return 0;
 }
 
+static int64_t
+box_check_replication_feed_size(void)
+{
+	int64_t size = cfg_geti64("replication_feed_size");
+	if (size < 0) {
+		diag_set(ClientError, ER_CFG, "replication_feed_size",
+			 "the value must be greater than or equal to 0");
+		return -1;
+	}
+	return size;
+}
+
+static int
+box_check_replication_relay_threads(void)
+{
+	int count = cfg_geti("replication_relay_threads");
+	if (count < 0 || count > REPLICATION_THREADS_MAX) {
+		diag_set(ClientError, ER_CFG, "replication_relay_threads",
+			 tt_sprintf("must be greater than or equal to 0, less "
+				    "than or equal to %d",
+				    REPLICATION_THREADS_MAX));
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * Check box.cfg.replication_spaces. If ids is not NULL, store the
+ * space ids there. The array must fit as many ids as there are
+ * elements in the option.
+ */
+static int
+box_check_replication_spaces(uint32_t *ids)
+{
+	int count = cfg_getarr_size("replication_spaces");
+	for (int i = 0; i < count; i++) {
+		const char *str = cfg_getarr_elem("replication_spaces", i);
+		char *end = NULL;
+		long long id = str != NULL ? strtoll(str, &end, 10) : 0;
+		if (str == NULL || *end != '\0' || id <= 0 ||
+		    id > BOX_SPACE_MAX) {
+			diag_set(ClientError, ER_CFG, "replication_spaces",
+				 "must be a space id or an array of space ids");
+			return -1;
+		}
+		if (ids != NULL)
+			ids[i] = id;
+	}
+	/*
+	 * A replica that filters rows out must never serve them or
+	 * be replicated from, and the filter isn't persisted, so it
+	 * may be set only on a read-only replica unknown to others.
+	 */
+	if (count > 0 && cfg_geti("replication_anon") == 0) {
+		diag_set(ClientError, ER_CFG, "replication_spaces",
+			 "the value may be set only when replication_anon "
+			 "is true");
+		return -1;
+	}
+	return 0;
+}
+
 static int
 box_check_listen(void)
 {
@@ -1121,6 +1184,11 @@ box_check_replication_anon(void)
 			  "the value may be set to true only when "
 			  "the instance is read-only");
 	}
+	if (!anon && cfg_getarr_size("replication_spaces") > 0) {
+		tnt_raise(ClientError, ER_CFG, "replication_anon",
+			  "the value may be set to false only when "
+			  "replication_spaces is empty");
+	}
 	return anon;
 }
 
@@ -1160,6 +1228,67 @@ box_check_wal_queue_max_size(void)
 	return size;
 }
 
+static double
+box_check_wal_group_commit_max_delay(void)
+{
+	double delay = cfg_getd("wal_group_commit_max_delay");
+	if (delay < 0) {
+		diag_set(ClientError, ER_CFG, "wal_group_commit_max_delay",
+			 "the value must not be less than zero");
+		return -1;
+	}
+	return delay;
+}
+
+static int
+box_check_wal_compression_threads(void)
+{
+	int count = cfg_geti("wal_compression_threads");
+	if (count < 0 || count > XLOG_COMPRESSOR_THREADS_MAX) {
+		diag_set(ClientError, ER_CFG, "wal_compression_threads",
+			 tt_sprintf("must be >= 0 and <= %d",
+				    XLOG_COMPRESSOR_THREADS_MAX));
+		return -1;
+	}
+	return count;
+}
+
+static double
+box_check_wal_fsync_interval(void)
+{
+	double interval = cfg_getd("wal_fsync_interval");
+	if (interval < 0) {
+		diag_set(ClientError, ER_CFG, "wal_fsync_interval",
+			 "the value must not be less than zero");
+		return -1;
+	}
+	return interval;
+}
+
+static int64_t
+box_check_wal_fsync_bytes(void)
+{
+	int64_t bytes = cfg_geti64("wal_fsync_bytes");
+	if (bytes < 0) {
+		diag_set(ClientError, ER_CFG, "wal_fsync_bytes",
+			 "the value must not be less than zero");
+		return -1;
+	}
+	return bytes;
+}
+
+static int
+box_check_memtx_checkpoint_threads(void)
+{
+	int count = cfg_geti("memtx_checkpoint_threads");
+	if (count < 1) {
+		diag_set(ClientError, ER_CFG, "memtx_checkpoint_threads",
+			 "must be greater than or equal to 1");
+		return -1;
+	}
+	return count;
+}
+
 static double
 box_check_wal_cleanup_delay(void)
 {
@@ -1184,6 +1313,54 @@ box_check_readahead(int readahead)
 	}
 }
 
+static int64_t
+box_check_iproto_compression_threshold(void)
+{
+	int64_t threshold = cfg_geti64("iproto_compression_threshold");
+	if (threshold < 0 || threshold > UINT32_MAX) {
+		diag_set(ClientError, ER_CFG, "iproto_compression_threshold",
+			 "the value must be >= 0 and <= 4294967295");
+		return -1;
+	}
+	return threshold;
+}
+
+static int64_t
+box_check_iproto_max_decompressed_size(void)
+{
+	int64_t size = cfg_geti64("iproto_max_decompressed_size");
+	if (size <= 0 || size > UINT32_MAX) {
+		diag_set(ClientError, ER_CFG, "iproto_max_decompressed_size",
+			 "the value must be > 0 and <= 4294967295");
+		return -1;
+	}
+	return size;
+}
+
+static int
+box_check_iproto_connection_msg_max(void)
+{
+	int msg_max = cfg_geti("iproto_connection_msg_max");
+	if (msg_max < 0) {
+		diag_set(ClientError, ER_CFG, "iproto_connection_msg_max",
+			 "the value must not be less than zero");
+		return -1;
+	}
+	return msg_max;
+}
+
+static double
+box_check_iproto_queue_delay_target(void)
+{
+	double target = cfg_getd("iproto_queue_delay_target");
+	if (target < 0) {
+		diag_set(ClientError, ER_CFG, "iproto_queue_delay_target",
+			 "the value must not be less than zero");
+		return -1;
+	}
+	return target;
+}
+
 static void
 box_check_checkpoint_count(int checkpoint_count)
 {
@@ -1394,18 +1571,42 @@ box_check_config(void)
 		diag_raise();
 	if (box_check_replication_threads() < 0)
 		diag_raise();
+	if (box_check_replication_spaces(NULL) != 0)
+		diag_raise();
+	if (box_check_replication_relay_threads() < 0)
+		diag_raise();
+	if (box_check_replication_feed_size() < 0)
+		diag_raise();
 	box_check_replication_sync_timeout();
 	box_check_readahead(cfg_geti("readahead"));
+	if (box_check_iproto_compression_threshold() < 0)
+		diag_raise();
+	if (box_check_iproto_max_decompressed_size() < 0)
+		diag_raise();
+	if (box_check_iproto_connection_msg_max() < 0)
+		diag_raise();
+	if (box_check_iproto_queue_delay_target() < 0)
+		diag_raise();
 	box_check_checkpoint_count(cfg_geti("checkpoint_count"));
 	box_check_wal_max_size(cfg_geti64("wal_max_size"));
 	box_check_wal_mode(cfg_gets("wal_mode"));
 	if (box_check_wal_queue_max_size() < 0)
 		diag_raise();
+	if (box_check_wal_group_commit_max_delay() < 0)
+		diag_raise();
+	if (box_check_wal_compression_threads() < 0)
+		diag_raise();
+	if (box_check_wal_fsync_interval() < 0)
+		diag_raise();
+	if (box_check_wal_fsync_bytes() < 0)
+		diag_raise();
 	if (box_check_wal_cleanup_delay() < 0)
 		diag_raise();
 	if (box_check_memory_quota("memtx_memory") < 0)
 		diag_raise();
 	box_check_memtx_min_tuple_size(cfg_geti64("memtx_min_tuple_size"));
+	if (box_check_memtx_checkpoint_threads() < 0)
+		diag_raise();
 	if (box_check_allocator() != 0)
 		diag_raise();
 	box_check_small_alloc_options();
@@ -1625,6 +1826,63 @@ box_set_replication_skip_conflict(void)
 	replication_skip_conflict = cfg_geti("replication_skip_conflict");
 }
 
+void
+box_set_replication_compression(void)
+{
+	replication_compression = cfg_getb("replication_compression");
+}
+
+int
+box_set_replication_feed_size(void)
+{
+	int64_t size = box_check_replication_feed_size();
+	if (size < 0)
+		return -1;
+	relay_feed_set_size(size);
+	return 0;
+}
+
+int
+box_set_replication_spaces(void)
+{
+	int count = cfg_getarr_size("replication_spaces");
+	uint32_t *ids = NULL;
+	if (count > 0)
+		ids = (uint32_t *)xcalloc(count, sizeof(*ids));
+	if (box_check_replication_spaces(ids) != 0) {
+		free(ids);
+		return -1;
+	}
+	/*
+	 * Rows of the spaces filtered out were received as NOPs,
+	 * so they can't be replicated again without a rebootstrap:
+	 * the replica would silently diverge from the master.
+	 */
+	if (replication_spaces_are_used) {
+		bool is_subset = count > 0;
+		for (int i = 0; i < count && is_subset; i++) {
+			is_subset = false;
+			for (uint32_t j = 0; j < replication_space_count; j++) {
+				if (ids[i] == replication_spaces[j]) {
+					is_subset = true;
+					break;
+				}
+			}
+		}
+		if (!is_subset) {
+			diag_set(ClientError, ER_CFG, "replication_spaces",
+				 "can't replicate spaces that were filtered "
+				 "out, rebootstrap the replica");
+			free(ids);
+			return -1;
+		}
+	}
+	free(replication_spaces);
+	replication_spaces = ids;
+	replication_space_count = count;
+	return 0;
+}
+
 void
 box_set_replication_anon(void)
 {
@@ -2149,6 +2407,18 @@ box_set_memtx_max_tuple_size(void)
 			cfg_geti("memtx_max_tuple_size"));
 }
 
+void
+box_set_memtx_checkpoint_threads(void)
+{
+	int count = box_check_memtx_checkpoint_threads();
+	if (count < 0)
+		diag_raise();
+	struct memtx_engine *memtx;
+	memtx = (struct memtx_engine *)engine_by_name("memtx");
+	assert(memtx != NULL);
+	memtx_engine_set_checkpoint_threads(memtx, count);
+}
+
 void
 box_set_too_long_threshold(void)
 {
@@ -2167,6 +2437,46 @@ box_set_readahead(void)
 	iproto_readahead = readahead;
 }
 
+int
+box_set_iproto_compression_threshold(void)
+{
+	int64_t threshold = box_check_iproto_compression_threshold();
+	if (threshold < 0)
+		return -1;
+	iproto_compression_threshold = threshold;
+	return 0;
+}
+
+int
+box_set_iproto_max_decompressed_size(void)
+{
+	int64_t size = box_check_iproto_max_decompressed_size();
+	if (size < 0)
+		return -1;
+	iproto_max_decompressed_size = size;
+	return 0;
+}
+
+int
+box_set_iproto_connection_msg_max(void)
+{
+	int msg_max = box_check_iproto_connection_msg_max();
+	if (msg_max < 0)
+		return -1;
+	iproto_connection_msg_max = msg_max;
+	return 0;
+}
+
+int
+box_set_iproto_queue_delay_target(void)
+{
+	double target = box_check_iproto_queue_delay_target();
+	if (target < 0)
+		return -1;
+	iproto_queue_delay_target = target;
+	return 0;
+}
+
 void
 box_set_checkpoint_count(void)
 {
@@ -2199,6 +2509,29 @@ box_set_wal_queue_max_size(void)
 	return 0;
 }
 
+int
+box_set_wal_group_commit_max_delay(void)
+{
+	double delay = box_check_wal_group_commit_max_delay();
+	if (delay < 0)
+		return -1;
+	wal_set_group_commit_max_delay(delay);
+	return 0;
+}
+
+int
+box_set_wal_fsync(void)
+{
+	double interval = box_check_wal_fsync_interval();
+	if (interval < 0)
+		return -1;
+	int64_t bytes = box_check_wal_fsync_bytes();
+	if (bytes < 0)
+		return -1;
+	wal_set_fsync(interval, bytes);
+	return 0;
+}
+
 int
 box_set_wal_cleanup_delay(void)
 {
@@ -2472,11 +2805,117 @@ box_process1(struct request *request, box_tuple_t **result)
 	return box_process_rw(request, space, result);
 }
 
+/**
+ * Check that iterator positions can be used with the given index
+ * and iterator type. A position is the key of a tuple by the
+ * index comparison definition (i.e. the index key extended with
+ * the primary key parts), so it is only supported by ordered
+ * indexes with one key per tuple.
+ */
+static int
+box_check_iterator_position_support(struct index *index,
+				    enum iterator_type type)
+{
+	struct key_def *key_def = index->def->key_def;
+	if (index->def->type != TREE || key_def->is_multikey ||
+	    key_def->for_func_index) {
+		diag_set(ClientError, ER_UNSUPPORTED,
+			 tt_sprintf("Index '%s'", index->def->name),
+			 "iterator position");
+		return -1;
+	}
+	if (type > ITER_GT) {
+		diag_set(ClientError, ER_UNSUPPORTED,
+			 tt_sprintf("Iterator type %s",
+				    iterator_type_strs[type]),
+			 "iterator position");
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * Check that @a pos is a valid position in @a index and that the
+ * tuple it points to satisfies the search condition given by
+ * @a type and @a key (key with MsgPack array header). On success
+ * @a pos_part_count is set to the number of parts in the position.
+ */
+static int
+box_check_iterator_position(struct index *index, enum iterator_type type,
+			    const char *key, uint32_t part_count,
+			    const char *pos, const char *pos_end,
+			    uint32_t *pos_part_count)
+{
+	struct key_def *cmp_def = index->def->cmp_def;
+	const char *p = pos;
+	if (mp_typeof(*p) != MP_ARRAY || mp_check(&p, pos_end) != 0 ||
+	    p != pos_end)
+		goto invalid;
+	p = pos;
+	if (mp_decode_array(&p) != cmp_def->part_count ||
+	    key_validate_parts(cmp_def, p, cmp_def->part_count, true,
+			       &p) != 0)
+		goto invalid;
+	if (part_count > 0) {
+		int cmp = key_compare(pos, HINT_NONE, key, HINT_NONE, cmp_def);
+		bool ok;
+		switch (type) {
+		case ITER_EQ:
+		case ITER_REQ:
+			ok = cmp == 0;
+			break;
+		case ITER_GE:
+			ok = cmp >= 0;
+			break;
+		case ITER_GT:
+			ok = cmp > 0;
+			break;
+		case ITER_LE:
+			ok = cmp <= 0;
+			break;
+		case ITER_LT:
+			ok = cmp < 0;
+			break;
+		default:
+			ok = true;
+			break;
+		}
+		if (!ok)
+			goto invalid;
+	}
+	*pos_part_count = cmp_def->part_count;
+	return 0;
+invalid:
+	diag_set(ClientError, ER_ITERATOR_POSITION);
+	return -1;
+}
+
+bool
+box_select_supports_position(uint32_t space_id, uint32_t index_id,
+			     int iterator)
+{
+	if (iterator < 0 || iterator >= iterator_type_MAX)
+		return false;
+	struct space *space = space_by_id(space_id);
+	if (space == NULL)
+		return false;
+	struct index *index = space_index(space, index_id);
+	if (index == NULL)
+		return false;
+	if (box_check_iterator_position_support(
+			index, (enum iterator_type)iterator) != 0) {
+		diag_clear(diag_get());
+		return false;
+	}
+	return true;
+}
+
 API_EXPORT int
 box_select(uint32_t space_id, uint32_t index_id,
 	   int iterator, uint32_t offset, uint32_t limit,
 	   const char *key, const char *key_end,
-	   struct port *port)
+	   const char **packed_pos, const char **packed_pos_end,
+	   bool update_pos, struct port *port)
 {
 	(void)key_end;
 
@@ -2504,6 +2943,19 @@ box_select(uint32_t space_id, uint32_t index_id,
 	if (key_validate(index->def, type, key, part_count))
 		return -1;
 
+	bool has_pos = packed_pos != NULL && *packed_pos != NULL &&
+		       *packed_pos != *packed_pos_end;
+	uint32_t pos_part_count = 0;
+	if (has_pos || update_pos) {
+		if (box_check_iterator_position_support(index, type) != 0)
+			return -1;
+	}
+	if (has_pos &&
+	    box_check_iterator_position(index, type, key_array, part_count,
+					*packed_pos, *packed_pos_end,
+					&pos_part_count) != 0)
+		return -1;
+
 	box_run_on_select(space, index, type, key_array);
 
 	ERROR_INJECT(ERRINJ_TESTING, {
@@ -2516,16 +2968,38 @@ box_select(uint32_t space_id, uint32_t index_id,
 	if (txn_begin_ro_stmt(space, &txn, &svp) != 0)
 		return -1;
 
-	struct iterator *it = index_create_iterator(index, type,
-						    key, part_count);
+	/*
+	 * The position points to the last tuple returned by the
+	 * previous select, so continue strictly after it in the
+	 * iteration order. The tree is descended once, instead of
+	 * skipping all the preceding tuples as OFFSET does.
+	 */
+	struct iterator *it;
+	if (has_pos) {
+		const char *pos = *packed_pos;
+		mp_decode_array(&pos);
+		it = index_create_iterator(index, iterator_type_is_reverse(type) ?
+					   ITER_LT : ITER_GT,
+					   pos, pos_part_count);
+	} else {
+		it = index_create_iterator(index, type, key, part_count);
+	}
 	if (it == NULL) {
 		txn_rollback_stmt(txn);
 		return -1;
 	}
+	/*
+	 * EQ and REQ iterators stop at the first tuple not matching
+	 * the key, so do it here, since the iterator was created from
+	 * the position.
+	 */
+	bool check_eq = has_pos && part_count > 0 &&
+			(type == ITER_EQ || type == ITER_REQ);
 
 	int rc = 0;
 	uint32_t found = 0;
 	struct tuple *tuple;
+	struct tuple *last = NULL;
 	port_c_create(port);
 	while (found < limit) {
 		struct result_processor res_proc;
@@ -2534,6 +3008,11 @@ box_select(uint32_t space_id, uint32_t index_id,
 		result_process_perform(&res_proc, &rc, &tuple);
 		if (rc != 0 || tuple == NULL)
 			break;
+		if (check_eq &&
+		    tuple_compare_with_key(tuple, HINT_NONE, key, part_count,
+					   HINT_NONE,
+					   index->def->key_def) != 0)
+			break;
 		if (offset > 0) {
 			offset--;
 			continue;
@@ -2541,6 +3020,7 @@ box_select(uint32_t space_id, uint32_t index_id,
 		rc = port_c_add_tuple(port, tuple);
 		if (rc != 0)
 			break;
+		last = tuple;
 		found++;
 		/*
 		 * Refresh the pointer to the space, because the space struct
@@ -2548,6 +3028,25 @@ box_select(uint32_t space_id, uint32_t index_id,
 		 */
 		space = iterator_space(it);
 	}
+	if (rc == 0 && update_pos && last != NULL) {
+		/*
+		 * The iterator may have yielded (vinyl), so check that
+		 * the index is still alive before using its definition.
+		 */
+		uint32_t size;
+		const char *pos = NULL;
+		if (iterator_space(it) == NULL)
+			diag_set(ClientError, ER_ITERATOR_POSITION);
+		else
+			pos = tuple_extract_key(last, index->def->cmp_def,
+						MULTIKEY_NONE, &size);
+		if (pos == NULL) {
+			rc = -1;
+		} else {
+			*packed_pos = pos;
+			*packed_pos_end = pos + size;
+		}
+	}
 	iterator_delete(it);
 
 	if (rc != 0) {
@@ -3148,9 +3647,16 @@ box_process_subscribe(struct iostream *io, const struct xrow_header *header)
 	uint32_t replica_version_id;
 	bool anon;
 	uint32_t id_filter;
+	uint8_t compression;
+	uint32_t *spaces;
+	uint32_t space_count;
 	xrow_decode_subscribe_xc(header, &peer_replicaset_uuid, &replica_uuid,
 				 &replica_clock, &replica_version_id, &anon,
-				 &id_filter);
+				 &id_filter, &compression, &spaces,
+				 &space_count);
+	/* Fall back to an uncompressed stream if we don't know the method. */
+	if (compression != IPROTO_COMPRESSION_ZSTD)
+		compression = IPROTO_COMPRESSION_NONE;
 
 	/* Forbid connection to itself */
 	if (tt_uuid_is_equal(&replica_uuid, &INSTANCE_UUID))
@@ -3233,7 +3739,8 @@ box_process_subscribe(struct iostream *io, const struct xrow_header *header)
 	 * just ignore the additional field (these are < 2.1.1).
 	 */
 	struct xrow_header row;
-	xrow_encode_subscribe_response_xc(&row, &REPLICASET_UUID, &vclock);
+	xrow_encode_subscribe_response_xc(&row, &REPLICASET_UUID, &vclock,
+					  compression);
 	/*
 	 * Identify the message with the replica id of this
 	 * instance, this is the only way for a replica to find
@@ -3260,9 +3767,18 @@ box_process_subscribe(struct iostream *io, const struct xrow_header *header)
 		 */
 		struct raft_request req;
 		box_raft_checkpoint_remote(&req);
-		xrow_encode_raft(&row, &fiber()->gc, &req);
-		coio_write_xrow(io, &row);
-		sent_raft_term = req.term;
+		if (compression != IPROTO_COMPRESSION_NONE) {
+			/*
+			 * Everything after the response must go
+			 * through the compressed stream, so let the
+			 * relay send the state before any WAL rows.
+			 */
+			relay_push_raft(replica->relay, &req);
+		} else {
+			xrow_encode_raft(&row, &fiber()->gc, &req);
+			coio_write_xrow(io, &row);
+			sent_raft_term = req.term;
+		}
 	}
 	/*
 	 * Replica clock is used in gc state and recovery
@@ -3294,7 +3810,9 @@ box_process_subscribe(struct iostream *io, const struct xrow_header *header)
 	 * indefinitely).
 	 */
 	relay_subscribe(replica, io, header->sync, &replica_clock,
-			replica_version_id, id_filter, sent_raft_term);
+			replica_version_id, id_filter, sent_raft_term,
+			(enum iproto_compression)compression, spaces,
+			space_count);
 }
 
 void
@@ -3859,7 +4377,8 @@ box_cfg_xc(void)
 	gc_init();
 	engine_init();
 	schema_init();
-	replication_init(cfg_geti_default("replication_threads", 1));
+	replication_init(cfg_geti_default("replication_threads", 1),
+			 cfg_geti_default("replication_relay_threads", 0));
 	port_init();
 	iproto_init(cfg_geti("iproto_threads"));
 	sql_init();
@@ -3868,8 +4387,12 @@ box_cfg_xc(void)
 
 	int64_t wal_max_size = box_check_wal_max_size(cfg_geti64("wal_max_size"));
 	enum wal_mode wal_mode = box_check_wal_mode(cfg_gets("wal_mode"));
+	int wal_compression_threads = box_check_wal_compression_threads();
+	if (wal_compression_threads < 0)
+		diag_raise();
 	if (wal_init(wal_mode, cfg_gets("wal_dir"), wal_max_size,
-		     &INSTANCE_UUID, on_wal_garbage_collection,
+		     wal_compression_threads, &INSTANCE_UUID,
+		     on_wal_garbage_collection,
 		     on_wal_checkpoint_threshold) != 0) {
 		diag_raise();
 	}
@@ -3884,6 +4407,14 @@ box_cfg_xc(void)
 		diag_raise();
 	box_set_net_msg_max();
 	box_set_readahead();
+	if (box_set_iproto_compression_threshold() != 0)
+		diag_raise();
+	if (box_set_iproto_max_decompressed_size() != 0)
+		diag_raise();
+	if (box_set_iproto_connection_msg_max() != 0)
+		diag_raise();
+	if (box_set_iproto_queue_delay_target() != 0)
+		diag_raise();
 	box_set_too_long_threshold();
 	box_set_replication_timeout();
 	box_set_replication_connect_timeout();
@@ -3895,6 +4426,11 @@ box_cfg_xc(void)
 		diag_raise();
 	box_set_replication_sync_timeout();
 	box_set_replication_skip_conflict();
+	box_set_replication_compression();
+	if (box_set_replication_feed_size() != 0)
+		diag_raise();
+	if (box_set_replication_spaces() != 0)
+		diag_raise();
 	box_set_replication_anon();
 
 	struct gc_checkpoint *checkpoint = gc_last_checkpoint();
@@ -251,13 +251,20 @@ void box_set_io_collect_interval(void);
 void box_set_snap_io_rate_limit(void);
 void box_set_too_long_threshold(void);
 void box_set_readahead(void);
+int box_set_iproto_compression_threshold(void);
+int box_set_iproto_max_decompressed_size(void);
+int box_set_iproto_connection_msg_max(void);
+int box_set_iproto_queue_delay_target(void);
 void box_set_checkpoint_count(void);
 void box_set_checkpoint_interval(void);
 void box_set_checkpoint_wal_threshold(void);
 int box_set_wal_queue_max_size(void);
+int box_set_wal_group_commit_max_delay(void);
+int box_set_wal_fsync(void);
 int box_set_wal_cleanup_delay(void);
 void box_set_memtx_memory(void);
 void box_set_memtx_max_tuple_size(void);
+void box_set_memtx_checkpoint_threads(void);
 void box_set_vinyl_memory(void);
 void box_set_vinyl_max_tuple_size(void);
 void box_set_vinyl_cache(void);
@@ -274,6 +281,9 @@ int box_set_replication_synchro_quorum(void);
 int box_set_replication_synchro_timeout(void);
 void box_set_replication_sync_timeout(void);
 void box_set_replication_skip_conflict(void);
+void box_set_replication_compression(void);
+int box_set_replication_feed_size(void);
+int box_set_replication_spaces(void);
 void box_set_replication_anon(void);
 void box_set_net_msg_max(void);
 int box_set_crash(void);
@@ -305,12 +315,33 @@ box_demote(void);
 int
 box_promote_qsync(void);
 
-/* box_select is private and used only by FFI */
+/**
+ * box_select is private and used only by FFI.
+ *
+ * If @a packed_pos points to a non-empty iterator position, the
+ * select starts right after the tuple at this position instead of
+ * the beginning of the range defined by @a iterator and @a key.
+ * If @a update_pos is set, the position of the last returned
+ * tuple is stored to @a packed_pos and @a packed_pos_end. It is
+ * allocated on the fiber region. If no tuples were returned, the
+ * position is left unchanged.
+ */
 API_EXPORT int
 box_select(uint32_t space_id, uint32_t index_id,
 	   int iterator, uint32_t offset, uint32_t limit,
 	   const char *key, const char *key_end,
-	   struct port *port);
+	   const char **packed_pos, const char **packed_pos_end,
+	   bool update_pos, struct port *port);
+
+/**
+ * Check if box_select() can return the position of the last
+ * returned tuple for the given index and iterator type, so that
+ * the result can be selected page by page. Returns false if the
+ * space or the index does not exist.
+ */
+bool
+box_select_supports_position(uint32_t space_id, uint32_t index_id,
+			     int iterator);
 
 /** \cond public */
 
@@ -38,10 +38,13 @@
 #include <small/ibuf.h>
 #include <small/obuf.h>
 #include <base64.h>
+#include <pmatomic.h>
+#include <zstd.h>
 
 #include "version.h"
 #include "fiber.h"
 #include "fiber_cond.h"
+#include "clock.h"
 #include "cbus.h"
 #include "say.h"
 #include "sio.h"
@@ -164,10 +167,13 @@ struct iproto_thread {
 	struct cmsg_hop select_route[2];
 	struct cmsg_hop process1_route[2];
 	struct cmsg_hop sql_route[2];
+	struct cmsg_hop batch_route[2];
 	struct cmsg_hop join_route[2];
 	struct cmsg_hop subscribe_route[2];
 	struct cmsg_hop error_route[2];
 	struct cmsg_hop push_route[2];
+	struct cmsg_hop drain_route[1];
+	struct cmsg_hop drain_end_route[1];
 	struct cmsg_hop *dml_route[IPROTO_TYPE_STAT_MAX];
 	struct cmsg_hop connect_route[2];
 	/*
@@ -190,6 +196,19 @@ struct iproto_thread {
 	uint32_t id;
 	/** Array of iproto binary listeners */
 	struct evio_service binary;
+	/**
+	 * Number of connections of this thread. It's updated by
+	 * the thread itself and read by other iproto threads to
+	 * balance new connections, hence accessed atomically.
+	 */
+	int connection_count;
+	/** True if the thread doesn't accept new connections. */
+	bool is_accept_paused;
+	/** Timer to resume accepting connections, see iproto_balance(). */
+	struct ev_timer balance_timer;
+	/** zstd contexts used for compression of iproto packets. */
+	ZSTD_CCtx *zstd_cctx;
+	ZSTD_DCtx *zstd_dctx;
 	/** Requests count currently pending in stream queue. */
 	size_t requests_in_stream_queue;
 	/**
@@ -202,11 +221,42 @@ struct iproto_thread {
 		size_t requests_in_progress;
 		/** Iproto thread stat collected in tx thread. */
 		struct rmean *rmean;
+		/**
+		 * Start of the current queue delay measurement
+		 * interval and the minimal delay seen in it.
+		 */
+		double queue_interval_start;
+		double queue_interval_min_delay;
+		/** Queue delay of the last request. */
+		double last_queue_delay;
+		/** Time the last request was accepted by tx. */
+		double last_accept_time;
+		/** Minimal queue delay over the last interval. */
+		double queue_delay;
+		/**
+		 * True if the queue delay has stayed above the
+		 * target for a whole interval. Requests delayed
+		 * longer than the target are rejected then.
+		 */
+		bool is_overloaded;
 	} tx;
 };
 
 static struct iproto_thread *iproto_threads;
 int iproto_threads_count;
+
+enum {
+	/**
+	 * An iproto thread stops accepting connections if it has
+	 * more than this number of connections above the least
+	 * loaded thread.
+	 */
+	IPROTO_BALANCE_SLACK = 1,
+};
+
+/** How often a thread that stopped accepting rechecks the load. */
+static const double IPROTO_BALANCE_PERIOD = 0.1;
+
 /**
  * This binary contains all bind socket properties, like
  * address the iproto listens for. Is kept in TX to be
@@ -255,6 +305,40 @@ struct iproto_kharon {
  */
 unsigned iproto_readahead = 16320;
 
+/**
+ * Minimal size of a response body to compress, 0 disables
+ * compression of responses. Assigned in tx thread and used
+ * in iproto threads without locks, like iproto_readahead.
+ */
+unsigned iproto_compression_threshold = 4096;
+
+/**
+ * Maximal size of a decompressed request body. The buffer for the
+ * body is allocated in advance, so without a limit a tiny frame
+ * could make an iproto thread allocate gigabytes.
+ */
+unsigned iproto_max_decompressed_size = 16 * 1024 * 1024;
+
+/**
+ * Maximal number of messages of a single connection in fly,
+ * 0 means that only net_msg_max is applied. Prevents one
+ * connection from occupying all tx fibers. Assigned in tx
+ * thread and used in iproto threads without locks.
+ */
+int iproto_connection_msg_max = 0;
+
+/**
+ * Target queue delay of requests, in seconds, 0 disables
+ * admission control. Used only in tx thread.
+ */
+double iproto_queue_delay_target = 0;
+
+/**
+ * Requests are rejected if their queue delay hasn't been below
+ * the target for at least this long, see tx_update_queue_delay().
+ */
+static const double IPROTO_QUEUE_DELAY_INTERVAL = 0.1;
+
 /* The maximal number of iproto messages in fly. */
 static int iproto_msg_max = IPROTO_MSG_MAX_MIN;
 
@@ -341,6 +425,8 @@ struct iproto_msg
 		struct sql_request sql;
 		/* BEGIN request */
 		struct begin_request begin;
+		/** BATCH request. */
+		struct batch_request batch;
 		/** In case of iproto parse error, saved diagnostics. */
 		struct diag diag;
 	};
@@ -365,6 +451,15 @@ struct iproto_msg
 	 * the buffer.
 	 */
 	const char *reqstart;
+	/** Time when the message was sent to tx. */
+	double enqueue_time;
+	/** Time the message spent in the queue to tx. */
+	double queue_delay;
+	/**
+	 * Request body decompressed in iproto thread or NULL if the
+	 * request isn't compressed. Freed with the message.
+	 */
+	char *decompressed_body;
 	/**
 	 * Position in the connection output buffer. When sending a
 	 * message to the tx thread, iproto sets it to its current
@@ -431,11 +526,13 @@ const char *rmean_net_strings[RMEAN_NET_LAST] = {
 
 enum rmean_tx_name {
 	REQUESTS_IN_PROGRESS,
+	REQUESTS_REJECTED,
 	RMEAN_TX_LAST,
 };
 
 const char *rmean_tx_strings[RMEAN_TX_LAST] = {
 	"REQUESTS_IN_PROGRESS",
+	"REQUESTS_REJECTED",
 };
 
 static void
@@ -469,6 +566,26 @@ iproto_process_push(struct cmsg *m);
 static void
 tx_end_push(struct cmsg *m);
 
+/** Notify the iproto thread about new data in the output buffer. */
+static void
+tx_push(struct iproto_connection *con);
+
+/**
+ * tx asks the iproto thread to tell when the connection output
+ * is flushed. Reply at once if it is, otherwise hold the message
+ * until it is.
+ */
+static void
+net_begin_drain(struct cmsg *m);
+
+/** The connection output is flushed. Wake up waiting fibers. */
+static void
+tx_end_drain(struct cmsg *m);
+
+/** Wait until the connection output is flushed to the socket. */
+static int
+tx_wait_drain(struct iproto_connection *con);
+
 /* }}} */
 
 /* {{{ iproto_connection - declaration and definition */
@@ -565,6 +682,31 @@ struct iproto_connection
 	 * output is available (see iproto_msg::wpos).
 	 */
 	struct iproto_wpos wend;
+	/**
+	 * If output compression is enabled, a packet with a big body
+	 * is compressed here and written to the socket from this
+	 * buffer. The other packets are written from the output
+	 * buffer as usual.
+	 */
+	struct ibuf zbuf;
+	/**
+	 * End of the packets written as is, without compression,
+	 * while the output is compressed. The packets preceding it
+	 * aren't parsed again after a partial write.
+	 */
+	struct obuf_svp zplain_end;
+	/**
+	 * Set if the client has declared IPROTO_FEATURE_COMPRESSION
+	 * in IPROTO_ID request.
+	 */
+	bool is_compression_requested;
+	/**
+	 * Set if the output is being compressed. Follows
+	 * is_compression_requested, but is switched only when
+	 * all the output has been flushed, so that the compressed
+	 * output always starts at a packet boundary.
+	 */
+	bool is_compression_enabled;
 	/*
 	 * Size of readahead which is not parsed yet, i.e. size of
 	 * a piece of request which is not fully read. Is always
@@ -583,6 +725,14 @@ struct iproto_connection
 	 * connections.
 	 */
 	int long_poll_count;
+	/** Number of messages of this connection in fly. */
+	int msg_count;
+	/**
+	 * Set if input is stopped because the connection has
+	 * reached iproto_connection_msg_max. The input is resumed
+	 * when one of its requests is finished.
+	 */
+	bool is_msg_limit_reached;
 	/** I/O stream used for communication with the client. */
 	struct iostream io;
 	struct ev_io input;
@@ -604,6 +754,14 @@ struct iproto_connection
 	 * connection.
 	 */
 	struct cmsg destroy_msg;
+	/**
+	 * Pre-allocated drain msg. Is sent by tx to wait until the
+	 * output is flushed to the socket, see tx_wait_drain(), and
+	 * is held by the iproto thread until it is.
+	 */
+	struct cmsg drain_msg;
+	/** Set if the iproto thread holds drain_msg. */
+	bool is_drain_requested;
 	/**
 	 * Connection state. Mainly it is used to determine when
 	 * the connection can be destroyed, and for debug purposes
@@ -668,6 +826,14 @@ struct iproto_connection
 		 * return.
 		 */
 		bool is_push_pending;
+		/** Number of drain requests sent to iproto. */
+		uint64_t drain_sent;
+		/** Number of drain requests returned to tx. */
+		uint64_t drain_done;
+		/** Signaled when a drain request returns to tx. */
+		struct fiber_cond drain_cond;
+		/** True if the session is closed. */
+		bool is_closed;
 	} tx;
 	/** Authentication salt. */
 	char salt[IPROTO_SALT_SIZE];
@@ -739,10 +905,24 @@ iproto_check_msg_max(struct iproto_thread *iproto_thread)
 	return request_count > (size_t) iproto_msg_max;
 }
 
+/**
+ * Return true if the connection has as many messages in fly
+ * as allowed by iproto_connection_msg_max.
+ */
+static inline bool
+iproto_connection_check_msg_max(struct iproto_connection *con)
+{
+	int msg_max = iproto_connection_msg_max;
+	return msg_max > 0 && con->msg_count >= msg_max;
+}
+
 static inline void
 iproto_msg_delete(struct iproto_msg *msg)
 {
 	struct iproto_thread *iproto_thread = msg->connection->iproto_thread;
+	assert(msg->connection->msg_count > 0);
+	msg->connection->msg_count--;
+	free(msg->decompressed_body);
 	mempool_free(&msg->connection->iproto_thread->iproto_msg_pool, msg);
 	iproto_resume(iproto_thread);
 }
@@ -775,6 +955,8 @@ iproto_msg_new(struct iproto_connection *con)
 	msg->close_connection = false;
 	msg->connection = con;
 	msg->stream = NULL;
+	msg->decompressed_body = NULL;
+	con->msg_count++;
 	rmean_collect(con->iproto_thread->rmean, IPROTO_REQUESTS, 1);
 	return msg;
 }
@@ -864,6 +1046,23 @@ iproto_connection_stop_msg_max_limit(struct iproto_connection *con)
 		       &con->in_stop_list);
 }
 
+/**
+ * Stop input when the connection has too many messages in fly.
+ * Unlike the net_msg_max limit, the connection is not queued for
+ * resumption: it is resumed when one of its own requests is done,
+ * see iproto_connection_resume_msg_limit().
+ */
+static inline void
+iproto_connection_stop_connection_msg_max_limit(struct iproto_connection *con)
+{
+	assert(rlist_empty(&con->in_stop_list));
+	say_warn_ratelimited("stopping input on connection %s, "
+			     "iproto_connection_msg_max limit is reached",
+			     iproto_connection_name(con));
+	ev_io_stop(con->loop, &con->input);
+	con->is_msg_limit_reached = true;
+}
+
 /**
  * Send a destroy message to TX thread in case all requests are
  * finished.
@@ -893,6 +1092,20 @@ iproto_connection_try_to_start_destroy(struct iproto_connection *con)
 	cpipe_push(&con->iproto_thread->tx_pipe, &con->destroy_msg);
 }
 
+/**
+ * Return the drain message to tx if it is held by the iproto
+ * thread, see net_begin_drain().
+ */
+static void
+iproto_connection_end_drain(struct iproto_connection *con)
+{
+	if (!con->is_drain_requested)
+		return;
+	con->is_drain_requested = false;
+	cmsg_init(&con->drain_msg, con->iproto_thread->drain_end_route);
+	cpipe_push(&con->iproto_thread->tx_pipe, &con->drain_msg);
+}
+
 /**
  * Initiate a connection shutdown. This method may
  * be invoked many times, and does the internal
@@ -934,6 +1147,8 @@ iproto_connection_close(struct iproto_connection *con)
 			    stailq_empty(&stream->pending_requests))
 				iproto_stream_rollback_on_disconnect(stream);
 		}
+		/* The output is never going to be flushed. */
+		iproto_connection_end_drain(con);
 		cpipe_push(&con->iproto_thread->tx_pipe, &con->disconnect_msg);
 		assert(con->state == IPROTO_CONNECTION_ALIVE);
 		con->state = IPROTO_CONNECTION_CLOSED;
@@ -1116,6 +1331,11 @@ iproto_enqueue_batch(struct iproto_connection *con, struct ibuf *in)
 			cpipe_flush_input(&con->iproto_thread->tx_pipe);
 			return 0;
 		}
+		if (iproto_connection_check_msg_max(con)) {
+			iproto_connection_stop_connection_msg_max_limit(con);
+			cpipe_flush_input(&con->iproto_thread->tx_pipe);
+			return 0;
+		}
 		const char *reqstart = in->wpos - con->parse_size;
 		const char *pos = reqstart;
 		/* Read request length. */
@@ -1170,6 +1390,7 @@ err_msgpack:
 			 * This can't throw, but should not be
 			 * done in case of exception.
 			 */
+			msg->enqueue_time = clock_monotonic();
 			cpipe_push_input(&con->iproto_thread->tx_pipe, &msg->base);
 			n_requests++;
 		}
@@ -1236,6 +1457,29 @@ iproto_connection_resume(struct iproto_connection *con)
 	}
 }
 
+/**
+ * Resume a connection stopped by iproto_connection_msg_max limit
+ * if it has got a spare message. If the connection is stopped by
+ * net_msg_max too, it is left to iproto_resume().
+ */
+static void
+iproto_connection_resume_msg_limit(struct iproto_connection *con)
+{
+	if (!con->is_msg_limit_reached ||
+	    con->state != IPROTO_CONNECTION_ALIVE ||
+	    iproto_connection_check_msg_max(con))
+		return;
+	con->is_msg_limit_reached = false;
+	if (!rlist_empty(&con->in_stop_list))
+		return;
+	if (iproto_enqueue_batch(con, con->p_ibuf) != 0) {
+		struct error *e = box_error_last();
+		error_log(e);
+		iproto_write_error(&con->io, e, ::schema_version, 0);
+		iproto_connection_close(con);
+	}
+}
+
 /**
  * Resume as many connections as possible until a request limit is
  * reached. By design of iproto_enqueue_batch(), a paused
@@ -1281,6 +1525,10 @@ iproto_connection_on_input(ev_loop *loop, struct ev_io *watcher,
 		iproto_connection_stop_msg_max_limit(con);
 		return;
 	}
+	if (iproto_connection_check_msg_max(con)) {
+		iproto_connection_stop_connection_msg_max_limit(con);
+		return;
+	}
 
 	try {
 		/* Ensure we have sufficient space for the next round.  */
@@ -1324,35 +1572,233 @@ iproto_connection_on_input(ev_loop *loop, struct ev_io *watcher,
 	}
 }
 
-/** writev() to the socket and handle the result. */
-static int
-iproto_flush(struct iproto_connection *con)
+enum {
+	/** Size of the packet length, always encoded as MP_UINT32. */
+	IPROTO_FIXHEADER_SIZE = 5,
+	/**
+	 * Max growth of a packet when its body is compressed: map
+	 * header growth (4), IPROTO_COMPRESSION key and value (2),
+	 * MP_BIN header of the body (5).
+	 */
+	IPROTO_COMPRESSION_OVERHEAD_MAX = 11,
+	/**
+	 * zstd level used for iproto packets: the fastest one, we
+	 * don't want to stall other connections of the thread.
+	 */
+	IPROTO_COMPRESSION_LEVEL = 1,
+	/**
+	 * Maximal size of a packet body to compress. The compressed
+	 * body is buffered until it's written, so the limit bounds
+	 * the memory used by a connection for compression. It's also
+	 * well below the size net.box is able to decompress.
+	 */
+	IPROTO_COMPRESSION_BODY_MAX = 16 * 1024 * 1024,
+};
+
+/**
+ * Sequential reader of the data in the output buffer, which may
+ * span several iovecs.
+ */
+struct iproto_obuf_reader {
+	/** Output buffer to read. */
+	const struct obuf *obuf;
+	/** Current iovec. */
+	size_t pos;
+	/** Offset in the current iovec. */
+	size_t offset;
+	/** End of the data to read. */
+	struct obuf_svp end;
+	/** Number of bytes left to read. */
+	size_t size;
+};
+
+static void
+iproto_obuf_reader_create(struct iproto_obuf_reader *reader,
+			  const struct obuf *obuf,
+			  const struct obuf_svp *begin,
+			  const struct obuf_svp *end)
 {
-	struct obuf *obuf = con->wpos.obuf;
-	struct obuf_svp obuf_end = obuf_create_svp(obuf);
-	struct obuf_svp *begin = &con->wpos.svp;
-	struct obuf_svp *end = &con->wend.svp;
-	if (con->wend.obuf != obuf) {
+	reader->obuf = obuf;
+	reader->pos = begin->pos;
+	reader->offset = begin->iov_len;
+	reader->end = *end;
+	reader->size = end->used - begin->used;
+}
+
+/**
+ * Get the next at most @a size bytes of the output stored
+ * contiguously. Returns the number of bytes got.
+ */
+static size_t
+iproto_obuf_reader_next(struct iproto_obuf_reader *reader, size_t size,
+			const char **data)
+{
+	assert(size <= reader->size);
+	if (size == 0)
+		return 0;
+	while (true) {
+		assert(reader->pos <= reader->end.pos);
 		/*
-		 * Flush the current buffer before
-		 * advancing to the next one.
+		 * iov[i].iov_len may be concurrently modified in tx
+		 * thread, but only for the last position.
 		 */
-		if (begin->used == obuf_end.used) {
-			obuf = con->wpos.obuf = con->wend.obuf;
-			obuf_svp_reset(begin);
-		} else {
-			end = &obuf_end;
+		const struct iovec *iov = &reader->obuf->iov[reader->pos];
+		size_t len = reader->pos < reader->end.pos ?
+			     iov->iov_len : reader->end.iov_len;
+		if (reader->offset == len) {
+			reader->pos++;
+			reader->offset = 0;
+			continue;
 		}
+		size_t n = MIN(len - reader->offset, size);
+		*data = (const char *)iov->iov_base + reader->offset;
+		reader->offset += n;
+		reader->size -= n;
+		return n;
 	}
-	if (begin->used == end->used) {
-		/* Nothing to do. */
+}
+
+/** Copy the next @a size bytes of the output to @a dst. */
+static void
+iproto_obuf_reader_read(struct iproto_obuf_reader *reader, char *dst,
+			size_t size)
+{
+	while (size > 0) {
+		const char *data;
+		size_t n = iproto_obuf_reader_next(reader, size, &data);
+		memcpy(dst, data, n);
+		dst += n;
+		size -= n;
+	}
+}
+
+/** Skip the next @a size bytes of the output. */
+static void
+iproto_obuf_reader_skip(struct iproto_obuf_reader *reader, size_t size)
+{
+	while (size > 0) {
+		const char *data;
+		size -= iproto_obuf_reader_next(reader, size, &data);
+	}
+}
+
+/** Get the position of the reader in the output buffer. */
+static void
+iproto_obuf_reader_svp(const struct iproto_obuf_reader *reader,
+		       struct obuf_svp *svp)
+{
+	svp->pos = reader->pos;
+	svp->iov_len = reader->offset;
+	svp->used = reader->end.used - reader->size;
+}
+
+/**
+ * Compress the body of the packet of @a len bytes at the reader
+ * position, past its fixheader, into the compressed output buffer.
+ * The body is compressed straight from the output buffer into the
+ * room left after the header, so the buffer never grows bigger than
+ * the packet. Returns 0 if the packet is compressed, 1 if it must be
+ * sent as is: its body is small or doesn't compress well, or there's
+ * no memory.
+ */
+static int
+iproto_compress_packet(struct iproto_connection *con,
+		       struct iproto_obuf_reader *reader, uint32_t len)
+{
+	/* Find the header size in a copy of the packet start. */
+	char header[XROW_HEADER_LEN_MAX];
+	size_t header_len = MIN(len, sizeof(header));
+	struct iproto_obuf_reader peek = *reader;
+	iproto_obuf_reader_read(&peek, header, header_len);
+	const char *pos = header;
+	if (mp_typeof(*pos) != MP_MAP ||
+	    mp_check(&pos, header + header_len) != 0)
+		return 1;
+	header_len = pos - header;
+	size_t body_len = len - header_len;
+	if (iproto_compression_threshold == 0 ||
+	    body_len <= iproto_compression_threshold ||
+	    body_len <= IPROTO_COMPRESSION_OVERHEAD_MAX + 1 ||
+	    body_len > IPROTO_COMPRESSION_BODY_MAX)
+		return 1;
+	size_t size = IPROTO_FIXHEADER_SIZE + IPROTO_COMPRESSION_OVERHEAD_MAX +
+		      len;
+	char *out = (char *)ibuf_reserve(&con->zbuf, size);
+	if (out == NULL) {
+		diag_set(OutOfMemory, size, "ibuf_reserve", "zbuf");
+		diag_log();
 		return 1;
 	}
-	if (!con->can_write) {
-		/* Receiving end was closed. Discard the output. */
-		*begin = *end;
-		return 0;
+	char *data = out + IPROTO_FIXHEADER_SIZE;
+	pos = header;
+	data = mp_encode_map(data, mp_decode_map(&pos) + 1);
+	memcpy(data, pos, header + header_len - pos);
+	data += header + header_len - pos;
+	data = mp_encode_uint(data, IPROTO_COMPRESSION);
+	data = mp_encode_uint(data, IPROTO_COMPRESSION_ZSTD);
+	/*
+	 * The body is compressed past the longest MP_BIN header and
+	 * moved when the compressed size is known. It's worth it only
+	 * if it saves more than the header growth.
+	 */
+	char *zbody = data + mp_sizeof_binl(UINT32_MAX);
+	ZSTD_outBuffer zout;
+	zout.dst = zbody;
+	zout.size = body_len - IPROTO_COMPRESSION_OVERHEAD_MAX - 1;
+	zout.pos = 0;
+	ZSTD_CCtx *zctx = con->iproto_thread->zstd_cctx;
+	ZSTD_CCtx_reset(zctx, ZSTD_reset_session_only);
+	/* The decompressor needs the size in the frame header. */
+	ZSTD_CCtx_setPledgedSrcSize(zctx, body_len);
+	iproto_obuf_reader_skip(reader, header_len);
+	while (body_len > 0) {
+		const char *chunk;
+		ZSTD_inBuffer zin;
+		zin.size = iproto_obuf_reader_next(reader, body_len, &chunk);
+		zin.src = chunk;
+		zin.pos = 0;
+		body_len -= zin.size;
+		ZSTD_EndDirective mode = body_len == 0 ?
+					 ZSTD_e_end : ZSTD_e_continue;
+		while (true) {
+			size_t rc = ZSTD_compressStream2(zctx, &zout, &zin,
+							 mode);
+			if (ZSTD_isError(rc))
+				return 1;
+			if (mode == ZSTD_e_end ? rc == 0 :
+			    zin.pos == zin.size)
+				break;
+			/* Doesn't compress well. */
+			if (zout.pos == zout.size)
+				return 1;
+		}
 	}
+	data = mp_encode_binl(data, zout.pos);
+	memmove(data, zbody, zout.pos);
+	data += zout.pos;
+	*out = (char)0xce;
+	mp_store_u32(out + 1, data - out - IPROTO_FIXHEADER_SIZE);
+	con->zbuf.wpos = data;
+	return 0;
+}
+
+/**
+ * Returns true if all the output has been written to the socket,
+ * i.e. the write position is at a packet boundary.
+ */
+static inline bool
+iproto_connection_output_is_flushed(struct iproto_connection *con)
+{
+	return ibuf_used(&con->zbuf) == 0 &&
+	       con->wpos.obuf == con->wend.obuf &&
+	       con->wpos.svp.used == con->wend.svp.used;
+}
+
+/** writev() the output from @a begin to @a end to the socket. */
+static int
+iproto_flush_output(struct iproto_connection *con, struct obuf *obuf,
+		    struct obuf_svp *begin, struct obuf_svp *end)
+{
 	assert(begin->used < end->used);
 	struct iovec iov[SMALL_OBUF_IOV_MAX+1];
 	struct iovec *src = obuf->iov;
@@ -1397,6 +1843,119 @@ iproto_flush(struct iproto_connection *con)
 	return nwr;
 }
 
+/** write() the compressed packet to the socket. */
+static int
+iproto_flush_zbuf(struct iproto_connection *con)
+{
+	struct ibuf *zbuf = &con->zbuf;
+	assert(ibuf_used(zbuf) > 0);
+	ssize_t nwr = iostream_write(&con->io, zbuf->rpos, ibuf_used(zbuf));
+	if (nwr >= 0) {
+		rmean_collect(con->iproto_thread->rmean, IPROTO_SENT, nwr);
+		zbuf->rpos += nwr;
+		if (ibuf_used(zbuf) == 0) {
+			iproto_reset_input(zbuf);
+			return 0;
+		}
+		return IOSTREAM_WANT_WRITE;
+	} else if (nwr == IOSTREAM_ERROR) {
+		/* See the comment in iproto_flush_output(). */
+		diag_log();
+		con->can_write = false;
+		ibuf_reset(zbuf);
+		return 0;
+	}
+	return nwr;
+}
+
+/**
+ * Write the output from @a begin to @a end to the socket, compressing
+ * big packets. A run of packets sent as is is written straight from
+ * the output buffer, a compressed packet is written from the
+ * compressed output buffer.
+ */
+static int
+iproto_flush_compressed(struct iproto_connection *con, struct obuf *obuf,
+			struct obuf_svp *begin, struct obuf_svp *end)
+{
+	struct obuf_svp *plain_end = &con->zplain_end;
+	if (plain_end->used <= begin->used) {
+		struct iproto_obuf_reader reader;
+		iproto_obuf_reader_create(&reader, obuf, begin, end);
+		*plain_end = *begin;
+		while (reader.size > 0) {
+			char fixheader[IPROTO_FIXHEADER_SIZE];
+			iproto_obuf_reader_read(&reader, fixheader,
+						sizeof(fixheader));
+			const char *pos = fixheader;
+			uint32_t len = mp_decode_uint(&pos);
+			struct iproto_obuf_reader packet = reader;
+			iproto_obuf_reader_skip(&reader, len);
+			if (len <= iproto_compression_threshold) {
+				iproto_obuf_reader_svp(&reader, plain_end);
+				continue;
+			}
+			/* Write the preceding packets first. */
+			if (plain_end->used > begin->used)
+				break;
+			if (iproto_compress_packet(con, &packet, len) == 0) {
+				iproto_obuf_reader_svp(&reader, begin);
+				obuf_svp_reset(plain_end);
+				return iproto_flush_zbuf(con);
+			}
+			iproto_obuf_reader_svp(&reader, plain_end);
+		}
+	}
+	int rc = iproto_flush_output(con, obuf, begin, plain_end);
+	if (begin->used == plain_end->used)
+		obuf_svp_reset(plain_end);
+	return rc;
+}
+
+/** writev() to the socket and handle the result. */
+static int
+iproto_flush(struct iproto_connection *con)
+{
+	if (con->is_compression_enabled != con->is_compression_requested &&
+	    iproto_connection_output_is_flushed(con))
+		con->is_compression_enabled = con->is_compression_requested;
+	if (ibuf_used(&con->zbuf) > 0) {
+		if (con->can_write)
+			return iproto_flush_zbuf(con);
+		ibuf_reset(&con->zbuf);
+	}
+	struct obuf *obuf = con->wpos.obuf;
+	struct obuf_svp obuf_end = obuf_create_svp(obuf);
+	struct obuf_svp *begin = &con->wpos.svp;
+	struct obuf_svp *end = &con->wend.svp;
+	if (con->wend.obuf != obuf) {
+		/*
+		 * Flush the current buffer before
+		 * advancing to the next one.
+		 */
+		if (begin->used == obuf_end.used) {
+			obuf = con->wpos.obuf = con->wend.obuf;
+			obuf_svp_reset(begin);
+			obuf_svp_reset(&con->zplain_end);
+		} else {
+			end = &obuf_end;
+		}
+	}
+	if (begin->used == end->used) {
+		/* Nothing to do. */
+		return 1;
+	}
+	if (!con->can_write) {
+		/* Receiving end was closed. Discard the output. */
+		*begin = *end;
+		obuf_svp_reset(&con->zplain_end);
+		return 0;
+	}
+	if (con->is_compression_enabled)
+		return iproto_flush_compressed(con, obuf, begin, end);
+	return iproto_flush_output(con, obuf, begin, end);
+}
+
 static void
 iproto_connection_on_output(ev_loop *loop, struct ev_io *watcher,
 			    int /* revents */)
@@ -1417,6 +1976,7 @@ iproto_connection_on_output(ev_loop *loop, struct ev_io *watcher,
 	}
 	if (ev_is_active(&con->output))
 		ev_io_stop(con->loop, &con->output);
+	iproto_connection_end_drain(con);
 	/*
 	 * If the out channel isn't clogged, we can read more requests.
 	 * Note, we trigger input even if we didn't write any responses
@@ -1426,6 +1986,56 @@ iproto_connection_on_output(ev_loop *loop, struct ev_io *watcher,
 	iproto_connection_feed_input(con);
 }
 
+/**
+ * Stop accepting new connections in an iproto thread if it has
+ * more connections than the least loaded thread (plus a slack),
+ * resume otherwise. All iproto threads listen on the same sockets,
+ * so connections not accepted by this thread are accepted by the
+ * others. The least loaded thread never stops accepting.
+ */
+static void
+iproto_balance(struct iproto_thread *iproto_thread)
+{
+	int count = iproto_thread->connection_count;
+	int min_count = count;
+	for (int i = 0; i < iproto_threads_count; i++) {
+		int c = pm_atomic_load(&iproto_threads[i].connection_count);
+		min_count = MIN(min_count, c);
+	}
+	bool is_overloaded = count > min_count + IPROTO_BALANCE_SLACK;
+	if (is_overloaded == iproto_thread->is_accept_paused)
+		return;
+	iproto_thread->is_accept_paused = is_overloaded;
+	if (is_overloaded) {
+		evio_service_pause(&iproto_thread->binary);
+		/*
+		 * Other threads don't notify us when they get new
+		 * connections, so recheck the load periodically.
+		 */
+		ev_timer_again(loop(), &iproto_thread->balance_timer);
+	} else {
+		evio_service_resume(&iproto_thread->binary);
+		ev_timer_stop(loop(), &iproto_thread->balance_timer);
+	}
+}
+
+static void
+iproto_balance_timer_cb(ev_loop *loop, ev_timer *watcher, int events)
+{
+	(void)loop;
+	(void)events;
+	iproto_balance((struct iproto_thread *)watcher->data);
+}
+
+/** Account a new or deleted connection of an iproto thread. */
+static void
+iproto_thread_add_connections(struct iproto_thread *iproto_thread, int count)
+{
+	pm_atomic_store(&iproto_thread->connection_count,
+			iproto_thread->connection_count + count);
+	iproto_balance(iproto_thread);
+}
+
 static struct iproto_connection *
 iproto_connection_new(struct iproto_thread *iproto_thread)
 {
@@ -1452,9 +2062,15 @@ iproto_connection_new(struct iproto_thread *iproto_thread)
 	con->tx.p_obuf = &con->obuf[0];
 	iproto_wpos_create(&con->wpos, con->tx.p_obuf);
 	iproto_wpos_create(&con->wend, con->tx.p_obuf);
+	ibuf_create(&con->zbuf, cord_slab_cache(), iproto_readahead);
+	obuf_svp_reset(&con->zplain_end);
+	con->is_compression_requested = false;
+	con->is_compression_enabled = false;
 	con->parse_size = 0;
 	con->can_write = true;
 	con->long_poll_count = 0;
+	con->msg_count = 0;
+	con->is_msg_limit_reached = false;
 	con->session = NULL;
 	rlist_create(&con->in_stop_list);
 	/* It may be very awkward to allocate at close. */
@@ -1463,7 +2079,13 @@ iproto_connection_new(struct iproto_thread *iproto_thread)
 	con->state = IPROTO_CONNECTION_ALIVE;
 	con->tx.is_push_pending = false;
 	con->tx.is_push_sent = false;
+	con->is_drain_requested = false;
+	con->tx.drain_sent = 0;
+	con->tx.drain_done = 0;
+	fiber_cond_create(&con->tx.drain_cond);
+	con->tx.is_closed = false;
 	rmean_collect(iproto_thread->rmean, IPROTO_CONNECTIONS, 1);
+	iproto_thread_add_connections(iproto_thread, 1);
 	return con;
 }
 
@@ -1481,6 +2103,7 @@ iproto_connection_delete(struct iproto_connection *con)
 	 */
 	ibuf_destroy(&con->ibuf[0]);
 	ibuf_destroy(&con->ibuf[1]);
+	ibuf_destroy(&con->zbuf);
 	assert(con->obuf[0].pos == 0 &&
 	       con->obuf[0].iov[0].iov_base == NULL);
 	assert(con->obuf[1].pos == 0 &&
@@ -1488,7 +2111,9 @@ iproto_connection_delete(struct iproto_connection *con)
 
 	assert(mh_size(con->streams) == 0);
 	mh_i64ptr_delete(con->streams);
-	mempool_free(&con->iproto_thread->iproto_connection_pool, con);
+	struct iproto_thread *iproto_thread = con->iproto_thread;
+	mempool_free(&iproto_thread->iproto_connection_pool, con);
+	iproto_thread_add_connections(iproto_thread, -1);
 }
 
 /* }}} iproto_connection */
@@ -1522,6 +2147,12 @@ net_send_msg(struct cmsg *msg);
 static void
 net_send_error(struct cmsg *msg);
 
+static void
+tx_process_batch(struct cmsg *msg);
+
+static void
+net_send_batch(struct cmsg *msg);
+
 static void
 tx_process_replication(struct cmsg *msg);
 
@@ -1531,6 +2162,39 @@ net_end_join(struct cmsg *msg);
 static void
 net_end_subscribe(struct cmsg *msg);
 
+/**
+ * Allocate the buffer for the decompressed body of a request, see
+ * xrow_decompress().
+ */
+static void *
+iproto_msg_alloc_body(void *ctx, size_t size)
+{
+	struct iproto_msg *msg = (struct iproto_msg *)ctx;
+	if (size > iproto_max_decompressed_size) {
+		diag_set(ClientError, ER_DECOMPRESSION,
+			 tt_sprintf("body size %zu exceeds "
+				    "iproto_max_decompressed_size", size));
+		return NULL;
+	}
+	assert(msg->decompressed_body == NULL);
+	msg->decompressed_body = (char *)malloc(size);
+	if (msg->decompressed_body == NULL)
+		diag_set(OutOfMemory, size, "malloc", "body");
+	return msg->decompressed_body;
+}
+
+/**
+ * Decompress the body of a request compressed by the client and
+ * make the request header point to the decompressed body.
+ */
+static int
+iproto_msg_decompress(struct iproto_msg *msg)
+{
+	return xrow_decompress(&msg->header,
+			       msg->connection->iproto_thread->zstd_dctx,
+			       iproto_msg_alloc_body, msg);
+}
+
 static void
 iproto_msg_decode(struct iproto_msg *msg, const char **pos, const char *reqend,
 		  bool *stop_input)
@@ -1544,6 +2208,9 @@ iproto_msg_decode(struct iproto_msg *msg, const char **pos, const char *reqend,
 	if (xrow_header_decode(&msg->header, pos, reqend, true))
 		goto error;
 	assert(*pos == reqend);
+	if (msg->header.compression != IPROTO_COMPRESSION_NONE &&
+	    iproto_msg_decompress(msg) != 0)
+		goto error;
 
 	type = msg->header.type;
 	stream_id = msg->header.stream_id;
@@ -1625,6 +2292,11 @@ iproto_msg_decode(struct iproto_msg *msg, const char **pos, const char *reqend,
 			goto error;
 		cmsg_init(&msg->base, iproto_thread->sql_route);
 		break;
+	case IPROTO_BATCH:
+		if (xrow_decode_batch(&msg->header, &msg->batch) != 0)
+			goto error;
+		cmsg_init(&msg->base, iproto_thread->batch_route);
+		break;
 	case IPROTO_PING:
 		cmsg_init(&msg->base, iproto_thread->misc_route);
 		break;
@@ -1636,6 +2308,9 @@ iproto_msg_decode(struct iproto_msg *msg, const char **pos, const char *reqend,
 		});
 		if (xrow_decode_id(&msg->header, &msg->id) != 0)
 			goto error;
+		msg->connection->is_compression_requested =
+			iproto_features_test(&msg->id.features,
+					     IPROTO_FEATURE_COMPRESSION);
 		cmsg_init(&msg->base, iproto_thread->misc_route);
 		break;
 	case IPROTO_JOIN:
@@ -1732,6 +2407,9 @@ tx_process_disconnect(struct cmsg *m)
 {
 	struct iproto_connection *con =
 		container_of(m, struct iproto_connection, disconnect_msg);
+	/* Stop chunked responses waiting for the output to drain. */
+	con->tx.is_closed = true;
+	fiber_cond_broadcast(&con->tx.drain_cond);
 	if (con->session != NULL) {
 		session_close(con->session);
 		/*
@@ -1776,6 +2454,7 @@ tx_process_destroy(struct cmsg *m)
 	 */
 	obuf_destroy(&con->obuf[0]);
 	obuf_destroy(&con->obuf[1]);
+	fiber_cond_destroy(&con->tx.drain_cond);
 }
 
 /**
@@ -1884,10 +2563,69 @@ tx_prepare_transaction_for_request(struct iproto_msg *msg)
 	assert(!in_txn() || msg->stream != NULL);
 }
 
+/**
+ * Account the queue delay of a request accepted by tx.
+ *
+ * The admission control follows CoDel: a short burst of requests
+ * is fine, but if even the least delayed request of an interval
+ * has waited longer than the target, there is a standing queue,
+ * and tx is overloaded. In this state, requests that have waited
+ * longer than the target are rejected so that clients fail fast
+ * instead of timing out, until a request gets through the queue
+ * in time.
+ */
+static void
+tx_update_queue_delay(struct iproto_msg *msg)
+{
+	struct iproto_thread *iproto_thread = msg->connection->iproto_thread;
+	double now = clock_monotonic();
+	double delay = MAX(now - msg->enqueue_time, 0);
+	/* The last interval with requests is stale after a pause. */
+	bool is_idle = now - iproto_thread->tx.last_accept_time >=
+		       IPROTO_QUEUE_DELAY_INTERVAL;
+	msg->queue_delay = delay;
+	iproto_thread->tx.last_queue_delay = delay;
+	iproto_thread->tx.last_accept_time = now;
+	if (now - iproto_thread->tx.queue_interval_start >=
+	    IPROTO_QUEUE_DELAY_INTERVAL) {
+		iproto_thread->tx.queue_delay = is_idle ? delay :
+			iproto_thread->tx.queue_interval_min_delay;
+		iproto_thread->tx.is_overloaded =
+			iproto_queue_delay_target > 0 &&
+			iproto_thread->tx.queue_delay >
+			iproto_queue_delay_target;
+		iproto_thread->tx.queue_interval_start = now;
+		iproto_thread->tx.queue_interval_min_delay = delay;
+	} else {
+		iproto_thread->tx.queue_interval_min_delay =
+			MIN(iproto_thread->tx.queue_interval_min_delay, delay);
+	}
+	if (delay <= iproto_queue_delay_target)
+		iproto_thread->tx.is_overloaded = false;
+}
+
+/**
+ * Reject a request if tx is overloaded and the request has
+ * waited in the queue longer than the target.
+ */
+static int
+tx_check_queue_delay(struct iproto_msg *msg)
+{
+	struct iproto_thread *iproto_thread = msg->connection->iproto_thread;
+	if (iproto_queue_delay_target <= 0 ||
+	    !iproto_thread->tx.is_overloaded ||
+	    msg->queue_delay <= iproto_queue_delay_target)
+		return 0;
+	diag_set(ClientError, ER_OVERLOADED, msg->queue_delay);
+	rmean_collect(iproto_thread->tx.rmean, REQUESTS_REJECTED, 1);
+	return -1;
+}
+
 static inline struct iproto_msg *
 tx_accept_msg(struct cmsg *m)
 {
 	struct iproto_msg *msg = (struct iproto_msg *) m;
+	tx_update_queue_delay(msg);
 	tx_accept_wpos(msg->connection, &msg->wpos);
 	tx_fiber_init(msg->connection->session, msg->header.sync);
 	tx_prepare_transaction_for_request(msg);
@@ -1958,7 +2696,8 @@ tx_process_begin(struct cmsg *m)
 	struct obuf_svp header;
 	uint32_t txn_isolation = msg->begin.txn_isolation;
 
-	if (tx_check_schema(msg->header.schema_version))
+	if (tx_check_schema(msg->header.schema_version) != 0 ||
+	    tx_check_queue_delay(msg) != 0)
 		goto error;
 
 	if (box_txn_begin() != 0)
@@ -2046,7 +2785,8 @@ static void
 tx_process1(struct cmsg *m)
 {
 	struct iproto_msg *msg = tx_accept_msg(m);
-	if (tx_check_schema(msg->header.schema_version))
+	if (tx_check_schema(msg->header.schema_version) != 0 ||
+	    tx_check_queue_delay(msg) != 0)
 		goto error;
 
 	struct tuple *tuple;
@@ -2072,6 +2812,33 @@ error:
 	tx_end_msg(msg, &svp);
 }
 
+/**
+ * Send @a count tuples of a SELECT result starting from @a entry
+ * in an IPROTO_CHUNK packet. @a entry is advanced past the sent
+ * tuples. Then wait until the output is flushed to the socket,
+ * so that the result is not encoded faster than the client reads
+ * it.
+ */
+static int
+tx_send_select_chunk(struct iproto_msg *msg, struct port *port,
+		     struct port_c_entry **entry, int count)
+{
+	struct iproto_connection *con = msg->connection;
+	struct obuf *out = con->tx.p_obuf;
+	struct obuf_svp svp;
+	if (iproto_prepare_select(out, &svp) != 0)
+		return -1;
+	count = port_c_dump_msgpack_16_chunk(port, entry, count, out);
+	if (count < 0) {
+		obuf_rollback_to_svp(out, &svp);
+		return -1;
+	}
+	iproto_reply_select_chunk(out, &svp, msg->header.sync,
+				  ::schema_version, count);
+	tx_push(con);
+	return tx_wait_drain(con);
+}
+
 static void
 tx_process_select(struct cmsg *m)
 {
@@ -2079,19 +2846,87 @@ tx_process_select(struct cmsg *m)
 	struct obuf *out;
 	struct obuf_svp svp;
 	struct port port;
-	int count;
+	struct port_c_entry *entry;
+	int count, left;
 	int rc;
+	uint32_t offset, limit, page_size;
+	bool is_paged;
+	const char *packed_pos, *packed_pos_end;
+	/* Copy of the position of the last sent page. */
+	char *page_pos = NULL;
+	size_t page_pos_size = 0;
+	size_t region_svp = region_used(&fiber()->gc);
 	struct request *req = &msg->dml;
-	if (tx_check_schema(msg->header.schema_version))
+	if (tx_check_schema(msg->header.schema_version) != 0 ||
+	    tx_check_queue_delay(msg) != 0)
 		goto error;
 
 	tx_inject_delay();
-	rc = box_select(req->space_id, req->index_id,
-			req->iterator, req->offset, req->limit,
-			req->key, req->key_end, &port);
-	if (rc < 0)
-		goto error;
-
+	packed_pos = req->after_position;
+	packed_pos_end = req->after_position_end;
+	offset = req->offset;
+	limit = req->limit;
+	/*
+	 * If the index supports iterator positions, a chunked
+	 * result is selected page by page, one chunk at a time,
+	 * continuing after the last tuple of the previous page.
+	 * Otherwise it is selected as a whole and then split.
+	 */
+	is_paged = req->chunk_size != 0 && req->chunk_size < limit &&
+		   box_select_supports_position(req->space_id, req->index_id,
+						req->iterator);
+	page_size = is_paged ? req->chunk_size : limit;
+	while (true) {
+		rc = box_select(req->space_id, req->index_id,
+				req->iterator, offset, MIN(page_size, limit),
+				req->key, req->key_end,
+				&packed_pos, &packed_pos_end,
+				req->fetch_position || is_paged, &port);
+		if (rc < 0)
+			goto error;
+		entry = ((struct port_c *)&port)->first;
+		left = ((struct port_c *)&port)->size;
+		if (!is_paged || (uint32_t)left < page_size ||
+		    (uint32_t)left == limit)
+			break;
+		rc = tx_send_select_chunk(msg, &port, &entry, left);
+		port_destroy(&port);
+		if (rc != 0)
+			goto error;
+		offset = 0;
+		limit -= left;
+		/*
+		 * The position is allocated on the fiber region, as
+		 * well as anything else box_select() needs. Keep only
+		 * the position, so that the region doesn't grow with
+		 * the number of pages.
+		 */
+		if (packed_pos != page_pos) {
+			size_t size = packed_pos_end - packed_pos;
+			if (size > page_pos_size) {
+				char *buf = (char *)realloc(page_pos, size);
+				if (buf == NULL) {
+					diag_set(OutOfMemory, size, "realloc",
+						 "page_pos");
+					goto error;
+				}
+				page_pos = buf;
+				page_pos_size = size;
+			}
+			memcpy(page_pos, packed_pos, size);
+			packed_pos = page_pos;
+			packed_pos_end = page_pos + size;
+		}
+		region_truncate(&fiber()->gc, region_svp);
+	}
+	while (req->chunk_size != 0 && (uint32_t)left > req->chunk_size) {
+		if (tx_send_select_chunk(msg, &port, &entry,
+					 req->chunk_size) != 0) {
+			port_destroy(&port);
+			goto error;
+		}
+		left -= req->chunk_size;
+	}
 	out = msg->connection->tx.p_obuf;
 	if (iproto_prepare_select(out, &svp) != 0) {
 		port_destroy(&port);
@@ -2100,19 +2935,206 @@ tx_process_select(struct cmsg *m)
 	/*
 	 * SELECT output format has not changed since Tarantool 1.6
 	 */
-	count = port_dump_msgpack_16(&port, out);
+	count = port_c_dump_msgpack_16_chunk(&port, &entry, left, out);
 	port_destroy(&port);
 	if (count < 0) {
 		/* Discard the prepared select. */
 		obuf_rollback_to_svp(out, &svp);
 		goto error;
 	}
-	iproto_reply_select(out, &svp, msg->header.sync,
-			    ::schema_version, count);
+	if (req->fetch_position && packed_pos != NULL) {
+		if (iproto_reply_select_with_position(out, &svp,
+						      msg->header.sync,
+						      ::schema_version, count,
+						      packed_pos,
+						      packed_pos_end) != 0) {
+			obuf_rollback_to_svp(out, &svp);
+			goto error;
+		}
+	} else {
+		iproto_reply_select(out, &svp, msg->header.sync,
+				    ::schema_version, count);
+	}
+	free(page_pos);
 	iproto_wpos_create(&msg->wpos, out);
 	tx_end_msg(msg, &svp);
 	return;
 error:
+	free(page_pos);
+	out = msg->connection->tx.p_obuf;
+	svp = obuf_create_svp(out);
+	tx_reply_error(msg);
+	tx_end_msg(msg, &svp);
+}
+
+/** Result of a request of a BATCH, see tx_process_batch(). */
+struct tx_batch_result {
+	/** Tuples selected by a SELECT. */
+	struct port port;
+	/** Referenced result tuple of other requests, may be NULL. */
+	struct tuple *tuple;
+};
+
+/**
+ * Execute a request of a BATCH. The result is kept until all the
+ * requests are executed, since they may yield and nothing may be
+ * written to the output buffer in the meantime.
+ */
+static int
+tx_process_batch_request(struct request *req, struct tx_batch_result *result)
+{
+	result->tuple = NULL;
+	if (req->type != IPROTO_SELECT) {
+		if (box_process1(req, &result->tuple) != 0)
+			return -1;
+		if (result->tuple != NULL)
+			tuple_ref(result->tuple);
+		return 0;
+	}
+	const char *packed_pos = req->after_position;
+	const char *packed_pos_end = req->after_position_end;
+	return box_select(req->space_id, req->index_id, req->iterator,
+			  req->offset, req->limit, req->key, req->key_end,
+			  &packed_pos, &packed_pos_end, false, &result->port);
+}
+
+/**
+ * Encode the result of a request of a BATCH: an array of selected
+ * tuples for SELECT and an array of zero or one tuple for other
+ * requests.
+ */
+static int
+tx_encode_batch_result(const struct request *req,
+		       struct tx_batch_result *result, struct obuf *out)
+{
+	if (req->type != IPROTO_SELECT) {
+		struct tuple *tuple = result->tuple;
+		char *p = (char *)obuf_alloc(out, mp_sizeof_array(1));
+		if (p == NULL) {
+			diag_set(OutOfMemory, mp_sizeof_array(1),
+				 "obuf_alloc", "p");
+			return -1;
+		}
+		mp_encode_array(p, tuple != NULL ? 1 : 0);
+		if (tuple != NULL && tuple_to_obuf(tuple, out) != 0)
+			return -1;
+		return 0;
+	}
+	/* The array header is filled when the tuple count is known. */
+	char *p = (char *)obuf_alloc(out, mp_sizeof_array(UINT32_MAX));
+	if (p == NULL) {
+		diag_set(OutOfMemory, mp_sizeof_array(UINT32_MAX),
+			 "obuf_alloc", "p");
+		return -1;
+	}
+	int count = port_dump_msgpack_16(&result->port, out);
+	if (count < 0)
+		return -1;
+	*p = 0xdd;
+	mp_store_u32(p + 1, count);
+	return 0;
+}
+
+/** Release the results of the first @a count requests of a BATCH. */
+static void
+tx_destroy_batch_results(struct batch_request *batch,
+			 struct tx_batch_result *results, uint32_t count)
+{
+	for (uint32_t i = 0; i < count; i++) {
+		if (batch->requests[i].type == IPROTO_SELECT)
+			port_destroy(&results[i].port);
+		else if (results[i].tuple != NULL)
+			tuple_unref(results[i].tuple);
+	}
+}
+
+static void
+tx_process_batch(struct cmsg *m)
+{
+	struct iproto_msg *msg = tx_accept_msg(m);
+	struct batch_request *batch = &msg->batch;
+	struct tx_batch_result *results = NULL;
+	struct obuf *out;
+	struct obuf_svp svp;
+	uint32_t done = 0;
+	size_t size;
+	if (tx_check_schema(msg->header.schema_version) != 0 ||
+	    tx_check_queue_delay(msg) != 0)
+		goto error;
+	tx_inject_delay();
+	size = batch->request_count * sizeof(*results);
+	results = (struct tx_batch_result *)malloc(size);
+	if (results == NULL) {
+		diag_set(OutOfMemory, size, "malloc", "results");
+		goto error;
+	}
+	/*
+	 * An atomic batch is executed in one transaction, so all its
+	 * requests are written to WAL in one journal entry.
+	 */
+	if (batch->is_atomic && box_txn_begin() != 0)
+		goto error;
+	for (; done < batch->request_count; done++) {
+		if (tx_process_batch_request(&batch->requests[done],
+					     &results[done]) != 0)
+			break;
+	}
+	if (batch->is_atomic) {
+		if (done < batch->request_count)
+			goto rollback;
+		if (box_txn_commit() != 0)
+			goto error;
+	}
+	/*
+	 * The requests and the commit may yield, letting other
+	 * requests of the connection write their replies, so the
+	 * reply is encoded only now, without yields, like in
+	 * tx_process1().
+	 */
+	out = msg->connection->tx.p_obuf;
+	if (iproto_prepare_select(out, &svp) != 0)
+		goto error;
+	for (uint32_t i = 0; i < done; i++) {
+		if (tx_encode_batch_result(&batch->requests[i], &results[i],
+					   out) != 0) {
+			obuf_rollback_to_svp(out, &svp);
+			goto error;
+		}
+	}
+	if (done < batch->request_count) {
+		/*
+		 * A non-atomic batch stops at the first failed request
+		 * and returns the results of the preceding ones along
+		 * with the error.
+		 */
+		if (iproto_reply_batch_with_error(
+				out, &svp, msg->header.sync, ::schema_version,
+				done, diag_last_error(diag_get())) != 0) {
+			obuf_rollback_to_svp(out, &svp);
+			goto error;
+		}
+	} else {
+		iproto_reply_select(out, &svp, msg->header.sync,
+				    ::schema_version, done);
+	}
+	tx_destroy_batch_results(batch, results, done);
+	free(results);
+	iproto_wpos_create(&msg->wpos, out);
+	tx_end_msg(msg, &svp);
+	return;
+rollback: {
+	/* Keep the error of the failed request. */
+	struct diag diag;
+	diag_create(&diag);
+	diag_move(diag_get(), &diag);
+	box_txn_rollback();
+	diag_move(&diag, diag_get());
+}
+error:
+	if (results != NULL) {
+		tx_destroy_batch_results(batch, results, done);
+		free(results);
+	}
 	out = msg->connection->tx.p_obuf;
 	svp = obuf_create_svp(out);
 	tx_reply_error(msg);
@@ -2134,7 +3156,8 @@ static void
 tx_process_call(struct cmsg *m)
 {
 	struct iproto_msg *msg = tx_accept_msg(m);
-	if (tx_check_schema(msg->header.schema_version))
+	if (tx_check_schema(msg->header.schema_version) != 0 ||
+	    tx_check_queue_delay(msg) != 0)
 		goto error;
 
 	/*
@@ -2308,7 +3331,8 @@ tx_process_sql(struct cmsg *m)
 	uint32_t len;
 	bool is_unprepare = false;
 
-	if (tx_check_schema(msg->header.schema_version))
+	if (tx_check_schema(msg->header.schema_version) != 0 ||
+	    tx_check_queue_delay(msg) != 0)
 		goto error;
 	assert(msg->header.type == IPROTO_EXECUTE ||
 	       msg->header.type == IPROTO_PREPARE);
@@ -2490,6 +3514,7 @@ iproto_msg_finish_processing_in_stream(struct iproto_msg *msg)
 		assert(stream->current != NULL);
 		stream->current->wpos = con->wpos;
 		con->iproto_thread->requests_in_stream_queue--;
+		stream->current->enqueue_time = clock_monotonic();
 		cpipe_push_input(&con->iproto_thread->tx_pipe,
 				 &stream->current->base);
 		cpipe_flush_input(&con->iproto_thread->tx_pipe);
@@ -2519,6 +3544,7 @@ net_send_msg(struct cmsg *m)
 		iproto_connection_close(con);
 	}
 	iproto_msg_delete(msg);
+	iproto_connection_resume_msg_limit(con);
 }
 
 /**
@@ -2534,6 +3560,15 @@ net_send_error(struct cmsg *m)
 	net_send_msg(m);
 }
 
+/** Free the decoded requests of a BATCH and send the reply. */
+static void
+net_send_batch(struct cmsg *m)
+{
+	struct iproto_msg *msg = (struct iproto_msg *) m;
+	batch_request_destroy(&msg->batch);
+	net_send_msg(m);
+}
+
 static void
 net_end_join(struct cmsg *m)
 {
@@ -2690,9 +3725,20 @@ net_cord_f(va_list  ap)
 		       sizeof(struct iproto_connection));
 	mempool_create(&iproto_thread->iproto_stream_pool, &cord()->slabc,
 		       sizeof(struct iproto_stream));
+	iproto_thread->zstd_cctx = ZSTD_createCCtx();
+	iproto_thread->zstd_dctx = ZSTD_createDCtx();
+	if (iproto_thread->zstd_cctx == NULL ||
+	    iproto_thread->zstd_dctx == NULL)
+		panic("failed to create zstd context");
+	ZSTD_CCtx_setParameter(iproto_thread->zstd_cctx,
+			       ZSTD_c_compressionLevel,
+			       IPROTO_COMPRESSION_LEVEL);
 
 	evio_service_create(loop(), &iproto_thread->binary, "binary",
 			    iproto_on_accept, iproto_thread);
+	ev_init(&iproto_thread->balance_timer, iproto_balance_timer_cb);
+	iproto_thread->balance_timer.repeat = IPROTO_BALANCE_PERIOD;
+	iproto_thread->balance_timer.data = iproto_thread;
 
 	char endpoint_name[ENDPOINT_NAME_MAX];
 	snprintf(endpoint_name, ENDPOINT_NAME_MAX, "net%u",
@@ -2710,6 +3756,9 @@ net_cord_f(va_list  ap)
 	cbus_loop(&endpoint);
 
 	cpipe_destroy(&iproto_thread->tx_pipe);
+	ZSTD_freeCCtx(iproto_thread->zstd_cctx);
+	ZSTD_freeDCtx(iproto_thread->zstd_dctx);
+	ev_timer_stop(loop(), &iproto_thread->balance_timer);
 	/*
 	 * Nothing to do in the fiber so far, the service
 	 * will take care of creating events for incoming
@@ -2786,6 +3835,60 @@ tx_push(struct iproto_connection *con)
 		con->tx.is_push_pending = true;
 }
 
+static void
+net_begin_drain(struct cmsg *m)
+{
+	struct iproto_connection *con =
+		container_of(m, struct iproto_connection, drain_msg);
+	assert(!con->is_drain_requested);
+	con->is_drain_requested = true;
+	if (con->state != IPROTO_CONNECTION_ALIVE ||
+	    iproto_connection_output_is_flushed(con))
+		iproto_connection_end_drain(con);
+	else
+		iproto_connection_feed_output(con);
+}
+
+static void
+tx_end_drain(struct cmsg *m)
+{
+	struct iproto_connection *con =
+		container_of(m, struct iproto_connection, drain_msg);
+	con->tx.drain_done = con->tx.drain_sent;
+	fiber_cond_broadcast(&con->tx.drain_cond);
+}
+
+/**
+ * Wait until the output of the connection is flushed to the
+ * socket. Only one drain request can be in flight, and one sent
+ * before the output of this fiber was written could have been
+ * handled already, so wait for a request sent after it. Note,
+ * the output may still be on its way to the iproto thread with
+ * Kharon, so the last pushed data is not necessarily flushed
+ * when this function returns, but all the data pushed before.
+ */
+static int
+tx_wait_drain(struct iproto_connection *con)
+{
+	uint64_t seq = con->tx.drain_sent + 1;
+	while (con->tx.drain_done < seq) {
+		if (con->tx.is_closed) {
+			diag_set(ClientError, ER_SESSION_CLOSED);
+			return -1;
+		}
+		if (con->tx.drain_done == con->tx.drain_sent) {
+			cmsg_init(&con->drain_msg,
+				  con->iproto_thread->drain_route);
+			con->tx.drain_sent++;
+			cpipe_push(&con->iproto_thread->net_pipe,
+				   &con->drain_msg);
+		}
+		if (fiber_cond_wait(&con->tx.drain_cond) != 0)
+			return -1;
+	}
+	return 0;
+}
+
 /**
  * Push a message from @a port to a remote client.
  * @param session iproto session.
@@ -2896,6 +3999,9 @@ iproto_thread_init_routes(struct iproto_thread *iproto_thread)
 	iproto_thread->sql_route[0] =
 		{ tx_process_sql, &iproto_thread->net_pipe };
 	iproto_thread->sql_route[1] = { net_send_msg, NULL };
+	iproto_thread->batch_route[0] =
+		{ tx_process_batch, &iproto_thread->net_pipe };
+	iproto_thread->batch_route[1] = { net_send_batch, NULL };
 	iproto_thread->join_route[0] =
 		{ tx_process_replication, &iproto_thread->net_pipe };
 	iproto_thread->join_route[1] = { net_end_join, NULL };
@@ -2908,6 +4014,8 @@ iproto_thread_init_routes(struct iproto_thread *iproto_thread)
 	iproto_thread->push_route[0] =
 		{ iproto_process_push, &iproto_thread->tx_pipe };
 	iproto_thread->push_route[1] = { tx_end_push, NULL };
+	iproto_thread->drain_route[0] = { net_begin_drain, NULL };
+	iproto_thread->drain_end_route[0] = { tx_end_drain, NULL };
 	/* IPROTO_OK */
 	iproto_thread->dml_route[0] = NULL;
 	/* IPROTO_SELECT */
@@ -3124,6 +4232,8 @@ iproto_do_cfg_f(struct cbus_call_msg *m)
 			evio_service_attach(binary, cfg_msg->binary);
 			if (evio_service_listen(binary) != 0)
 				diag_raise();
+			iproto_thread->is_accept_paused = false;
+			iproto_balance(iproto_thread);
 			break;
 		case IPROTO_CFG_STOP:
 			evio_service_detach(binary);
@@ -3211,6 +4321,11 @@ iproto_stats_add(struct iproto_stats *total_stats,
 		thread_stats->requests_in_stream_queue;
 	total_stats->requests_in_progress +=
 		thread_stats->requests_in_progress;
+	/* Report the most delayed thread. */
+	total_stats->queue_delay = MAX(total_stats->queue_delay,
+				       thread_stats->queue_delay);
+	total_stats->queue_delay_min = MAX(total_stats->queue_delay_min,
+					   thread_stats->queue_delay_min);
 }
 
 void
@@ -3233,8 +4348,18 @@ iproto_thread_stats_get(struct iproto_stats *stats, int thread_id)
 	assert(thread_id >= 0 && thread_id < iproto_threads_count);
 	cfg_msg.stats = stats;
 	iproto_do_cfg_crit(&iproto_threads[thread_id], &cfg_msg);
-	stats->requests_in_progress =
-		iproto_threads[thread_id].tx.requests_in_progress;
+	struct iproto_thread *iproto_thread = &iproto_threads[thread_id];
+	stats->requests_in_progress = iproto_thread->tx.requests_in_progress;
+	/*
+	 * The delays are updated only when requests arrive. A thread
+	 * that has got no requests for an interval has no queue, so
+	 * don't report the last burst forever.
+	 */
+	if (clock_monotonic() - iproto_thread->tx.last_accept_time <
+	    IPROTO_QUEUE_DELAY_INTERVAL) {
+		stats->queue_delay = iproto_thread->tx.last_queue_delay;
+		stats->queue_delay_min = iproto_thread->tx.queue_delay;
+	}
 }
 
 void
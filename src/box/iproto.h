@@ -71,9 +71,20 @@ struct iproto_stats {
 	size_t requests_in_progress;
 	/** Count of requests currently pending in stream queue. */
 	size_t requests_in_stream_queue;
+	/** Time the last request waited in the tx queue. */
+	double queue_delay;
+	/**
+	 * Minimal time a request waited in the tx queue over
+	 * the last measurement interval.
+	 */
+	double queue_delay_min;
 };
 
 extern unsigned iproto_readahead;
+extern unsigned iproto_compression_threshold;
+extern unsigned iproto_max_decompressed_size;
+extern int iproto_connection_msg_max;
+extern double iproto_queue_delay_target;
 extern int iproto_threads_count;
 
 /**
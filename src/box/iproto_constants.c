@@ -44,10 +44,10 @@ const unsigned char iproto_key_type[IPROTO_KEY_MAX] =
 		/* 0x08 */	MP_UINT,   /* IPROTO_TSN */
 		/* 0x09 */	MP_UINT,   /* IPROTO_FLAGS */
 		/* 0x0a */	MP_UINT,   /* IPROTO_STREAM_ID */
+		/* 0x0b */	MP_UINT,   /* IPROTO_COMPRESSION */
 	/* }}} */
 
 	/* {{{ unused */
-		/* 0x0b */	MP_UINT,
 		/* 0x0c */	MP_UINT,
 		/* 0x0d */	MP_UINT,
 		/* 0x0e */	MP_UINT,
@@ -71,9 +71,15 @@ const unsigned char iproto_key_type[IPROTO_KEY_MAX] =
 		/* 0x1a */	MP_UINT,
 		/* 0x1b */	MP_UINT,
 		/* 0x1c */	MP_UINT,
-		/* 0x1d */	MP_UINT,
-		/* 0x1e */	MP_UINT,
-		/* 0x1f */	MP_UINT,
+	/* }}} */
+
+	/* {{{ body -- integer keys */
+		/* 0x1d */	MP_UINT, /* IPROTO_CHUNK_SIZE */
+	/* }}} */
+
+	/* {{{ body -- boolean keys */
+		/* 0x1e */	MP_BOOL, /* IPROTO_IS_ATOMIC */
+		/* 0x1f */	MP_BOOL, /* IPROTO_FETCH_POSITION */
 	/* }}} */
 
 	/* {{{ body -- all keys */
@@ -91,11 +97,8 @@ const unsigned char iproto_key_type[IPROTO_KEY_MAX] =
 	/* 0x2b */	MP_MAP, /* IPROTO_OPTIONS */
 	/* 0x2c */	MP_ARRAY, /* IPROTO_OLD_TUPLE */
 	/* 0x2d */	MP_ARRAY, /* IPROTO_NEW_TUPLE */
-	/* }}} */
-
-	/* {{{ unused */
-	/* 0x2e */	MP_UINT,
-	/* 0x2f */	MP_UINT,
+	/* 0x2e */	MP_STR, /* IPROTO_AFTER_POSITION */
+	/* 0x2f */	MP_ARRAY, /* IPROTO_REQUESTS */
 	/* }}} */
 
 	/* {{{ body -- response keys */
@@ -104,10 +107,10 @@ const unsigned char iproto_key_type[IPROTO_KEY_MAX] =
 	/* 0x32 */	MP_ARRAY, /* IPROTO_METADATA */
 	/* 0x33 */	MP_ARRAY, /* IPROTO_BIND_METADATA */
 	/* 0x34 */	MP_UINT, /* IIPROTO_BIND_COUNT */
+	/* 0x35 */	MP_STR, /* IPROTO_POSITION */
 	/* }}} */
 
 	/* {{{ unused */
-	/* 0x35 */	MP_UINT,
 	/* 0x36 */	MP_UINT,
 	/* 0x37 */	MP_UINT,
 	/* 0x38 */	MP_UINT,
@@ -153,6 +156,8 @@ const unsigned char iproto_key_type[IPROTO_KEY_MAX] =
 	/* 0x57 */	MP_STR, /* IPROTO_EVENT_KEY */
 	/* 0x58 */	MP_NIL, /* IPROTO_EVENT_DATA (can be any) */
 	/* 0x59 */	MP_UINT, /* IPROTO_TXN_ISOLATION */
+	/* 0x5a */	MP_UINT, /* IPROTO_REPLICATION_COMPRESSION */
+	/* 0x5b */	MP_ARRAY, /* IPROTO_REPLICATION_SPACES */
 	/* }}} */
 };
 
@@ -211,7 +216,7 @@ const char *iproto_key_strs[IPROTO_KEY_MAX] = {
 	"tsn",              /* 0x08 */
 	"flags",            /* 0x09 */
 	"stream_id",        /* 0x0a */
-	NULL,               /* 0x0b */
+	"compression",      /* 0x0b */
 	NULL,               /* 0x0c */
 	NULL,               /* 0x0d */
 	NULL,               /* 0x0e */
@@ -229,9 +234,9 @@ const char *iproto_key_strs[IPROTO_KEY_MAX] = {
 	NULL,               /* 0x1a */
 	NULL,               /* 0x1b */
 	NULL,               /* 0x1c */
-	NULL,               /* 0x1d */
-	NULL,               /* 0x1e */
-	NULL,               /* 0x1f */
+	"chunk size",       /* 0x1d */
+	"is atomic",        /* 0x1e */
+	"fetch position",   /* 0x1f */
 	"key",              /* 0x20 */
 	"tuple",            /* 0x21 */
 	"function name",    /* 0x22 */
@@ -246,14 +251,14 @@ const char *iproto_key_strs[IPROTO_KEY_MAX] = {
 	"options",          /* 0x2b */
 	"old tuple",        /* 0x2c */
 	"new tuple",        /* 0x2d */
-	NULL,               /* 0x2e */
-	NULL,               /* 0x2f */
+	"after position",   /* 0x2e */
+	"requests",         /* 0x2f */
 	"data",             /* 0x30 */
 	"error_24",         /* 0x31 */
 	"metadata",         /* 0x32 */
 	"bind meta",        /* 0x33 */
 	"bind count",       /* 0x34 */
-	NULL,               /* 0x35 */
+	"position",         /* 0x35 */
 	NULL,               /* 0x36 */
 	NULL,               /* 0x37 */
 	NULL,               /* 0x38 */
@@ -290,6 +295,8 @@ const char *iproto_key_strs[IPROTO_KEY_MAX] = {
 	"event key",        /* 0x57 */
 	"event data",       /* 0x58 */
 	"txn isolation",    /* 0x59 */
+	"replication compression", /* 0x5a */
+	"replication spaces", /* 0x5b */
 };
 
 const char *vy_page_info_key_strs[VY_PAGE_INFO_KEY_MAX] = {
@@ -59,6 +59,14 @@ enum {
 	IPROTO_FLAG_WAIT_ACK = 0x04,
 };
 
+/** IPROTO_COMPRESSION values. */
+enum iproto_compression {
+	/** The body is not compressed. */
+	IPROTO_COMPRESSION_NONE = 0,
+	/** The body is a zstd frame. */
+	IPROTO_COMPRESSION_ZSTD = 1,
+};
+
 enum iproto_key {
 	IPROTO_REQUEST_TYPE = 0x00,
 	IPROTO_SYNC = 0x01,
@@ -73,6 +81,11 @@ enum iproto_key {
 	IPROTO_TSN = 0x08,
 	IPROTO_FLAGS = 0x09,
 	IPROTO_STREAM_ID = 0x0a,
+	/**
+	 * Compression of the packet body, see enum iproto_compression.
+	 * If set, the body is a MP_BIN with the compressed MsgPack map.
+	 */
+	IPROTO_COMPRESSION = 0x0b,
 	/* Leave a gap for other keys in the header. */
 	IPROTO_SPACE_ID = 0x10,
 	IPROTO_INDEX_ID = 0x11,
@@ -80,6 +93,16 @@ enum iproto_key {
 	IPROTO_OFFSET = 0x13,
 	IPROTO_ITERATOR = 0x14,
 	IPROTO_INDEX_BASE = 0x15,
+	/**
+	 * Send the result of SELECT in IPROTO_CHUNK packets of
+	 * at most this number of tuples followed by the final
+	 * response with the rest of tuples.
+	 */
+	IPROTO_CHUNK_SIZE = 0x1d,
+	/** Execute all requests of a BATCH in one transaction. */
+	IPROTO_IS_ATOMIC = 0x1e,
+	/** Request the iterator position in the response of SELECT. */
+	IPROTO_FETCH_POSITION = 0x1f,
 
 	/* Leave a gap between integer values and other keys */
 	IPROTO_KEY = 0x20,
@@ -108,6 +131,16 @@ enum iproto_key {
 	IPROTO_OLD_TUPLE = 0x2c,
 	/** New tuple (i.e. result of DML request). */
 	IPROTO_NEW_TUPLE = 0x2d,
+	/** Iterator position to start SELECT after. */
+	IPROTO_AFTER_POSITION = 0x2e,
+	/**
+	 * IPROTO_REQUESTS: [
+	 *      { IPROTO_REQUEST_TYPE: type, <request body keys> },
+	 *      { ... },
+	 *      ...
+	 * ]
+	 */
+	IPROTO_REQUESTS = 0x2f,
 
 	/* Leave a gap between request keys and response keys */
 	IPROTO_DATA = 0x30,
@@ -122,6 +155,8 @@ enum iproto_key {
 	IPROTO_METADATA = 0x32,
 	IPROTO_BIND_METADATA = 0x33,
 	IPROTO_BIND_COUNT = 0x34,
+	/** Iterator position of the last tuple returned by SELECT. */
+	IPROTO_POSITION = 0x35,
 
 	/* Leave a gap between response keys and SQL keys. */
 	IPROTO_SQL_TEXT = 0x40,
@@ -154,6 +189,19 @@ enum iproto_key {
 	IPROTO_EVENT_DATA = 0x58,
 	/** Isolation level, is used only by IPROTO_BEGIN request. */
 	IPROTO_TXN_ISOLATION = 0x59,
+	/**
+	 * Compression of the replication stream, see enum
+	 * iproto_compression. Requested by a replica in SUBSCRIBE and
+	 * confirmed by the master in the response, after which all the
+	 * data sent by the master is a zstd stream.
+	 */
+	IPROTO_REPLICATION_COMPRESSION = 0x5a,
+	/**
+	 * Ids of the spaces whose rows a replica wants to receive.
+	 * Sent by a replica in SUBSCRIBE. Rows of the other user
+	 * spaces are relayed as NOPs.
+	 */
+	IPROTO_REPLICATION_SPACES = 0x5b,
 	/*
 	 * Be careful to not extend iproto_key values over 0x7f.
 	 * iproto_keys are encoded in msgpack as positive fixnum, which ends at
@@ -237,6 +285,12 @@ enum iproto_type {
 	/** The maximum typecode used for box.stat() */
 	IPROTO_TYPE_STAT_MAX,
 
+	/**
+	 * Several DML and SELECT requests in one packet. Not accounted
+	 * in box.stat(), the requests of the batch are.
+	 */
+	IPROTO_BATCH = 20,
+
 	IPROTO_RAFT = 30,
 	/** PROMOTE request. */
 	IPROTO_RAFT_PROMOTE = 31,
@@ -335,6 +389,8 @@ iproto_type_name(uint16_t type)
 		return iproto_type_strs[type];
 
 	switch (type) {
+	case IPROTO_BATCH:
+		return "BATCH";
 	case IPROTO_RAFT:
 		return "RAFT";
 	case IPROTO_RAFT_PROMOTE:
@@ -66,4 +66,6 @@ iproto_features_init(void)
 			    IPROTO_FEATURE_ERROR_EXTENSION);
 	iproto_features_set(&IPROTO_CURRENT_FEATURES,
 			    IPROTO_FEATURE_WATCHERS);
+	iproto_features_set(&IPROTO_CURRENT_FEATURES,
+			    IPROTO_FEATURE_COMPRESSION);
 }
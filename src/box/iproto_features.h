@@ -45,6 +45,13 @@ enum iproto_feature_id {
 	 * IPROTO_WATCH, IPROTO_UNWATCH, IPROTO_EVENT commands.
 	 */
 	IPROTO_FEATURE_WATCHERS = 3,
+	/**
+	 * Compression of packet bodies: IPROTO_COMPRESSION header key.
+	 *
+	 * The server always accepts compressed requests, but compresses
+	 * responses only if the client has set this feature bit.
+	 */
+	IPROTO_FEATURE_COMPRESSION = 4,
 	iproto_feature_id_MAX,
 };
 
@@ -60,7 +67,7 @@ struct iproto_features {
  * It should be incremented every time a new feature is added or removed.
  */
 enum {
-	IPROTO_CURRENT_VERSION = 3,
+	IPROTO_CURRENT_VERSION = 4,
 };
 
 /**
@@ -161,6 +161,38 @@ lbox_cfg_set_checkpoint_wal_threshold(struct lua_State *L)
 	return 0;
 }
 
+static int
+lbox_cfg_set_iproto_compression_threshold(struct lua_State *L)
+{
+	if (box_set_iproto_compression_threshold() != 0)
+		luaT_error(L);
+	return 0;
+}
+
+static int
+lbox_cfg_set_iproto_max_decompressed_size(struct lua_State *L)
+{
+	if (box_set_iproto_max_decompressed_size() != 0)
+		luaT_error(L);
+	return 0;
+}
+
+static int
+lbox_cfg_set_iproto_connection_msg_max(struct lua_State *L)
+{
+	if (box_set_iproto_connection_msg_max() != 0)
+		luaT_error(L);
+	return 0;
+}
+
+static int
+lbox_cfg_set_iproto_queue_delay_target(struct lua_State *L)
+{
+	if (box_set_iproto_queue_delay_target() != 0)
+		luaT_error(L);
+	return 0;
+}
+
 static int
 lbox_cfg_set_wal_queue_max_size(struct lua_State *L)
 {
@@ -169,6 +201,22 @@ lbox_cfg_set_wal_queue_max_size(struct lua_State *L)
 	return 0;
 }
 
+static int
+lbox_cfg_set_wal_group_commit_max_delay(struct lua_State *L)
+{
+	if (box_set_wal_group_commit_max_delay() != 0)
+		luaT_error(L);
+	return 0;
+}
+
+static int
+lbox_cfg_set_wal_fsync(struct lua_State *L)
+{
+	if (box_set_wal_fsync() != 0)
+		luaT_error(L);
+	return 0;
+}
+
 static int
 lbox_cfg_set_wal_cleanup_delay(struct lua_State *L)
 {
@@ -210,6 +258,17 @@ lbox_cfg_set_memtx_max_tuple_size(struct lua_State *L)
 	return 0;
 }
 
+static int
+lbox_cfg_set_memtx_checkpoint_threads(struct lua_State *L)
+{
+	try {
+		box_set_memtx_checkpoint_threads();
+	} catch (Exception *) {
+		luaT_error(L);
+	}
+	return 0;
+}
+
 static int
 lbox_cfg_set_vinyl_memory(struct lua_State *L)
 {
@@ -396,6 +455,30 @@ lbox_cfg_set_replication_skip_conflict(struct lua_State *L)
 	return 0;
 }
 
+static int
+lbox_cfg_set_replication_compression(struct lua_State *L)
+{
+	(void) L;
+	box_set_replication_compression();
+	return 0;
+}
+
+static int
+lbox_cfg_set_replication_feed_size(struct lua_State *L)
+{
+	if (box_set_replication_feed_size() != 0)
+		luaT_error(L);
+	return 0;
+}
+
+static int
+lbox_cfg_set_replication_spaces(struct lua_State *L)
+{
+	if (box_set_replication_spaces() != 0)
+		luaT_error(L);
+	return 0;
+}
+
 static int
 lbox_cfg_set_crash(struct lua_State *L)
 {
@@ -430,6 +513,10 @@ box_lua_cfg_init(struct lua_State *L)
 		{"cfg_set_replication", lbox_cfg_set_replication},
 		{"cfg_set_worker_pool_threads", lbox_cfg_set_worker_pool_threads},
 		{"cfg_set_readahead", lbox_cfg_set_readahead},
+		{"cfg_set_iproto_compression_threshold", lbox_cfg_set_iproto_compression_threshold},
+		{"cfg_set_iproto_max_decompressed_size", lbox_cfg_set_iproto_max_decompressed_size},
+		{"cfg_set_iproto_connection_msg_max", lbox_cfg_set_iproto_connection_msg_max},
+		{"cfg_set_iproto_queue_delay_target", lbox_cfg_set_iproto_queue_delay_target},
 		{"cfg_set_io_collect_interval", lbox_cfg_set_io_collect_interval},
 		{"cfg_set_too_long_threshold", lbox_cfg_set_too_long_threshold},
 		{"cfg_set_snap_io_rate_limit", lbox_cfg_set_snap_io_rate_limit},
@@ -437,10 +524,14 @@ box_lua_cfg_init(struct lua_State *L)
 		{"cfg_set_checkpoint_interval", lbox_cfg_set_checkpoint_interval},
 		{"cfg_set_checkpoint_wal_threshold", lbox_cfg_set_checkpoint_wal_threshold},
 		{"cfg_set_wal_queue_max_size", lbox_cfg_set_wal_queue_max_size},
+		{"cfg_set_wal_group_commit_max_delay", lbox_cfg_set_wal_group_commit_max_delay},
+		{"cfg_set_wal_fsync", lbox_cfg_set_wal_fsync},
 		{"cfg_set_wal_cleanup_delay", lbox_cfg_set_wal_cleanup_delay},
 		{"cfg_set_read_only", lbox_cfg_set_read_only},
 		{"cfg_set_memtx_memory", lbox_cfg_set_memtx_memory},
 		{"cfg_set_memtx_max_tuple_size", lbox_cfg_set_memtx_max_tuple_size},
+		{"cfg_set_memtx_checkpoint_threads",
+			lbox_cfg_set_memtx_checkpoint_threads},
 		{"cfg_set_vinyl_memory", lbox_cfg_set_vinyl_memory},
 		{"cfg_set_vinyl_max_tuple_size", lbox_cfg_set_vinyl_max_tuple_size},
 		{"cfg_set_vinyl_cache", lbox_cfg_set_vinyl_cache},
@@ -456,6 +547,9 @@ box_lua_cfg_init(struct lua_State *L)
 		{"cfg_set_replication_synchro_timeout", lbox_cfg_set_replication_synchro_timeout},
 		{"cfg_set_replication_sync_timeout", lbox_cfg_set_replication_sync_timeout},
 		{"cfg_set_replication_skip_conflict", lbox_cfg_set_replication_skip_conflict},
+		{"cfg_set_replication_compression", lbox_cfg_set_replication_compression},
+		{"cfg_set_replication_feed_size", lbox_cfg_set_replication_feed_size},
+		{"cfg_set_replication_spaces", lbox_cfg_set_replication_spaces},
 		{"cfg_set_replication_anon", lbox_cfg_set_replication_anon},
 		{"cfg_set_net_msg_max", lbox_cfg_set_net_msg_max},
 		{"cfg_set_sql_cache_size", lbox_set_prepared_stmt_cache_size},
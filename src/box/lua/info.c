@@ -147,6 +147,30 @@ lbox_pushrelay(lua_State *L, struct relay *relay)
 		lua_pushstring(L, "lag");
 		lua_pushnumber(L, relay_txn_lag(relay));
 		lua_settable(L, -3);
+		int64_t bytes_in, bytes_out;
+		if (relay_compression_stat(relay, &bytes_in, &bytes_out)) {
+			lua_pushstring(L, "compression");
+			lua_createtable(L, 0, 2);
+			lua_pushstring(L, "bytes_in");
+			luaL_pushint64(L, bytes_in);
+			lua_settable(L, -3);
+			lua_pushstring(L, "bytes_out");
+			luaL_pushint64(L, bytes_out);
+			lua_settable(L, -3);
+			lua_settable(L, -3);
+		}
+		int64_t hits, misses;
+		if (relay_feed_stat(relay, &hits, &misses)) {
+			lua_pushstring(L, "feed");
+			lua_createtable(L, 0, 2);
+			lua_pushstring(L, "hits");
+			luaL_pushint64(L, hits);
+			lua_settable(L, -3);
+			lua_pushstring(L, "misses");
+			luaL_pushint64(L, misses);
+			lua_settable(L, -3);
+			lua_settable(L, -3);
+		}
 		break;
 	case RELAY_STOPPED:
 	{
@@ -589,6 +613,34 @@ lbox_info_sql(struct lua_State *L)
 	return 1;
 }
 
+static int
+lbox_info_wal_call(struct lua_State *L)
+{
+	struct info_handler h;
+	luaT_info_handler_create(&h, L);
+	wal_stat(&h);
+	const struct vclock *synced_vclock = wal_synced_vclock();
+	if (synced_vclock != NULL) {
+		lua_pushstring(L, "synced_vclock");
+		lbox_pushvclock(L, synced_vclock);
+		lua_settable(L, -3);
+	}
+	return 1;
+}
+
+static int
+lbox_info_wal(struct lua_State *L)
+{
+	lua_newtable(L);
+	lua_newtable(L); /* metatable */
+	lua_pushstring(L, "__call");
+	lua_pushcfunction(L, lbox_info_wal_call);
+	lua_settable(L, -3);
+
+	lua_setmetatable(L, -2);
+	return 1;
+}
+
 static int
 lbox_info_listen(struct lua_State *L)
 {
@@ -674,6 +726,7 @@ static const struct luaL_Reg lbox_info_dynamic_meta[] = {
 	{"gc", lbox_info_gc},
 	{"vinyl", lbox_info_vinyl},
 	{"sql", lbox_info_sql},
+	{"wal", lbox_info_wal},
 	{"listen", lbox_info_listen},
 	{"election", lbox_info_election},
 	{"synchro", lbox_info_synchro},
@@ -42,6 +42,7 @@ local default_cfg = {
     strip_core          = true,
     memtx_min_tuple_size = 16,
     memtx_max_tuple_size = 1024 * 1024,
+    memtx_checkpoint_threads = 1,
     slab_alloc_granularity = 8,
     slab_alloc_factor   = 1.05,
     iproto_threads      = 1,
@@ -85,12 +86,20 @@ local default_cfg = {
 
     io_collect_interval = nil,
     readahead           = 16320,
+    iproto_compression_threshold = 4096,
+    iproto_max_decompressed_size = 16 * 1024 * 1024,
+    iproto_connection_msg_max = 0,
+    iproto_queue_delay_target = 0,
     snap_io_rate_limit  = nil, -- no limit
     too_long_threshold  = 0.5,
     wal_mode            = "write",
     wal_max_size        = 256 * 1024 * 1024,
     wal_dir_rescan_delay= 2,
     wal_queue_max_size  = 16 * 1024 * 1024,
+    wal_group_commit_max_delay = 0,
+    wal_compression_threads = 0,
+    wal_fsync_interval  = 0,
+    wal_fsync_bytes     = 0,
     wal_cleanup_delay   = 4 * 3600,
     wal_ext             = nil,
     force_recovery      = false,
@@ -120,8 +129,12 @@ local default_cfg = {
     replication_connect_timeout = 30,
     replication_connect_quorum = nil, -- connect all
     replication_skip_conflict = false,
+    replication_compression = false,
+    replication_feed_size = 0,
+    replication_spaces    = nil,
     replication_anon      = false,
     replication_threads   = 1,
+    replication_relay_threads = 0,
     feedback_enabled      = true,
     feedback_crashinfo    = true,
     feedback_host         = "https://feedback.tarantool.io",
@@ -169,6 +182,7 @@ local template_cfg = {
     strip_core          = 'boolean',
     memtx_min_tuple_size  = 'number',
     memtx_max_tuple_size  = 'number',
+    memtx_checkpoint_threads = 'number',
     slab_alloc_granularity = 'number',
     slab_alloc_factor   = 'number',
     iproto_threads      = 'number',
@@ -212,6 +226,10 @@ local template_cfg = {
 
     io_collect_interval = 'number',
     readahead           = 'number',
+    iproto_compression_threshold = 'number',
+    iproto_max_decompressed_size = 'number',
+    iproto_connection_msg_max = 'number',
+    iproto_queue_delay_target = 'number',
     snap_io_rate_limit  = 'number',
     too_long_threshold  = 'number',
     wal_mode            = 'string',
@@ -231,6 +249,10 @@ local template_cfg = {
     checkpoint_interval = 'number',
     checkpoint_wal_threshold = 'number',
     wal_queue_max_size  = 'number',
+    wal_group_commit_max_delay = 'number',
+    wal_compression_threads = 'number',
+    wal_fsync_interval  = 'number',
+    wal_fsync_bytes     = 'number',
     checkpoint_count    = 'number',
     read_only           = 'boolean',
     hot_standby         = 'boolean',
@@ -248,8 +270,12 @@ local template_cfg = {
     replication_connect_timeout = 'number',
     replication_connect_quorum = 'number',
     replication_skip_conflict = 'boolean',
+    replication_compression = 'boolean',
+    replication_feed_size = 'number',
+    replication_spaces    = 'number, table',
     replication_anon      = 'boolean',
     replication_threads   = 'number',
+    replication_relay_threads = 'number',
     feedback_enabled      = ifdef_feedback('boolean'),
     feedback_crashinfo    = ifdef_feedback('boolean'),
     feedback_host         = ifdef_feedback('string'),
@@ -334,11 +360,16 @@ local dynamic_cfg = {
     log_format              = log.box_api.cfg_set_log_format,
     io_collect_interval     = private.cfg_set_io_collect_interval,
     readahead               = private.cfg_set_readahead,
+    iproto_compression_threshold = private.cfg_set_iproto_compression_threshold,
+    iproto_max_decompressed_size = private.cfg_set_iproto_max_decompressed_size,
+    iproto_connection_msg_max = private.cfg_set_iproto_connection_msg_max,
+    iproto_queue_delay_target = private.cfg_set_iproto_queue_delay_target,
     too_long_threshold      = private.cfg_set_too_long_threshold,
     snap_io_rate_limit      = private.cfg_set_snap_io_rate_limit,
     read_only               = private.cfg_set_read_only,
     memtx_memory            = private.cfg_set_memtx_memory,
     memtx_max_tuple_size    = private.cfg_set_memtx_max_tuple_size,
+    memtx_checkpoint_threads = private.cfg_set_memtx_checkpoint_threads,
     vinyl_memory            = private.cfg_set_vinyl_memory,
     vinyl_max_tuple_size    = private.cfg_set_vinyl_max_tuple_size,
     vinyl_cache             = private.cfg_set_vinyl_cache,
@@ -348,6 +379,9 @@ local dynamic_cfg = {
     checkpoint_interval     = private.cfg_set_checkpoint_interval,
     checkpoint_wal_threshold = private.cfg_set_checkpoint_wal_threshold,
     wal_queue_max_size      = private.cfg_set_wal_queue_max_size,
+    wal_group_commit_max_delay = private.cfg_set_wal_group_commit_max_delay,
+    wal_fsync_interval      = private.cfg_set_wal_fsync,
+    wal_fsync_bytes         = private.cfg_set_wal_fsync,
     worker_pool_threads     = private.cfg_set_worker_pool_threads,
     feedback_enabled        = ifdef_feedback_set_params,
     feedback_crashinfo      = ifdef_feedback_set_params,
@@ -371,6 +405,9 @@ local dynamic_cfg = {
     replication_synchro_quorum = private.cfg_set_replication_synchro_quorum,
     replication_synchro_timeout = private.cfg_set_replication_synchro_timeout,
     replication_skip_conflict = private.cfg_set_replication_skip_conflict,
+    replication_compression = private.cfg_set_replication_compression,
+    replication_feed_size = private.cfg_set_replication_feed_size,
+    replication_spaces      = private.cfg_set_replication_spaces,
     replication_anon        = private.cfg_set_replication_anon,
     instance_uuid           = check_instance_uuid,
     replicaset_uuid         = check_replicaset_uuid,
@@ -470,6 +507,9 @@ local dynamic_cfg_skip_at_load = {
     replication_synchro_quorum = true,
     replication_synchro_timeout = true,
     replication_skip_conflict = true,
+    replication_compression = true,
+    replication_feed_size = true,
+    replication_spaces      = true,
     replication_anon        = true,
     wal_dir_rescan_delay    = true,
     custom_proc_title       = true,
@@ -478,6 +518,10 @@ local dynamic_cfg_skip_at_load = {
     replicaset_uuid         = true,
     net_msg_max             = true,
     readahead               = true,
+    iproto_compression_threshold = true,
+    iproto_max_decompressed_size = true,
+    iproto_connection_msg_max = true,
+    iproto_queue_delay_target = true,
 }
 
 local function convert_gb(size)
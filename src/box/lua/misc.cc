@@ -183,10 +183,10 @@ port_msgpack_dump_lua(struct port *base, struct lua_State *L, bool is_flat)
 static int
 lbox_select(lua_State *L)
 {
-	if (lua_gettop(L) != 6 || !lua_isnumber(L, 1) || !lua_isnumber(L, 2) ||
+	if (lua_gettop(L) != 8 || !lua_isnumber(L, 1) || !lua_isnumber(L, 2) ||
 		!lua_isnumber(L, 3) || !lua_isnumber(L, 4) || !lua_isnumber(L, 5)) {
 		return luaL_error(L, "Usage index:select(iterator, offset, "
-				  "limit, key)");
+				  "limit, key, after, fetch_pos)");
 	}
 
 	uint32_t space_id = lua_tonumber(L, 1);
@@ -198,9 +198,22 @@ lbox_select(lua_State *L)
 	size_t key_len;
 	const char *key = lbox_encode_tuple_on_gc(L, 6, &key_len);
 
+	const char *packed_pos = NULL;
+	const char *packed_pos_end = NULL;
+	if (!lua_isnil(L, 7)) {
+		size_t pos_len;
+		packed_pos = lua_tolstring(L, 7, &pos_len);
+		packed_pos_end = packed_pos + pos_len;
+	}
+	bool fetch_pos = lua_toboolean(L, 8);
+
+	struct region *region = &fiber()->gc;
+	size_t region_svp = region_used(region);
 	struct port port;
 	if (box_select(space_id, index_id, iterator, offset, limit,
-		       key, key + key_len, &port) != 0) {
+		       key, key + key_len, &packed_pos, &packed_pos_end,
+		       fetch_pos, &port) != 0) {
+		region_truncate(region, region_svp);
 		return luaT_error(L);
 	}
 
@@ -215,7 +228,16 @@ lbox_select(lua_State *L)
 	 */
 	port_dump_lua(&port, L, false);
 	port_destroy(&port);
-	return 1; /* lua table with tuples */
+	if (!fetch_pos) {
+		region_truncate(region, region_svp);
+		return 1; /* lua table with tuples */
+	}
+	if (packed_pos != NULL)
+		lua_pushlstring(L, packed_pos, packed_pos_end - packed_pos);
+	else
+		lua_pushnil(L);
+	region_truncate(region, region_svp);
+	return 2; /* lua table with tuples and the iterator position */
 }
 
 /* }}} */
@@ -40,6 +40,7 @@
 
 #include <small/ibuf.h>
 #include <msgpuck.h> /* mp_store_u32() */
+#include <zstd.h>
 #include "scramble.h"
 
 #include "box/iproto_constants.h"
@@ -49,6 +50,7 @@
 #include "box/tuple.h"
 #include "box/execute.h"
 #include "box/error.h"
+#include "box/mp_error.h"
 #include "box/schema_def.h"
 
 #include "lua/msgpack.h"
@@ -60,12 +62,14 @@
 #include "fiber_cond.h"
 #include "iostream.h"
 #include "box/errcode.h"
+#include "lua/error.h"
 #include "lua/fiber.h"
 #include "lua/fiber_cond.h"
 #include "lua/uri.h"
 #include "mpstream/mpstream.h"
 #include "misc.h" /* lbox_check_tuple_format() */
 #include "uri/uri.h"
+#include "tt_static.h"
 #include "version.h"
 
 #define cfg luaL_msgpack_default
@@ -82,11 +86,26 @@ enum {
 	/**
 	 * IPROTO protocol version supported by the netbox connector.
 	 */
-	NETBOX_IPROTO_VERSION = 3,
+	NETBOX_IPROTO_VERSION = 4,
+	/**
+	 * Minimal size of a request body to compress if compression
+	 * is enabled for the connection.
+	 */
+	NETBOX_COMPRESSION_THRESHOLD = 4096,
+	/** zstd level used for compression of requests. */
+	NETBOX_COMPRESSION_LEVEL = 1,
+	/**
+	 * Maximal size of a decompressed response body. The buffer
+	 * is allocated before decompression, so the size declared in
+	 * the frame must be checked.
+	 */
+	NETBOX_MAX_DECOMPRESSED_SIZE = 256 * 1024 * 1024,
 };
 
 /**
  * IPROTO protocol features supported by the netbox connector.
+ * IPROTO_FEATURE_COMPRESSION is requested only if the compression
+ * option is set for the connection.
  */
 static struct iproto_features NETBOX_IPROTO_FEATURES;
 
@@ -112,6 +131,9 @@ enum netbox_method {
 	NETBOX_COMMIT      = 18,
 	NETBOX_ROLLBACK    = 19,
 	NETBOX_INJECT      = 20,
+	NETBOX_SELECT_WITH_POS = 21,
+	NETBOX_BATCH       = 22,
+	NETBOX_SELECT_CHUNKED = 23,
 	netbox_method_MAX
 };
 
@@ -160,6 +182,11 @@ struct netbox_options {
 	 * Flag that determines is it required to fetch server schema or not.
 	 */
 	 bool fetch_schema;
+	/**
+	 * Compress big requests and ask the server to compress big
+	 * responses, if the server supports it.
+	 */
+	bool compression;
 };
 
 /**
@@ -251,6 +278,11 @@ struct netbox_transport {
 	struct ibuf send_buf;
 	/** Connection receive buffer. */
 	struct ibuf recv_buf;
+	/** Buffer for the decompressed body of the last response. */
+	struct ibuf decompress_buf;
+	/** zstd contexts, created on demand. */
+	ZSTD_CCtx *zstd_cctx;
+	ZSTD_DCtx *zstd_dctx;
 	/** Signalled when send_buf becomes empty. */
 	struct fiber_cond on_send_buf_empty;
 	/** Next request id. */
@@ -501,6 +533,10 @@ netbox_transport_create(struct netbox_transport *transport)
 	iostream_clear(&transport->io);
 	ibuf_create(&transport->send_buf, &cord()->slabc, NETBOX_READAHEAD);
 	ibuf_create(&transport->recv_buf, &cord()->slabc, NETBOX_READAHEAD);
+	ibuf_create(&transport->decompress_buf, &cord()->slabc,
+		    NETBOX_READAHEAD);
+	transport->zstd_cctx = NULL;
+	transport->zstd_dctx = NULL;
 	fiber_cond_create(&transport->on_send_buf_empty);
 	transport->next_sync = 1;
 	transport->requests = mh_i64ptr_new();
@@ -520,6 +556,9 @@ netbox_transport_destroy(struct netbox_transport *transport)
 	assert(!iostream_is_initialized(&transport->io));
 	assert(ibuf_used(&transport->send_buf) == 0);
 	assert(ibuf_used(&transport->recv_buf) == 0);
+	ibuf_destroy(&transport->decompress_buf);
+	ZSTD_freeCCtx(transport->zstd_cctx);
+	ZSTD_freeDCtx(transport->zstd_dctx);
 	fiber_cond_destroy(&transport->on_send_buf_empty);
 	struct mh_i64ptr_t *h = transport->requests;
 	assert(mh_size(h) == 0);
@@ -645,16 +684,17 @@ netbox_encode_ping(lua_State *L, int idx, struct mpstream *stream,
  * Raises a Lua error on memory allocation failure.
  */
 static void
-netbox_encode_id(struct lua_State *L, struct ibuf *ibuf, uint64_t sync)
+netbox_encode_id(struct lua_State *L, struct ibuf *ibuf, uint64_t sync,
+		 bool compression)
 {
-	struct iproto_features *features = &NETBOX_IPROTO_FEATURES;
+	struct iproto_features features_value = NETBOX_IPROTO_FEATURES;
+	struct iproto_features *features = &features_value;
+	if (compression)
+		iproto_features_set(features, IPROTO_FEATURE_COMPRESSION);
 #ifndef NDEBUG
-	struct iproto_features features_value;
 	struct errinj *errinj = errinj(ERRINJ_NETBOX_FLIP_FEATURE, ERRINJ_INT);
 	if (errinj->iparam >= 0 && errinj->iparam < iproto_feature_id_MAX) {
 		int feature_id = errinj->iparam;
-		features_value = *features;
-		features = &features_value;
 		if (iproto_features_test(features, feature_id))
 			iproto_features_clear(features, feature_id);
 		else
@@ -785,14 +825,26 @@ netbox_encode_eval(lua_State *L, int idx, struct mpstream *stream,
 }
 
 static void
-netbox_encode_select(lua_State *L, int idx, struct mpstream *stream,
-		     uint64_t sync, uint64_t stream_id)
+netbox_encode_select_impl(lua_State *L, int idx, struct mpstream *stream,
+			  uint64_t sync, uint64_t stream_id, bool fetch_pos)
 {
-	/* Lua stack at idx: space_id, index_id, iterator, offset, limit, key */
+	/*
+	 * Lua stack at idx: space_id, index_id, iterator, offset, limit, key,
+	 * after, chunk_size
+	 */
 	size_t svp = netbox_begin_encode(stream, sync, IPROTO_SELECT,
 					 stream_id);
 
-	mpstream_encode_map(stream, 6);
+	size_t after_len = 0;
+	const char *after = NULL;
+	if (!lua_isnoneornil(L, idx + 6))
+		after = lua_tolstring(L, idx + 6, &after_len);
+	uint32_t chunk_size = 0;
+	if (!lua_isnoneornil(L, idx + 7))
+		chunk_size = lua_tonumber(L, idx + 7);
+
+	mpstream_encode_map(stream, 6 + (after != NULL) + fetch_pos +
+			    (chunk_size != 0));
 
 	uint32_t space_id = lua_tonumber(L, idx);
 	uint32_t index_id = lua_tonumber(L, idx + 1);
@@ -824,9 +876,37 @@ netbox_encode_select(lua_State *L, int idx, struct mpstream *stream,
 	mpstream_encode_uint(stream, IPROTO_KEY);
 	luamp_convert_key(L, cfg, stream, idx + 5);
 
+	/* encode iterator position */
+	if (after != NULL) {
+		mpstream_encode_uint(stream, IPROTO_AFTER_POSITION);
+		mpstream_encode_strn(stream, after, after_len);
+	}
+	if (fetch_pos) {
+		mpstream_encode_uint(stream, IPROTO_FETCH_POSITION);
+		mpstream_encode_bool(stream, true);
+	}
+	if (chunk_size != 0) {
+		mpstream_encode_uint(stream, IPROTO_CHUNK_SIZE);
+		mpstream_encode_uint(stream, chunk_size);
+	}
+
 	netbox_end_encode(stream, svp);
 }
 
+static void
+netbox_encode_select(lua_State *L, int idx, struct mpstream *stream,
+		     uint64_t sync, uint64_t stream_id)
+{
+	netbox_encode_select_impl(L, idx, stream, sync, stream_id, false);
+}
+
+static void
+netbox_encode_select_with_pos(lua_State *L, int idx, struct mpstream *stream,
+			      uint64_t sync, uint64_t stream_id)
+{
+	netbox_encode_select_impl(L, idx, stream, sync, stream_id, true);
+}
+
 static void
 netbox_encode_insert_or_replace(lua_State *L, int idx, struct mpstream *stream,
 				uint64_t sync, enum iproto_type type,
@@ -957,6 +1037,93 @@ netbox_encode_upsert(lua_State *L, int idx, struct mpstream *stream,
 	netbox_end_encode(stream, svp);
 }
 
+/**
+ * Encodes a request of a batch. Lua stack top: an array
+ * {type, space_id, index_id, key, tuple, ops, iterator, offset, limit},
+ * where all fields but type and space_id may be nil.
+ */
+static void
+netbox_encode_batch_request(lua_State *L, struct mpstream *stream)
+{
+	int idx = lua_gettop(L);
+	/* Push the request fields to the stack, idx + 1 .. idx + 9. */
+	for (int i = 1; i <= 9; i++)
+		lua_rawgeti(L, idx, i);
+	uint32_t type = lua_tointeger(L, idx + 1);
+	bool has_index_base = type == IPROTO_UPDATE || type == IPROTO_UPSERT;
+	uint32_t map_size = 2 + has_index_base;
+	for (int i = 3; i <= 9; i++)
+		map_size += !lua_isnil(L, idx + i);
+	mpstream_encode_map(stream, map_size);
+
+	mpstream_encode_uint(stream, IPROTO_REQUEST_TYPE);
+	mpstream_encode_uint(stream, type);
+	mpstream_encode_uint(stream, IPROTO_SPACE_ID);
+	mpstream_encode_uint(stream, lua_tointeger(L, idx + 2));
+	if (has_index_base) {
+		mpstream_encode_uint(stream, IPROTO_INDEX_BASE);
+		mpstream_encode_uint(stream, 1);
+	}
+	if (!lua_isnil(L, idx + 3)) {
+		mpstream_encode_uint(stream, IPROTO_INDEX_ID);
+		mpstream_encode_uint(stream, lua_tointeger(L, idx + 3));
+	}
+	if (!lua_isnil(L, idx + 4)) {
+		mpstream_encode_uint(stream, IPROTO_KEY);
+		luamp_convert_key(L, cfg, stream, idx + 4);
+	}
+	if (!lua_isnil(L, idx + 5)) {
+		mpstream_encode_uint(stream, IPROTO_TUPLE);
+		luamp_encode_tuple(L, cfg, stream, idx + 5);
+	}
+	if (!lua_isnil(L, idx + 6)) {
+		mpstream_encode_uint(stream, IPROTO_OPS);
+		luamp_encode_tuple(L, cfg, stream, idx + 6);
+	}
+	if (!lua_isnil(L, idx + 7)) {
+		mpstream_encode_uint(stream, IPROTO_ITERATOR);
+		mpstream_encode_uint(stream, lua_tointeger(L, idx + 7));
+	}
+	if (!lua_isnil(L, idx + 8)) {
+		mpstream_encode_uint(stream, IPROTO_OFFSET);
+		mpstream_encode_uint(stream, lua_tointeger(L, idx + 8));
+	}
+	if (!lua_isnil(L, idx + 9)) {
+		mpstream_encode_uint(stream, IPROTO_LIMIT);
+		mpstream_encode_uint(stream, lua_tonumber(L, idx + 9));
+	}
+	lua_settop(L, idx);
+}
+
+static void
+netbox_encode_batch(lua_State *L, int idx, struct mpstream *stream,
+		    uint64_t sync, uint64_t stream_id)
+{
+	/* Lua stack at idx: requests, is_atomic */
+	size_t svp = netbox_begin_encode(stream, sync, IPROTO_BATCH,
+					 stream_id);
+	bool is_atomic = lua_toboolean(L, idx + 1);
+	mpstream_encode_map(stream, 1 + is_atomic);
+
+	/* encode requests */
+	mpstream_encode_uint(stream, IPROTO_REQUESTS);
+	uint32_t count = lua_objlen(L, idx);
+	mpstream_encode_array(stream, count);
+	for (uint32_t i = 1; i <= count; i++) {
+		lua_rawgeti(L, idx, i);
+		netbox_encode_batch_request(L, stream);
+		lua_pop(L, 1);
+	}
+
+	/* encode is_atomic */
+	if (is_atomic) {
+		mpstream_encode_uint(stream, IPROTO_IS_ATOMIC);
+		mpstream_encode_bool(stream, true);
+	}
+
+	netbox_end_encode(stream, svp);
+}
+
 /**
  * Connects a transport to a remote host and reads a greeting message.
  * Returns 0 on success, -1 on error.
@@ -1099,6 +1266,107 @@ io_error:
 	return -1;
 }
 
+/**
+ * Allocates the buffer for the decompressed body of a response, see
+ * xrow_decompress(). The buffer is reused for every response.
+ */
+static void *
+netbox_transport_alloc_body(void *ctx, size_t size)
+{
+	struct netbox_transport *transport = ctx;
+	if (size > NETBOX_MAX_DECOMPRESSED_SIZE) {
+		diag_set(ClientError, ER_DECOMPRESSION,
+			 tt_sprintf("body size %zu is too big", size));
+		return NULL;
+	}
+	struct ibuf *buf = &transport->decompress_buf;
+	ibuf_reset(buf);
+	void *body = ibuf_alloc(buf, size);
+	if (body == NULL)
+		diag_set(OutOfMemory, size, "ibuf_alloc", "body");
+	return body;
+}
+
+/**
+ * Decompresses the body of a response compressed by the server and makes
+ * the response header point to the decompressed body. The body is valid
+ * until the next response is received. Returns 0 on success, -1 on error.
+ */
+static int
+netbox_transport_decompress(struct netbox_transport *transport,
+			    struct xrow_header *hdr)
+{
+	if (transport->zstd_dctx == NULL) {
+		transport->zstd_dctx = ZSTD_createDCtx();
+		if (transport->zstd_dctx == NULL) {
+			diag_set(ClientError, ER_DECOMPRESSION,
+				 "failed to create context");
+			return -1;
+		}
+	}
+	return xrow_decompress(hdr, transport->zstd_dctx,
+			       netbox_transport_alloc_body, transport);
+}
+
+/**
+ * Compresses the body of the request written to the send buffer at
+ * the given offset if it is big enough and the server supports
+ * compression. Leaves the request as is if compression fails or
+ * doesn't make it smaller.
+ */
+static void
+netbox_transport_compress_request(struct netbox_transport *transport,
+				  size_t offset)
+{
+	if (!transport->opts.compression ||
+	    !iproto_features_test(&transport->features,
+				  IPROTO_FEATURE_COMPRESSION))
+		return;
+	struct ibuf *ibuf = &transport->send_buf;
+	size_t fixheader_size = mp_sizeof_uint(UINT32_MAX);
+	char *fixheader = ibuf->rpos + offset;
+	char *header = fixheader + fixheader_size;
+	const char *body = header;
+	mp_next(&body);
+	size_t body_len = ibuf->wpos - body;
+	if (body_len <= NETBOX_COMPRESSION_THRESHOLD)
+		return;
+	if (transport->zstd_cctx == NULL) {
+		transport->zstd_cctx = ZSTD_createCCtx();
+		if (transport->zstd_cctx == NULL)
+			return;
+	}
+	size_t bound = ZSTD_compressBound(body_len);
+	struct region *region = &fiber()->gc;
+	size_t region_svp = region_used(region);
+	char *zbody = region_alloc(region, bound);
+	if (zbody == NULL)
+		return;
+	size_t zlen = ZSTD_compressCCtx(transport->zstd_cctx, zbody, bound,
+					body, body_len,
+					NETBOX_COMPRESSION_LEVEL);
+	/* IPROTO_COMPRESSION key and value, MP_BIN header. */
+	size_t overhead = 2 + mp_sizeof_binl(zlen);
+	if (!ZSTD_isError(zlen) && zlen + overhead < body_len) {
+		/*
+		 * The header is encoded by netbox_begin_encode() with
+		 * a few keys, so the map header size doesn't change.
+		 */
+		const char *pos = header;
+		uint32_t map_size = mp_decode_map(&pos);
+		assert(mp_sizeof_map(map_size + 1) == mp_sizeof_map(map_size));
+		mp_encode_map(header, map_size + 1);
+		char *data = (char *)body;
+		data = mp_encode_uint(data, IPROTO_COMPRESSION);
+		data = mp_encode_uint(data, IPROTO_COMPRESSION_ZSTD);
+		data = mp_encode_binl(data, zlen);
+		memcpy(data, zbody, zlen);
+		ibuf->wpos = data + zlen;
+		mp_store_u32(fixheader + 1, ibuf->wpos - header);
+	}
+	region_truncate(region, region_svp);
+}
+
 /**
  * Sends and receives data over an iproto connection.
  * Returns 0 and a decoded response header on success.
@@ -1122,9 +1390,14 @@ netbox_transport_send_and_recv(struct netbox_transport *transport,
 			if (data_len >= required) {
 				const char *body_end = rpos + len;
 				transport->recv_buf.rpos = (char *)body_end;
-				return xrow_header_decode(
-					hdr, &rpos, body_end,
-					/*end_is_exact=*/true);
+				if (xrow_header_decode(hdr, &rpos, body_end,
+						       /*end_is_exact=*/true) != 0)
+					return -1;
+				if (hdr->compression ==
+				    IPROTO_COMPRESSION_NONE)
+					return 0;
+				return netbox_transport_decompress(transport,
+								   hdr);
 			}
 		}
 		if (netbox_transport_communicate(transport, required) != 0)
@@ -1296,6 +1569,9 @@ netbox_encode_method(struct lua_State *L, int idx, enum netbox_method method,
 		[NETBOX_COMMIT]         = netbox_encode_commit,
 		[NETBOX_ROLLBACK]       = netbox_encode_rollback,
 		[NETBOX_INJECT]		= netbox_encode_inject,
+		[NETBOX_SELECT_WITH_POS] = netbox_encode_select_with_pos,
+		[NETBOX_BATCH]		= netbox_encode_batch,
+		[NETBOX_SELECT_CHUNKED]	= netbox_encode_select,
 	};
 	struct mpstream stream;
 	mpstream_init(&stream, ibuf, ibuf_reserve_cb, ibuf_alloc_cb,
@@ -1436,6 +1712,80 @@ netbox_decode_select(struct lua_State *L, const char **data,
 	}
 }
 
+/**
+ * Decodes Tarantool response body consisting of IPROTO_DATA and optional
+ * IPROTO_POSITION keys and pushes a table {tuples, position} to Lua stack.
+ * The position is nil if the response has none.
+ */
+static void
+netbox_decode_select_with_pos(struct lua_State *L, const char **data,
+			      const char *data_end, bool return_raw,
+			      struct tuple_format *format)
+{
+	if (return_raw) {
+		luamp_push(L, *data, data_end);
+		*data = data_end;
+		return;
+	}
+	assert(mp_typeof(**data) == MP_MAP);
+	uint32_t map_size = mp_decode_map(data);
+	lua_createtable(L, 2, 0);
+	for (uint32_t i = 0; i < map_size; i++) {
+		uint32_t key = mp_decode_uint(data);
+		if (key == IPROTO_DATA) {
+			netbox_decode_data(L, data, format);
+			lua_rawseti(L, -2, 1);
+		} else if (key == IPROTO_POSITION) {
+			uint32_t len;
+			const char *pos = mp_decode_str(data, &len);
+			lua_pushlstring(L, pos, len);
+			lua_rawseti(L, -2, 2);
+		} else {
+			mp_next(data);
+		}
+	}
+}
+
+/**
+ * Decodes the response to a BATCH request and pushes a table {results, error}
+ * to Lua stack, where results is an array of tuple arrays, one per executed
+ * request, and error is the error of the failed request or nil.
+ */
+static void
+netbox_decode_batch(struct lua_State *L, const char **data,
+		    const char *data_end, bool return_raw,
+		    struct tuple_format *format)
+{
+	if (return_raw) {
+		luamp_push(L, *data, data_end);
+		*data = data_end;
+		return;
+	}
+	assert(mp_typeof(**data) == MP_MAP);
+	uint32_t map_size = mp_decode_map(data);
+	lua_createtable(L, 2, 0);
+	for (uint32_t i = 0; i < map_size; i++) {
+		uint32_t key = mp_decode_uint(data);
+		if (key == IPROTO_DATA) {
+			uint32_t count = mp_decode_array(data);
+			lua_createtable(L, count, 0);
+			for (uint32_t j = 0; j < count; j++) {
+				netbox_decode_data(L, data, format);
+				lua_rawseti(L, -2, j + 1);
+			}
+			lua_rawseti(L, -2, 1);
+		} else if (key == IPROTO_ERROR) {
+			struct error *e = error_unpack_unsafe(data);
+			if (e == NULL)
+				luaT_error(L);
+			luaT_pusherror(L, e);
+			lua_rawseti(L, -2, 2);
+		} else {
+			mp_next(data);
+		}
+	}
+}
+
 /**
  * Same as netbox_decode_select, but only decodes the first tuple of the array,
  * skipping the rest.
@@ -1720,6 +2070,9 @@ netbox_decode_method(struct lua_State *L, enum netbox_method method,
 		[NETBOX_COMMIT]         = netbox_decode_nil,
 		[NETBOX_ROLLBACK]       = netbox_decode_nil,
 		[NETBOX_INJECT]		= netbox_decode_table,
+		[NETBOX_SELECT_WITH_POS] = netbox_decode_select_with_pos,
+		[NETBOX_BATCH]		= netbox_decode_batch,
+		[NETBOX_SELECT_CHUNKED]	= netbox_decode_select,
 	};
 	method_decoder[method](L, data, data_end, return_raw, format);
 }
@@ -2044,7 +2397,7 @@ luaT_netbox_request_pairs(struct lua_State *L)
 static int
 luaT_netbox_new_transport(struct lua_State *L)
 {
-	assert(lua_gettop(L) == 7);
+	assert(lua_gettop(L) == 8);
 	/* Create a transport object. */
 	struct netbox_transport *transport;
 	transport = lua_newuserdata(L, sizeof(*transport));
@@ -2068,6 +2421,7 @@ luaT_netbox_new_transport(struct lua_State *L)
 		opts->reconnect_after = luaL_checknumber(L, 6);
 	if (!lua_isnil(L, 7))
 		opts->fetch_schema = lua_toboolean(L, 7);
+	opts->compression = lua_toboolean(L, 8);
 	if (opts->user == NULL && opts->password != NULL) {
 		diag_set(ClientError, ER_PROC_LUA,
 			 "net.box: user is not defined");
@@ -2131,8 +2485,11 @@ luaT_netbox_transport_make_request(struct lua_State *L, int idx,
 	uint64_t stream_id = luaL_touint64(L, arg++);
 	enum netbox_method method = lua_tointeger(L, arg++);
 	assert(method < netbox_method_MAX);
+	size_t offset = ibuf_used(&transport->send_buf);
 	netbox_encode_method(L, arg++, method, &transport->send_buf, sync,
 			     stream_id);
+	if (method != NETBOX_INJECT)
+		netbox_transport_compress_request(transport, offset);
 	transport->inprogress_request_count++;
 
 	/* Initialize and register the request object. */
@@ -2368,8 +2725,12 @@ netbox_transport_dispatch_response(struct netbox_transport *transport,
 		memcpy(wpos, data, data_len);
 		lua_pushinteger(L, data_len);
 	} else {
-		/* Decode xrow.body[DATA] to Lua objects. */
-		if (status == IPROTO_OK) {
+		/*
+		 * Decode xrow.body[DATA] to Lua objects. A chunk of
+		 * a SELECT result is decoded as the final response.
+		 */
+		if (status == IPROTO_OK ||
+		    request->method == NETBOX_SELECT_CHUNKED) {
 			netbox_decode_method(L, request->method, &data,
 					     data_end, request->return_raw,
 					     request->format);
@@ -2417,7 +2778,8 @@ netbox_transport_do_id(struct netbox_transport *transport, struct lua_State *L)
 	ERROR_INJECT(ERRINJ_NETBOX_DISABLE_ID, goto out);
 	if (peer_version_id < version_id(2, 10, 0))
 		goto unsupported;
-	netbox_encode_id(L, &transport->send_buf, transport->next_sync++);
+	netbox_encode_id(L, &transport->send_buf, transport->next_sync++,
+			 transport->opts.compression);
 	struct xrow_header hdr;
 	if (netbox_transport_send_and_recv(transport, &hdr) != 0)
 		luaT_error(L);
@@ -46,6 +46,22 @@ local M_COMMIT      = 18
 local M_ROLLBACK    = 19
 -- Injects raw data into connection. Used by tests.
 local M_INJECT      = 20
+local M_SELECT_WITH_POS = 21
+local M_BATCH       = 22
+local M_SELECT_CHUNKED = 23
+
+-- Default number of tuples in a chunk of index:pairs() result.
+local PAIRS_CHUNK_SIZE = 1000
+
+-- Batch request name -> IPROTO request type.
+local BATCH_REQUEST_TYPES = {
+    select  = 1,
+    insert  = 2,
+    replace = 3,
+    update  = 4,
+    delete  = 5,
+    upsert  = 9,
+}
 
 -- IPROTO feature id -> name
 local IPROTO_FEATURE_NAMES = {
@@ -53,6 +69,7 @@ local IPROTO_FEATURE_NAMES = {
     [1]     = 'transactions',
     [2]     = 'error_extension',
     [3]     = 'watchers',
+    [4]     = 'compression',
 }
 
 -- Given an array of IPROTO feature ids, returns a map {feature_name: bool}.
@@ -404,7 +421,7 @@ local function new_sm(uri, opts)
     local transport = internal.new_transport(
             uri, user, password, weak_callback,
             opts.connect_timeout, opts.reconnect_after,
-            opts.fetch_schema)
+            opts.fetch_schema, opts.compression)
     weak_refs.transport = transport
     remote._transport = transport
     remote._gc_hook = ffi.gc(ffi.new('char[1]'), function()
@@ -850,6 +867,92 @@ function remote_methods:unprepare(query, parameters, sql_opts, netbox_opts)
                          query, parameters or {}, sql_opts or {})
 end
 
+-- Converts a request of a batch to the array expected by the encoder:
+-- {type, space_id, index_id, key, tuple, ops, iterator, offset, limit}.
+local function batch_request_convert(remote, request)
+    if type(request) ~= 'table' or
+       BATCH_REQUEST_TYPES[request[1]] == nil then
+        box.error(box.error.ILLEGAL_PARAMS,
+                  "batch request must be {'select'|'insert'|'replace'|" ..
+                  "'update'|'upsert'|'delete', space, ...}")
+    end
+    local name = request[1]
+    local space_id = request[2]
+    local space = remote.space ~= nil and remote.space[space_id] or nil
+    if space ~= nil then
+        space_id = space.id
+    elseif type(space_id) ~= 'number' then
+        box.error(box.error.NO_SUCH_SPACE, tostring(space_id))
+    end
+    local opts
+    if name == 'update' or name == 'select' then
+        opts = request[5]
+    elseif name == 'delete' then
+        opts = request[4]
+    end
+    local index_id = opts ~= nil and opts.index or nil
+    if type(index_id) == 'string' then
+        local index = space ~= nil and space.index[index_id] or nil
+        if index == nil then
+            box.error(box.error.NO_SUCH_INDEX_NAME, index_id,
+                      space ~= nil and space.name or tostring(space_id))
+        end
+        index_id = index.id
+    end
+    local t = BATCH_REQUEST_TYPES[name]
+    if name == 'select' then
+        local key = request[3]
+        local key_is_nil = (key == nil or
+                            (type(key) == 'table' and #key == 0))
+        local iterator, offset, limit = check_select_opts(opts, key_is_nil)
+        return {t, space_id, index_id, key, nil, nil,
+                iterator, offset, limit}
+    elseif name == 'insert' or name == 'replace' then
+        return {t, space_id, nil, nil, request[3]}
+    elseif name == 'update' then
+        -- Update operations are sent in IPROTO_TUPLE.
+        return {t, space_id, index_id, request[3], request[4]}
+    elseif name == 'upsert' then
+        return {t, space_id, nil, nil, request[3], request[4]}
+    else
+        return {t, space_id, index_id, request[3]}
+    end
+end
+
+-- Executes several requests in one network round trip. Requests are
+-- executed in order. If opts.is_atomic is set, they are executed in one
+-- transaction, otherwise the execution stops at the first failed request
+-- and the error is returned after the results of the preceding ones.
+-- The result of a select is an array of tuples, the result of other
+-- requests is a tuple or nil.
+function remote_methods:batch(requests, opts)
+    check_remote_arg(self, 'batch')
+    if type(requests) ~= 'table' then
+        box.error(box.error.ILLEGAL_PARAMS,
+                  'Usage: connection:batch({request, ...}[, opts])')
+    end
+    local converted = {}
+    for i, request in ipairs(requests) do
+        converted[i] = batch_request_convert(self, request)
+    end
+    local is_atomic = opts ~= nil and opts.is_atomic or false
+    local res = self:_request(M_BATCH, opts, nil, self._stream_id,
+                              converted, is_atomic)
+    if type(res) ~= 'table' or (opts and opts.is_async) then
+        return res
+    end
+    local results = res[1] or {}
+    for i = 1, #results do
+        if converted[i][1] ~= BATCH_REQUEST_TYPES.select then
+            results[i] = results[i][1]
+        end
+    end
+    if res[2] ~= nil then
+        return results, res[2]
+    end
+    return results
+end
+
 function remote_methods:wait_state(state, timeout)
     check_remote_arg(self, 'wait_state')
     local deadline = fiber_clock() + (timeout or TIMEOUT_INFINITY)
@@ -999,6 +1102,11 @@ space_metatable = function(remote)
         return check_primary_index(self):select(key, opts)
     end
 
+    function methods:pairs(key, opts)
+        check_space_arg(self, 'pairs')
+        return check_primary_index(self):pairs(key, opts)
+    end
+
     function methods:delete(key, opts)
         check_space_arg(self, 'delete')
         return check_primary_index(self):delete(key, opts)
@@ -1039,10 +1147,71 @@ index_metatable = function(remote)
         check_index_arg(self, 'select')
         local key_is_nil = (key == nil or
                             (type(key) == 'table' and #key == 0))
-        local iterator, offset, limit = check_select_opts(opts, key_is_nil)
-        return (remote:_request(M_SELECT, opts, self.space._format_cdata,
-                                self._stream_id, self.space.id, self.id,
-                                iterator, offset, limit, key))
+        local iterator, offset, limit, _, after, fetch_pos =
+            check_select_opts(opts, key_is_nil)
+        if not fetch_pos then
+            return (remote:_request(M_SELECT, opts, self.space._format_cdata,
+                                    self._stream_id, self.space.id, self.id,
+                                    iterator, offset, limit, key, after))
+        end
+        local res = remote:_request(M_SELECT_WITH_POS, opts,
+                                    self.space._format_cdata, self._stream_id,
+                                    self.space.id, self.id, iterator, offset,
+                                    limit, key, after)
+        if type(res) ~= 'table' or (opts and opts.is_async) then
+            return res
+        end
+        return res[1], res[2]
+    end
+
+    -- Iterates over the result of a SELECT that the server sends
+    -- in chunks of opts.chunk_size tuples. A chunk is released as
+    -- soon as the iterator moves to the next one.
+    --
+    -- If the index supports iterator positions (TREE), the server
+    -- selects the result chunk by chunk and may apply other requests
+    -- in between. So the result is a single read view only if it's
+    -- selected in a stream transaction with memtx_use_mvcc_engine
+    -- enabled on the server. Otherwise tuples changed during the
+    -- iteration may be seen in their new state or skipped.
+    function methods:pairs(key, opts)
+        check_index_arg(self, 'pairs')
+        local key_is_nil = (key == nil or
+                            (type(key) == 'table' and #key == 0))
+        local iterator, offset, limit, _, after =
+            check_select_opts(opts, key_is_nil)
+        local chunk_size = opts and opts.chunk_size or PAIRS_CHUNK_SIZE
+        local timeout = opts and opts.timeout
+        local messages = {}
+        local future, err = remote._transport:perform_async_request(
+            nil, nil, false, table.insert, messages, self.space._format_cdata,
+            self._stream_id, M_SELECT_CHUNKED, self.space.id, self.id,
+            iterator, offset, limit, key, after, chunk_size)
+        if err then
+            box.error(err)
+        end
+        local gen, param, state = future:pairs(timeout)
+        local chunk, pos, count = {}, 0, 0
+        return function()
+            while pos >= #chunk do
+                local i
+                i, chunk = gen(param, state)
+                if i == nil then
+                    -- The end of the result or box.NULL, error.
+                    if chunk ~= nil then
+                        box.error(chunk)
+                    end
+                    return nil
+                end
+                if messages[i] then
+                    messages[i] = false
+                end
+                state, pos = i, 0
+            end
+            pos = pos + 1
+            count = count + 1
+            return count, chunk[pos]
+        end
     end
 
     function methods:get(key, opts)
@@ -1136,6 +1305,9 @@ this_module = {
         commit      = M_COMMIT,
         rollback    = M_ROLLBACK,
         inject      = M_INJECT,
+        select_with_pos = M_SELECT_WITH_POS,
+        batch       = M_BATCH,
+        select_chunked = M_SELECT_CHUNKED,
     }
 }
 
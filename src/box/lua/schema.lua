@@ -118,7 +118,14 @@ ffi.cdef[[
     box_select(uint32_t space_id, uint32_t index_id,
                int iterator, uint32_t offset, uint32_t limit,
                const char *key, const char *key_end,
-               struct port *port);
+               const char **packed_pos, const char **packed_pos_end,
+               bool update_pos, struct port *port);
+
+    size_t
+    box_region_used(void);
+
+    void
+    box_region_truncate(size_t size);
 
     void password_prepare(const char *password, int len,
                           char *out, int out_len);
@@ -1813,6 +1820,8 @@ end
 -- global struct port instance to use by select()/get()
 local port = ffi.new('struct port')
 local port_c = ffi.cast('struct port_c *', port)
+local select_pos = ffi.new('const char *[1]')
+local select_pos_end = ffi.new('const char *[1]')
 
 -- Helper function to check space:method() usage
 local function check_space_arg(space, method)
@@ -2353,6 +2362,8 @@ local function check_select_opts(opts, key_is_nil)
     local limit = 4294967295
     local iterator = check_iterator_type(opts, key_is_nil)
     local fullscan = false
+    local after = nil
+    local fetch_pos = false
     if opts ~= nil and type(opts) == "table" then
         if opts.offset ~= nil then
             offset = opts.offset
@@ -2363,8 +2374,17 @@ local function check_select_opts(opts, key_is_nil)
         if opts.fullscan ~= nil then
             fullscan = opts.fullscan
         end
+        if opts.after ~= nil then
+            if type(opts.after) ~= 'string' then
+                box.error(box.error.ITERATOR_POSITION)
+            end
+            after = opts.after
+        end
+        if opts.fetch_pos ~= nil then
+            fetch_pos = opts.fetch_pos and true or false
+        end
     end
-    return iterator, offset, limit, fullscan
+    return iterator, offset, limit, fullscan, after, fetch_pos
 end
 
 box.internal.check_select_opts = check_select_opts -- for net.box
@@ -2391,16 +2411,31 @@ base_index_mt.select_ffi = function(index, key, opts)
     local ibuf = cord_ibuf_take()
     local key, key_end = tuple_encode(ibuf, key)
     local key_is_nil = key + 1 >= key_end
-    local iterator, offset, limit, fullscan =
+    local iterator, offset, limit, fullscan, after, fetch_pos =
         check_select_opts(opts, key_is_nil)
     check_select_safety(index, key_is_nil, iterator, limit, offset, fullscan)
 
+    if after ~= nil then
+        select_pos[0] = after
+        select_pos_end[0] = select_pos[0] + #after
+    else
+        select_pos[0] = nil
+        select_pos_end[0] = nil
+    end
+    local region_svp = builtin.box_region_used()
     local nok = builtin.box_select(index.space_id, index.id, iterator, offset,
-                                   limit, key, key_end, port) ~= 0
+                                   limit, key, key_end, select_pos,
+                                   select_pos_end, fetch_pos, port) ~= 0
     cord_ibuf_put(ibuf)
     if nok then
+        builtin.box_region_truncate(region_svp)
         return box.error()
     end
+    local pos
+    if fetch_pos and select_pos[0] ~= nil then
+        pos = ffi.string(select_pos[0], select_pos_end[0] - select_pos[0])
+    end
+    builtin.box_region_truncate(region_svp)
 
     local ret = {}
     local entry = port_c.first
@@ -2409,6 +2444,9 @@ base_index_mt.select_ffi = function(index, key, opts)
         entry = entry.next
     end
     builtin.port_destroy(port);
+    if fetch_pos then
+        return ret, pos
+    end
     return ret
 end
 
@@ -2416,11 +2454,11 @@ base_index_mt.select_luac = function(index, key, opts)
     check_index_arg(index, 'select')
     local key = keify(key)
     local key_is_nil = #key == 0
-    local iterator, offset, limit, fullscan =
+    local iterator, offset, limit, fullscan, after, fetch_pos =
         check_select_opts(opts, key_is_nil)
     check_select_safety(index, key_is_nil, iterator, limit, offset, fullscan)
     return internal.select(index.space_id, index.id, iterator,
-        offset, limit, key)
+        offset, limit, key, after, fetch_pos)
 end
 
 base_index_mt.update = function(index, key, ops)
@@ -68,6 +68,19 @@ inject_current_stat(struct lua_State *L, const char *name, size_t val)
 	lua_pop(L, 1);
 }
 
+/** Push a table with the tx queue delay metric to a Lua stack. */
+static void
+push_queue_delay_stat(struct lua_State *L, struct iproto_stats *stats)
+{
+	lua_newtable(L);
+	lua_pushstring(L, "current");
+	lua_pushnumber(L, stats->queue_delay);
+	lua_rawset(L, -3);
+	lua_pushstring(L, "min");
+	lua_pushnumber(L, stats->queue_delay_min);
+	lua_rawset(L, -3);
+}
+
 static void
 inject_iproto_stats(struct lua_State *L, struct iproto_stats *stats)
 {
@@ -78,6 +91,9 @@ inject_iproto_stats(struct lua_State *L, struct iproto_stats *stats)
 			    stats->requests_in_progress);
 	inject_current_stat(L, "REQUESTS_IN_STREAM_QUEUE",
 			    stats->requests_in_stream_queue);
+	lua_pushstring(L, "QUEUE_DELAY");
+	push_queue_delay_stat(L, stats);
+	lua_rawset(L, -3);
 }
 
 static void
@@ -175,10 +191,15 @@ static int
 lbox_stat_net_index(struct lua_State *L)
 {
 	const char *key = luaL_checkstring(L, -1);
+	struct iproto_stats stats;
+	if (strcmp(key, "QUEUE_DELAY") == 0) {
+		iproto_stats_get(&stats);
+		push_queue_delay_stat(L, &stats);
+		return 1;
+	}
 	if (iproto_rmean_foreach(seek_stat_item, L) == 0)
 		return 0;
 
-	struct iproto_stats stats;
 	iproto_stats_get(&stats);
 	if (strcmp(key, "CONNECTIONS") == 0) {
 		lua_pushstring(L, "current");
@@ -215,14 +236,21 @@ lbox_stat_net_index(struct lua_State *L)
  * - STREAMS: total, rps, current;
  * - REQUESTS: total, rps, current;
  * - REQUESTS_IN_PROGRESS: total, rps, current;
- * - REQUESTS_IN_STREAM_QUEUE: total, rps, current.
+ * - REQUESTS_IN_STREAM_QUEUE: total, rps, current;
+ * - QUEUE_DELAY: current, min.
  *
  * These fields have the following meaning:
  *
  * - total -- amount of events since start;
  * - rps -- amount of events per second, mean over last 5 seconds;
  * - current -- amount of resources currently hold (say, number of
- *   open connections).
+ *   open connections), or for QUEUE_DELAY the time the last request
+ *   waited in the tx queue, in seconds;
+ * - min -- the minimal time a request waited in the tx queue over
+ *   the last 100 ms interval, in seconds.
+ *
+ * Queue delays of all threads are reported as the maximum over
+ * the threads.
  */
 static int
 lbox_stat_net_call(struct lua_State *L)
@@ -36,8 +36,11 @@
 #include <small/mempool.h>
 
 #include "fiber.h"
+#include "cbus.h"
 #include "errinj.h"
 #include "coio_file.h"
+#include "coio_task.h"
+#include "tt_static.h"
 #include "tuple.h"
 #include "txn.h"
 #include "memtx_tx.h"
@@ -245,50 +248,483 @@ static int
 memtx_engine_recover_snapshot_row(struct memtx_engine *memtx,
 				  struct xrow_header *row, int *is_space_system);
 
-int
-memtx_engine_recover_snapshot(struct memtx_engine *memtx,
-			      const struct vclock *vclock)
+/**
+ * Return the name of a file of the snapshot with the given
+ * signature. Part 0 is the snapshot file itself, see
+ * struct checkpoint_part.
+ */
+static const char *
+snapshot_part_filename(struct xdir *dir, int64_t signature, int part,
+		       enum log_suffix suffix)
 {
-	/* Process existing snapshot */
-	say_info("recovery start");
-	int64_t signature = vclock_sum(vclock);
-	const char *filename = xdir_format_filename(&memtx->snap_dir,
-						    signature, NONE);
+	if (part == 0)
+		return xdir_format_filename(dir, signature, suffix);
+	return tt_sprintf("%s.%d%s", xdir_format_filename(dir, signature, NONE),
+			  part, suffix == INPROGRESS ? inprogress_suffix : "");
+}
 
-	say_info("recovering from `%s'", filename);
+static ssize_t
+snapshot_read_part_count_f(va_list ap)
+{
+	const char *filename = va_arg(ap, const char *);
+	uint32_t *part_count = va_arg(ap, uint32_t *);
 	struct xlog_cursor cursor;
-	if (xlog_cursor_open(&cursor, filename) < 0)
+	if (xlog_cursor_open(&cursor, filename) != 0)
+		return -1;
+	*part_count = cursor.meta.parts;
+	xlog_cursor_close(&cursor, false);
+	return 0;
+}
+
+/**
+ * Read the number of additional parts of the snapshot with the
+ * given signature from its meta (xlog_meta::parts). The file is
+ * read in a coio thread so as not to block tx.
+ */
+static int
+snapshot_read_part_count(struct xdir *dir, int64_t signature,
+			 uint32_t *part_count)
+{
+	char filename[PATH_MAX];
+	strlcpy(filename, xdir_format_filename(dir, signature, NONE),
+		sizeof(filename));
+	if (coio_call(snapshot_read_part_count_f, filename, part_count) != 0)
+		return -1;
+	return 0;
+}
+
+/* {{{ Snapshot reader */
+
+enum {
+	/** Size of snapshot data passed by a reader thread at once. */
+	SNAPSHOT_CHUNK_SIZE = 1024 * 1024,
+	/** Max number of chunks read ahead of recovery. */
+	SNAPSHOT_READ_AHEAD = 8,
+	/**
+	 * Size of a record marking a corrupted transaction,
+	 * followed by [uint32 length][error message].
+	 */
+	SNAPSHOT_TX_CORRUPTED = UINT32_MAX,
+};
+
+/**
+ * Decompressed transactions of a snapshot file, stored as
+ * a sequence of [uint32 size][rows] records, one per xlog tx.
+ * A transaction the reader failed to open is stored as
+ * a SNAPSHOT_TX_CORRUPTED record, so that recovery can decide
+ * whether it may be skipped.
+ */
+struct snapshot_chunk {
+	/** Link in snapshot_reader::chunks. */
+	struct rlist link;
+	/** Size of data. */
+	size_t size;
+	/** Size of memory allocated for data. */
+	size_t capacity;
+	char data[0];
+};
+
+/**
+ * Reader of a snapshot file. File reads, checksum checks and
+ * decompression are done ahead of recovery by a thread of its
+ * own, so the tx thread only decodes and applies rows.
+ */
+struct snapshot_reader {
+	/** Name of the file. */
+	char filename[PATH_MAX];
+	/** Cursor, used only by the reader thread. */
+	struct xlog_cursor cursor;
+	/** Meta of the file, set when the file is open. */
+	struct xlog_meta meta;
+	/** Set if the file ends with an EOF marker. */
+	bool is_eof;
+	/**
+	 * Skip corrupted transactions and report them to
+	 * recovery instead of failing.
+	 */
+	bool force_recovery;
+	struct cord cord;
+	/** Pipe from tx to the reader thread. */
+	struct cpipe reader_pipe;
+	/** Pipe from the reader thread to tx. */
+	struct cpipe tx_pipe;
+	/** Fiber requesting chunks from the reader thread. */
+	struct fiber *fiber;
+	/** Chunks read ahead, linked by snapshot_chunk::link. */
+	struct rlist chunks;
+	/** Number of chunks in the list. */
+	int chunk_count;
+	/** Signaled when a chunk is read or consumed. */
+	struct fiber_cond cond;
+	/** Set when the whole file is read or reading failed. */
+	bool is_done;
+	/** Set to stop reading ahead. */
+	bool is_stopped;
+	/** Error that stopped reading, if any. */
+	struct diag diag;
+};
+
+struct snapshot_read_msg {
+	struct cbus_call_msg base;
+	struct snapshot_reader *reader;
+	/** [out] The next chunk or NULL at the end of file. */
+	struct snapshot_chunk *chunk;
+};
+
+/** Make room for @a size more bytes in a chunk. */
+static struct snapshot_chunk *
+snapshot_chunk_reserve(struct snapshot_chunk *chunk, size_t size)
+{
+	size_t used = chunk != NULL ? chunk->size : 0;
+	size_t capacity = chunk != NULL ? chunk->capacity : 0;
+	if (used + size <= capacity)
+		return chunk;
+	capacity = MAX(capacity * 2, (size_t)SNAPSHOT_CHUNK_SIZE);
+	capacity = MAX(capacity, used + size);
+	struct snapshot_chunk *new_chunk = (struct snapshot_chunk *)
+		realloc(chunk, sizeof(*chunk) + capacity);
+	if (new_chunk == NULL) {
+		diag_set(OutOfMemory, sizeof(*chunk) + capacity,
+			 "realloc", "struct snapshot_chunk");
+		return NULL;
+	}
+	new_chunk->size = used;
+	new_chunk->capacity = capacity;
+	return new_chunk;
+}
+
+/** Append a SNAPSHOT_TX_CORRUPTED record to a chunk. */
+static struct snapshot_chunk *
+snapshot_chunk_add_corrupted(struct snapshot_chunk *chunk,
+			     const char *errmsg)
+{
+	uint32_t size = SNAPSHOT_TX_CORRUPTED;
+	uint32_t len = strlen(errmsg);
+	chunk = snapshot_chunk_reserve(chunk, sizeof(size) + sizeof(len) +
+				       len);
+	if (chunk == NULL)
+		return NULL;
+	char *pos = chunk->data + chunk->size;
+	memcpy(pos, &size, sizeof(size));
+	pos += sizeof(size);
+	memcpy(pos, &len, sizeof(len));
+	pos += sizeof(len);
+	memcpy(pos, errmsg, len);
+	chunk->size += sizeof(size) + sizeof(len) + len;
+	return chunk;
+}
+
+/** Open the file, called in the reader thread. */
+static int
+snapshot_open_f(struct cbus_call_msg *base)
+{
+	struct snapshot_read_msg *msg = (struct snapshot_read_msg *)base;
+	struct snapshot_reader *reader = msg->reader;
+	if (xlog_cursor_open(&reader->cursor, reader->filename) != 0)
+		return -1;
+	reader->meta = reader->cursor.meta;
+	return 0;
+}
+
+/** Read the next chunk, called in the reader thread. */
+static int
+snapshot_read_f(struct cbus_call_msg *base)
+{
+	struct snapshot_read_msg *msg = (struct snapshot_read_msg *)base;
+	struct snapshot_reader *reader = msg->reader;
+	struct xlog_cursor *cursor = &reader->cursor;
+	struct snapshot_chunk *chunk = NULL;
+	msg->chunk = NULL;
+	if (!xlog_cursor_is_open(cursor))
+		return 0;
+	while (chunk == NULL || chunk->size < SNAPSHOT_CHUNK_SIZE) {
+		int rc;
+		while ((rc = xlog_cursor_next_tx(cursor)) < 0) {
+			struct error *e = diag_last_error(diag_get());
+			if (!reader->force_recovery ||
+			    e->type != &type_XlogError)
+				goto fail;
+			/*
+			 * Whether the tx may be skipped depends on the
+			 * spaces it belongs to, which only recovery
+			 * knows, so let it decide.
+			 */
+			struct snapshot_chunk *new_chunk =
+				snapshot_chunk_add_corrupted(chunk,
+							     e->errmsg);
+			if (new_chunk == NULL)
+				goto fail;
+			chunk = new_chunk;
+			if ((rc = xlog_cursor_find_tx_magic(cursor)) < 0)
+				goto fail;
+			if (rc > 0)
+				break;
+		}
+		if (rc > 0) {
+			reader->is_eof = xlog_cursor_is_eof(cursor);
+			xlog_cursor_close(cursor, false);
+			break;
+		}
+		struct ibuf *rows = &cursor->tx_cursor.rows;
+		uint32_t size = ibuf_used(rows);
+		struct snapshot_chunk *new_chunk =
+			snapshot_chunk_reserve(chunk, sizeof(size) + size);
+		if (new_chunk == NULL)
+			goto fail;
+		chunk = new_chunk;
+		memcpy(chunk->data + chunk->size, &size, sizeof(size));
+		memcpy(chunk->data + chunk->size + sizeof(size),
+		       rows->rpos, size);
+		chunk->size += sizeof(size) + size;
+		/* All rows are copied, finish the tx. */
+		xlog_cursor_skip_tx(cursor);
+	}
+	msg->chunk = chunk;
+	return 0;
+fail:
+	free(chunk);
+	xlog_cursor_close(cursor, false);
+	return -1;
+}
+
+/** Reader thread function. */
+static int
+snapshot_reader_f(va_list ap)
+{
+	struct snapshot_reader *reader = va_arg(ap, struct snapshot_reader *);
+	struct cbus_endpoint endpoint;
+
+	cpipe_create(&reader->tx_pipe, "tx_prio");
+	cbus_endpoint_create(&endpoint, cord_name(cord()),
+			     fiber_schedule_cb, fiber());
+	cbus_loop(&endpoint);
+	if (xlog_cursor_is_open(&reader->cursor))
+		xlog_cursor_close(&reader->cursor, false);
+	cbus_endpoint_destroy(&endpoint, cbus_process);
+	cpipe_destroy(&reader->tx_pipe);
+	return 0;
+}
+
+/** Fiber reading chunks ahead of recovery. */
+static int
+snapshot_reader_prefetch_f(va_list ap)
+{
+	struct snapshot_reader *reader = va_arg(ap, struct snapshot_reader *);
+	while (!reader->is_stopped && !reader->is_done) {
+		if (reader->chunk_count >= SNAPSHOT_READ_AHEAD) {
+			fiber_cond_wait(&reader->cond);
+			continue;
+		}
+		struct snapshot_read_msg msg;
+		msg.reader = reader;
+		if (cbus_call(&reader->reader_pipe, &reader->tx_pipe,
+			      &msg.base, snapshot_read_f, NULL,
+			      TIMEOUT_INFINITY) != 0) {
+			diag_move(diag_get(), &reader->diag);
+			reader->is_done = true;
+		} else if (msg.chunk == NULL) {
+			reader->is_done = true;
+		} else {
+			rlist_add_tail_entry(&reader->chunks, msg.chunk, link);
+			reader->chunk_count++;
+		}
+		fiber_cond_broadcast(&reader->cond);
+	}
+	return 0;
+}
+
+static void
+snapshot_reader_delete(struct snapshot_reader *reader)
+{
+	if (reader->fiber != NULL) {
+		reader->is_stopped = true;
+		fiber_cond_broadcast(&reader->cond);
+		fiber_join(reader->fiber);
+	}
+	cbus_stop_loop(&reader->reader_pipe);
+	cpipe_destroy(&reader->reader_pipe);
+	if (cord_cojoin(&reader->cord) != 0)
+		diag_log();
+	struct snapshot_chunk *chunk, *tmp;
+	rlist_foreach_entry_safe(chunk, &reader->chunks, link, tmp)
+		free(chunk);
+	diag_destroy(&reader->diag);
+	fiber_cond_destroy(&reader->cond);
+	free(reader);
+}
+
+/**
+ * Open a snapshot file and start reading it ahead in
+ * background. @a part is used to name the reader thread.
+ */
+static struct snapshot_reader *
+snapshot_reader_new(const char *filename, int part, bool force_recovery)
+{
+	struct snapshot_reader *reader = (struct snapshot_reader *)
+		calloc(1, sizeof(*reader));
+	if (reader == NULL) {
+		diag_set(OutOfMemory, sizeof(*reader), "calloc",
+			 "struct snapshot_reader");
+		return NULL;
+	}
+	snprintf(reader->filename, sizeof(reader->filename), "%s",
+		 filename);
+	reader->force_recovery = force_recovery;
+	rlist_create(&reader->chunks);
+	fiber_cond_create(&reader->cond);
+	diag_create(&reader->diag);
+
+	char name[FIBER_NAME_MAX];
+	snprintf(name, sizeof(name), "snapshot.reader.%d", part);
+	if (cord_costart(&reader->cord, name, snapshot_reader_f,
+			 reader) != 0) {
+		diag_destroy(&reader->diag);
+		fiber_cond_destroy(&reader->cond);
+		free(reader);
+		return NULL;
+	}
+	cpipe_create(&reader->reader_pipe, name);
+
+	struct snapshot_read_msg msg;
+	msg.reader = reader;
+	if (cbus_call(&reader->reader_pipe, &reader->tx_pipe, &msg.base,
+		      snapshot_open_f, NULL, TIMEOUT_INFINITY) != 0)
+		goto fail;
+	reader->fiber = fiber_new("snapshot.prefetch",
+				  snapshot_reader_prefetch_f);
+	if (reader->fiber == NULL)
+		goto fail;
+	fiber_set_joinable(reader->fiber, true);
+	fiber_start(reader->fiber, reader);
+	return reader;
+fail:
+	snapshot_reader_delete(reader);
+	return NULL;
+}
+
+/**
+ * Get the next chunk read from the file, wait for it if
+ * necessary. Returns NULL in @a chunk at the end of file.
+ * The chunk must be freed by the caller.
+ */
+static int
+snapshot_reader_next(struct snapshot_reader *reader,
+		     struct snapshot_chunk **chunk)
+{
+	while (rlist_empty(&reader->chunks) && !reader->is_done) {
+		if (fiber_cond_wait(&reader->cond) != 0)
+			return -1;
+	}
+	if (!rlist_empty(&reader->chunks)) {
+		*chunk = rlist_shift_entry(&reader->chunks,
+					   struct snapshot_chunk, link);
+		reader->chunk_count--;
+		fiber_cond_broadcast(&reader->cond);
+		return 0;
+	}
+	if (!diag_is_empty(&reader->diag)) {
+		diag_move(&reader->diag, diag_get());
 		return -1;
+	}
+	*chunk = NULL;
+	return 0;
+}
+
+/* }}} Snapshot reader */
 
+/**
+ * Apply rows of a snapshot file read by @a reader.
+ * @a is_main is set for the main snapshot file, which
+ * unlike additional parts always has system spaces.
+ */
+static int
+memtx_engine_recover_snapshot_part(struct memtx_engine *memtx,
+				   struct snapshot_reader *reader,
+				   int64_t signature, bool is_main,
+				   uint64_t *row_count)
+{
+	say_info("recovering from `%s'", reader->filename);
 	int rc;
-	struct xrow_header row;
-	uint64_t row_count = 0;
+	struct snapshot_chunk *chunk;
 	int is_space_system = -1;
-	bool force_recovery = false;
 	/*
-	 * In case when we read system space, we can't ignore errors.
+	 * The main file starts with system spaces, errors in
+	 * which can't be ignored.
 	 */
-	while ((rc = xlog_cursor_next(&cursor, &row, force_recovery)) == 0) {
-		row.lsn = signature;
-		rc = memtx_engine_recover_snapshot_row(memtx, &row,
-						       &is_space_system);
-		force_recovery = is_space_system == 0 ?
-				 memtx->force_recovery : false;
-		if (rc < 0) {
-			if (!force_recovery)
-				break;
-			say_error("can't apply row: ");
-			diag_log();
-		}
-		++row_count;
-		if (row_count % 100000 == 0) {
-			say_info_ratelimited("%.1fM rows processed",
-					     row_count / 1e6);
-			fiber_yield_timeout(0);
+	bool force_recovery = is_main ? false : memtx->force_recovery;
+	while ((rc = snapshot_reader_next(reader, &chunk)) == 0 &&
+	       chunk != NULL) {
+		const char *pos = chunk->data;
+		const char *end = chunk->data + chunk->size;
+		while (rc == 0 && pos < end) {
+			uint32_t size;
+			memcpy(&size, pos, sizeof(size));
+			pos += sizeof(size);
+			if (size == SNAPSHOT_TX_CORRUPTED) {
+				uint32_t len;
+				memcpy(&len, pos, sizeof(len));
+				pos += sizeof(len);
+				diag_set(XlogError, "%.*s", (int)len, pos);
+				pos += len;
+				if (!force_recovery) {
+					rc = -1;
+					break;
+				}
+				say_error("can't open tx: %s",
+					  diag_last_error(diag_get())->errmsg);
+				continue;
+			}
+			const char *tx_end = pos + size;
+			while (pos < tx_end) {
+				struct xrow_header row;
+				if (xrow_header_decode(&row, &pos, tx_end,
+						       false) != 0) {
+					diag_set(XlogError, "can't parse row");
+					if (!force_recovery) {
+						rc = -1;
+						break;
+					}
+					say_error("can't decode row: %s",
+						  diag_last_error(
+							diag_get())->errmsg);
+					break;
+				}
+				row.lsn = signature;
+				rc = memtx_engine_recover_snapshot_row(
+					memtx, &row, &is_space_system);
+				/*
+				 * In case when we read system space,
+				 * we can't ignore errors.
+				 */
+				force_recovery = is_space_system == 0 ?
+						 memtx->force_recovery : false;
+				if (rc < 0) {
+					if (!force_recovery)
+						break;
+					say_error("can't apply row: ");
+					diag_log();
+					rc = 0;
+				}
+				++*row_count;
+				if (*row_count % 100000 == 0) {
+					say_info_ratelimited(
+						"%.1fM rows processed",
+						*row_count / 1e6);
+					fiber_yield_timeout(0);
+				}
+			}
+			pos = tx_end;
 		}
+		free(chunk);
+		if (rc < 0)
+			break;
 	}
-	xlog_cursor_close(&cursor, false);
-	if (rc < 0 || is_space_system < 0)
+	/*
+	 * Only the main snapshot file is guaranteed to have
+	 * rows: additional parts store user spaces, which may
+	 * be empty.
+	 */
+	if (rc < 0 || (is_main && is_space_system < 0))
 		return -1;
 
 	/**
@@ -296,16 +732,76 @@ memtx_engine_recover_snapshot(struct memtx_engine *memtx,
 	 * marker - such snapshots are very likely corrupted and
 	 * should not be trusted.
 	 */
-	if (!xlog_cursor_is_eof(&cursor)) {
+	if (!reader->is_eof) {
 		if (!memtx->force_recovery)
-			panic("snapshot `%s' has no EOF marker", cursor.name);
+			panic("snapshot `%s' has no EOF marker",
+			      reader->filename);
 		else
-			say_error("snapshot `%s' has no EOF marker", cursor.name);
+			say_error("snapshot `%s' has no EOF marker",
+				  reader->filename);
 	}
-
 	return 0;
 }
 
+int
+memtx_engine_recover_snapshot(struct memtx_engine *memtx,
+			      const struct vclock *vclock)
+{
+	/* Process existing snapshot */
+	say_info("recovery start");
+	int64_t signature = vclock_sum(vclock);
+	const char *filename = xdir_format_filename(&memtx->snap_dir,
+						    signature, NONE);
+	struct snapshot_reader *main_reader =
+		snapshot_reader_new(filename, 0, memtx->force_recovery);
+	if (main_reader == NULL)
+		return -1;
+	/*
+	 * If the snapshot was written by several threads, start
+	 * reading all its files at once. They are applied in
+	 * order, the main file goes first.
+	 */
+	int rc = -1;
+	uint64_t row_count = 0;
+	uint32_t part_count = main_reader->meta.parts + 1;
+	struct snapshot_reader **readers = (struct snapshot_reader **)
+		calloc(part_count, sizeof(*readers));
+	if (readers == NULL) {
+		diag_set(OutOfMemory, part_count * sizeof(*readers),
+			 "calloc", "struct snapshot_reader");
+		snapshot_reader_delete(main_reader);
+		return -1;
+	}
+	readers[0] = main_reader;
+	for (uint32_t i = 1; i < part_count; i++) {
+		filename = snapshot_part_filename(&memtx->snap_dir,
+						  signature, i, NONE);
+		readers[i] = snapshot_reader_new(filename, i,
+						 memtx->force_recovery);
+		if (readers[i] == NULL)
+			goto out;
+		if (vclock_compare(&readers[i]->meta.vclock, vclock) != 0) {
+			diag_set(XlogError, "snapshot part `%s' doesn't "
+				 "match the snapshot", filename);
+			goto out;
+		}
+	}
+	for (uint32_t i = 0; i < part_count; i++) {
+		if (memtx_engine_recover_snapshot_part(memtx, readers[i],
+						       signature, i == 0,
+						       &row_count) != 0)
+			goto out;
+	}
+	rc = 0;
+out:
+	for (uint32_t i = 0; i < part_count; i++) {
+		if (readers[i] != NULL)
+			snapshot_reader_delete(readers[i]);
+	}
+	free(readers);
+	return rc;
+}
+
 static int
 memtx_engine_recover_raft(const struct xrow_header *row)
 {
@@ -680,17 +1176,38 @@ checkpoint_write_tuple(struct xlog *l, uint32_t space_id, uint32_t group_id,
 struct checkpoint_entry {
 	uint32_t space_id;
 	uint32_t group_id;
+	/** Snapshot part the space is written to. */
+	int part;
 	struct snapshot_iterator *iterator;
 	struct rlist link;
 };
 
+/**
+ * A file of a snapshot, written by a thread of its own.
+ * Part 0 is the snapshot file itself: it stores system spaces
+ * and the number of other parts (xlog_meta::parts). The other
+ * parts store user spaces, see snapshot_part_filename().
+ */
+struct checkpoint_part {
+	struct checkpoint *ckpt;
+	/** Part number. */
+	int id;
+	/** Total size of spaces written to this part. */
+	size_t size;
+	struct cord cord;
+};
+
 struct checkpoint {
 	/**
 	 * List of MemTX spaces to snapshot, with consistent
 	 * read view iterators.
 	 */
 	struct rlist entries;
-	struct cord cord;
+	/** Snapshot parts, see memtx_engine::checkpoint_threads. */
+	struct checkpoint_part *parts;
+	int part_count;
+	/** Number of parts which threads have been started. */
+	int started_count;
 	bool waiting_for_snap_thread;
 	/** The vclock of the snapshot file. */
 	struct vclock vclock;
@@ -705,14 +1222,30 @@ struct checkpoint {
 };
 
 static struct checkpoint *
-checkpoint_new(const char *snap_dirname, uint64_t snap_io_rate_limit)
+checkpoint_new(const char *snap_dirname, uint64_t snap_io_rate_limit,
+	       int part_count)
 {
+	assert(part_count > 0);
 	struct checkpoint *ckpt = (struct checkpoint *)malloc(sizeof(*ckpt));
 	if (ckpt == NULL) {
 		diag_set(OutOfMemory, sizeof(*ckpt), "malloc",
 			 "struct checkpoint");
 		return NULL;
 	}
+	ckpt->parts = (struct checkpoint_part *)
+		calloc(part_count, sizeof(*ckpt->parts));
+	if (ckpt->parts == NULL) {
+		diag_set(OutOfMemory, part_count * sizeof(*ckpt->parts),
+			 "calloc", "struct checkpoint_part");
+		free(ckpt);
+		return NULL;
+	}
+	for (int i = 0; i < part_count; i++) {
+		ckpt->parts[i].ckpt = ckpt;
+		ckpt->parts[i].id = i;
+	}
+	ckpt->part_count = part_count;
+	ckpt->started_count = 0;
 	rlist_create(&ckpt->entries);
 	ckpt->waiting_for_snap_thread = false;
 	struct xlog_opts opts = xlog_opts_default;
@@ -736,6 +1269,7 @@ checkpoint_delete(struct checkpoint *ckpt)
 		free(entry);
 	}
 	xdir_destroy(&ckpt->dir);
+	free(ckpt->parts);
 	free(ckpt);
 }
 
@@ -743,17 +1277,38 @@ static void
 checkpoint_cancel(struct checkpoint *ckpt)
 {
 	/*
-	 * Cancel the checkpoint thread if it's running and wait
-	 * for it to terminate so as to eliminate the possibility
-	 * of use-after-free.
+	 * Cancel the checkpoint threads if they're running and
+	 * wait for them to terminate so as to eliminate the
+	 * possibility of use-after-free.
 	 */
 	if (ckpt->waiting_for_snap_thread) {
-		tt_pthread_cancel(ckpt->cord.id);
-		tt_pthread_join(ckpt->cord.id, NULL);
+		for (int i = 0; i < ckpt->started_count; i++)
+			tt_pthread_cancel(ckpt->parts[i].cord.id);
+		for (int i = 0; i < ckpt->started_count; i++)
+			tt_pthread_join(ckpt->parts[i].cord.id, NULL);
 	}
 	checkpoint_delete(ckpt);
 }
 
+/**
+ * Wait for the checkpoint threads started so far.
+ * Returns -1 if any of them failed.
+ */
+static int
+checkpoint_join(struct checkpoint *ckpt)
+{
+	int rc = 0;
+	for (int i = 0; i < ckpt->started_count; i++) {
+		if (cord_cojoin(&ckpt->parts[i].cord) != 0) {
+			diag_log();
+			rc = -1;
+		}
+	}
+	ckpt->started_count = 0;
+	ckpt->waiting_for_snap_thread = false;
+	return rc;
+}
+
 static void
 replica_join_cancel(struct cord *replica_join_cord)
 {
@@ -788,6 +1343,20 @@ checkpoint_add_space(struct space *sp, void *data)
 
 	entry->space_id = space_id(sp);
 	entry->group_id = space_group_id(sp);
+	/*
+	 * System spaces must be recovered first, so they are
+	 * always written to the main snapshot file. User spaces
+	 * go to the part with the least data.
+	 */
+	entry->part = 0;
+	if (entry->space_id >= BOX_SYSTEM_ID_MAX) {
+		for (int i = 1; i < ckpt->part_count; i++) {
+			if (ckpt->parts[i].size <
+			    ckpt->parts[entry->part].size)
+				entry->part = i;
+		}
+	}
+	ckpt->parts[entry->part].size += space_bsize(sp);
 	entry->iterator = index_create_snapshot_iterator(pk);
 	if (entry->iterator == NULL)
 		return -1;
@@ -821,29 +1390,58 @@ checkpoint_write_synchro(struct xlog *l, const struct synchro_request *req)
 	return checkpoint_write_row(l, &row);
 }
 
+/**
+ * Create a file for a snapshot part. The I/O rate limit is
+ * shared by all parts written concurrently.
+ */
+static int
+checkpoint_create_part(struct checkpoint *ckpt, int part, struct xlog *xlog)
+{
+	struct xdir *dir = &ckpt->dir;
+	struct xlog_meta meta;
+	xlog_meta_create(&meta, dir->filetype, dir->instance_uuid,
+			 &ckpt->vclock, NULL);
+	if (part == 0)
+		meta.parts = ckpt->part_count - 1;
+	struct xlog_opts opts = dir->opts;
+	opts.rate_limit /= ckpt->part_count;
+	const char *filename = snapshot_part_filename(dir,
+			vclock_sum(&ckpt->vclock), part, NONE);
+	return xlog_create(xlog, filename, dir->open_wflags, &meta, &opts);
+}
+
 static int
 checkpoint_f(va_list ap)
 {
-	struct checkpoint *ckpt = va_arg(ap, struct checkpoint *);
+	struct checkpoint_part *part = va_arg(ap, struct checkpoint_part *);
+	struct checkpoint *ckpt = part->ckpt;
 
 	if (ckpt->touch) {
+		assert(part->id == 0);
 		if (xdir_touch_xlog(&ckpt->dir, &ckpt->vclock) == 0)
 			return 0;
 		/*
 		 * Failed to touch an existing snapshot, create
-		 * a new one.
+		 * a new one. Other parts aren't being written,
+		 * so write everything to a single file.
 		 */
 		ckpt->touch = false;
+		ckpt->part_count = 1;
+		struct checkpoint_entry *entry;
+		rlist_foreach_entry(entry, &ckpt->entries, link)
+			entry->part = 0;
 	}
 
 	struct xlog snap;
-	if (xdir_create_xlog(&ckpt->dir, &snap, &ckpt->vclock) != 0)
+	if (checkpoint_create_part(ckpt, part->id, &snap) != 0)
 		return -1;
 
 	say_info("saving snapshot `%s'", snap.filename);
 	ERROR_INJECT_SLEEP(ERRINJ_SNAP_WRITE_DELAY);
 	struct checkpoint_entry *entry;
 	rlist_foreach_entry(entry, &ckpt->entries, link) {
+		if (entry->part != part->id)
+			continue;
 		int rc;
 		uint32_t size;
 		const char *data;
@@ -856,10 +1454,13 @@ checkpoint_f(va_list ap)
 		if (rc != 0)
 			goto fail;
 	}
-	if (checkpoint_write_raft(&snap, &ckpt->raft) != 0)
-		goto fail;
-	if (checkpoint_write_synchro(&snap, &ckpt->synchro_state) != 0)
-		goto fail;
+	if (part->id == 0) {
+		if (checkpoint_write_raft(&snap, &ckpt->raft) != 0)
+			goto fail;
+		if (checkpoint_write_synchro(&snap,
+					     &ckpt->synchro_state) != 0)
+			goto fail;
+	}
 	if (xlog_flush(&snap) < 0)
 		goto fail;
 
@@ -879,7 +1480,8 @@ memtx_engine_begin_checkpoint(struct engine *engine, bool is_scheduled)
 
 	assert(memtx->checkpoint == NULL);
 	memtx->checkpoint = checkpoint_new(memtx->snap_dir.dirname,
-					   memtx->snap_io_rate_limit);
+					   memtx->snap_io_rate_limit,
+					   memtx->checkpoint_threads);
 	if (memtx->checkpoint == NULL)
 		return -1;
 
@@ -908,18 +1510,24 @@ memtx_engine_wait_checkpoint(struct engine *engine,
 	}
 	vclock_copy(&memtx->checkpoint->vclock, vclock);
 
-	if (cord_costart(&memtx->checkpoint->cord, "snapshot",
-			 checkpoint_f, memtx->checkpoint)) {
-		return -1;
+	struct checkpoint *ckpt = memtx->checkpoint;
+	int thread_count = ckpt->touch ? 1 : ckpt->part_count;
+	int result = 0;
+	for (int i = 0; i < thread_count; i++) {
+		struct checkpoint_part *part = &ckpt->parts[i];
+		const char *name = i == 0 ? "snapshot" :
+				   tt_sprintf("snapshot.%d", i);
+		if (cord_costart(&part->cord, name, checkpoint_f, part)) {
+			result = -1;
+			break;
+		}
+		ckpt->started_count++;
+		ckpt->waiting_for_snap_thread = true;
 	}
-	memtx->checkpoint->waiting_for_snap_thread = true;
 
 	/* wait for memtx-part snapshot completion */
-	int result = cord_cojoin(&memtx->checkpoint->cord);
-	if (result != 0)
-		diag_log();
-
-	memtx->checkpoint->waiting_for_snap_thread = false;
+	if (checkpoint_join(ckpt) != 0)
+		result = -1;
 	return result;
 }
 
@@ -939,15 +1547,21 @@ memtx_engine_commit_checkpoint(struct engine *engine,
 	if (!memtx->checkpoint->touch) {
 		int64_t lsn = vclock_sum(&memtx->checkpoint->vclock);
 		struct xdir *dir = &memtx->checkpoint->dir;
-		/* rename snapshot on completion */
-		char to[PATH_MAX];
-		snprintf(to, sizeof(to), "%s",
-			 xdir_format_filename(dir, lsn, NONE));
-		const char *from = xdir_format_filename(dir, lsn, INPROGRESS);
+		/*
+		 * rename snapshot on completion, the main file goes
+		 * last so that it never refers to missing parts
+		 */
 		ERROR_INJECT_YIELD(ERRINJ_SNAP_COMMIT_DELAY);
-		int rc = coio_rename(from, to);
-		if (rc != 0)
-			panic("can't rename .snap.inprogress");
+		for (int i = memtx->checkpoint->part_count - 1; i >= 0; i--) {
+			char to[PATH_MAX];
+			snprintf(to, sizeof(to), "%s",
+				 snapshot_part_filename(dir, lsn, i, NONE));
+			const char *from = snapshot_part_filename(dir, lsn, i,
+								  INPROGRESS);
+			int rc = coio_rename(from, to);
+			if (rc != 0)
+				panic("can't rename .snap.inprogress");
+		}
 	}
 
 	struct vclock last;
@@ -971,17 +1585,17 @@ memtx_engine_abort_checkpoint(struct engine *engine)
 	 */
 	if (memtx->checkpoint->waiting_for_snap_thread) {
 		/* wait for memtx-part snapshot completion */
-		if (cord_cojoin(&memtx->checkpoint->cord) != 0)
-			diag_log();
-		memtx->checkpoint->waiting_for_snap_thread = false;
+		(void) checkpoint_join(memtx->checkpoint);
 	}
 
-	/** Remove garbage .inprogress file. */
-	const char *filename =
-		xdir_format_filename(&memtx->checkpoint->dir,
-				     vclock_sum(&memtx->checkpoint->vclock),
-				     INPROGRESS);
-	(void) coio_unlink(filename);
+	/** Remove garbage .inprogress files. */
+	for (int i = 0; i < memtx->checkpoint->part_count; i++) {
+		const char *filename =
+			snapshot_part_filename(&memtx->checkpoint->dir,
+				vclock_sum(&memtx->checkpoint->vclock),
+				i, INPROGRESS);
+		(void) coio_unlink(filename);
+	}
 
 	checkpoint_delete(memtx->checkpoint);
 	memtx->checkpoint = NULL;
@@ -991,8 +1605,35 @@ static void
 memtx_engine_collect_garbage(struct engine *engine, const struct vclock *vclock)
 {
 	struct memtx_engine *memtx = (struct memtx_engine *)engine;
-	xdir_collect_garbage(&memtx->snap_dir, vclock_sum(vclock),
-			     XDIR_GC_ASYNC);
+	int64_t signature = vclock_sum(vclock);
+	/*
+	 * Remove additional parts of the snapshots first, while
+	 * the snapshot files storing their number still exist.
+	 */
+	struct vclock *it;
+	for (it = vclockset_first(&memtx->snap_dir.index);
+	     it != NULL && vclock_sum(it) < signature;
+	     it = vclockset_next(&memtx->snap_dir.index, it)) {
+		uint32_t part_count;
+		if (snapshot_read_part_count(&memtx->snap_dir, vclock_sum(it),
+					     &part_count) != 0) {
+			diag_log();
+			continue;
+		}
+		for (uint32_t i = 1; i <= part_count; i++) {
+			const char *filename = snapshot_part_filename(
+				&memtx->snap_dir, vclock_sum(it), i, NONE);
+			if (coio_unlink(filename) != 0) {
+				if (errno != ENOENT) {
+					say_syserror("error while removing %s",
+						     filename);
+				}
+				continue;
+			}
+			say_info("removed %s", filename);
+		}
+	}
+	xdir_collect_garbage(&memtx->snap_dir, signature, XDIR_GC_ASYNC);
 }
 
 static int
@@ -1000,9 +1641,18 @@ memtx_engine_backup(struct engine *engine, const struct vclock *vclock,
 		    engine_backup_cb cb, void *cb_arg)
 {
 	struct memtx_engine *memtx = (struct memtx_engine *)engine;
-	const char *filename = xdir_format_filename(&memtx->snap_dir,
-						    vclock_sum(vclock), NONE);
-	return cb(filename, cb_arg);
+	int64_t signature = vclock_sum(vclock);
+	uint32_t part_count;
+	if (snapshot_read_part_count(&memtx->snap_dir, signature,
+				     &part_count) != 0)
+		return -1;
+	for (uint32_t i = 0; i <= part_count; i++) {
+		const char *filename = snapshot_part_filename(
+			&memtx->snap_dir, signature, i, NONE);
+		if (cb(filename, cb_arg) != 0)
+			return -1;
+	}
+	return 0;
 }
 
 struct memtx_join_entry {
@@ -1354,6 +2004,7 @@ memtx_engine_new(const char *snap_dirname, bool force_recovery,
 	memtx->state = MEMTX_INITIALIZED;
 	memtx->max_tuple_size = MAX_TUPLE_SIZE;
 	memtx->force_recovery = force_recovery;
+	memtx->checkpoint_threads = 1;
 
 	memtx->replica_join_cord = NULL;
 
@@ -1382,6 +2033,13 @@ memtx_engine_set_snap_io_rate_limit(struct memtx_engine *memtx, double limit)
 	memtx->snap_io_rate_limit = limit * 1024 * 1024;
 }
 
+void
+memtx_engine_set_checkpoint_threads(struct memtx_engine *memtx, int count)
+{
+	assert(count > 0);
+	memtx->checkpoint_threads = count;
+}
+
 int
 memtx_engine_set_memory(struct memtx_engine *memtx, size_t size)
 {
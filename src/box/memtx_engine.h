@@ -130,6 +130,12 @@ struct memtx_engine {
 	struct xdir snap_dir;
 	/** Limit disk usage of checkpointing (bytes per second). */
 	uint64_t snap_io_rate_limit;
+	/**
+	 * Number of threads writing a snapshot. If greater
+	 * than 1, user spaces are distributed among additional
+	 * snapshot files written concurrently.
+	 */
+	int checkpoint_threads;
 	/** Skip invalid snapshot records if this flag is set. */
 	bool force_recovery;
 	/**
@@ -237,6 +243,9 @@ memtx_engine_recover_snapshot(struct memtx_engine *memtx,
 void
 memtx_engine_set_snap_io_rate_limit(struct memtx_engine *memtx, double limit);
 
+void
+memtx_engine_set_checkpoint_threads(struct memtx_engine *memtx, int count);
+
 int
 memtx_engine_set_memory(struct memtx_engine *memtx, size_t size);
 
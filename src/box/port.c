@@ -202,12 +202,14 @@ port_c_add_str(struct port *base, const char *str, uint32_t len)
 	return 0;
 }
 
-static int
-port_c_dump_msgpack_16(struct port *base, struct obuf *out)
+int
+port_c_dump_msgpack_16_chunk(struct port *base, struct port_c_entry **entry,
+			     int count, struct obuf *out)
 {
-	struct port_c *port = (struct port_c *)base;
+	(void)base;
 	struct port_c_entry *pe;
-	for (pe = port->first; pe != NULL; pe = pe->next) {
+	int dumped = 0;
+	for (pe = *entry; pe != NULL && dumped < count; pe = pe->next) {
 		uint32_t size = pe->mp_size;
 		if (size == 0) {
 			if (tuple_to_obuf(pe->tuple, out) != 0)
@@ -222,8 +224,18 @@ port_c_dump_msgpack_16(struct port *base, struct obuf *out)
 				 "obuf_dup", "data");
 			return -1;
 		});
+		dumped++;
 	}
-	return port->size;
+	*entry = pe;
+	return dumped;
+}
+
+static int
+port_c_dump_msgpack_16(struct port *base, struct obuf *out)
+{
+	struct port_c *port = (struct port_c *)base;
+	struct port_c_entry *pe = port->first;
+	return port_c_dump_msgpack_16_chunk(base, &pe, port->size, out);
 }
 
 static int
@@ -169,6 +169,17 @@ port_c_add_formatted_mp(struct port *port, const char *mp, const char *mp_end,
 int
 port_c_add_str(struct port *port, const char *str, uint32_t len);
 
+/**
+ * Dump at most @a count entries of a C port starting from
+ * @a *entry to @a out in the 1.6 format (without an array
+ * header). On success @a *entry is advanced to the first
+ * entry that has not been dumped or to NULL.
+ * Returns the number of dumped entries or -1 on error.
+ */
+int
+port_c_dump_msgpack_16_chunk(struct port *port, struct port_c_entry **entry,
+			     int count, struct obuf *out);
+
 void
 port_init(void);
 
@@ -111,6 +111,7 @@ recovery_new(const char *wal_dirname, bool force_recovery,
 	xdir_check_xc(&r->wal_dir);
 
 	r->watcher = NULL;
+	r->ignore0 = false;
 	rlist_create(&r->on_close_log);
 
 	guard.is_active = false;
@@ -206,6 +207,15 @@ out:
 	 */
 	if (vclock_compare(&r->vclock, vclock) < 0)
 		vclock_copy(&r->vclock, vclock);
+	/*
+	 * Don't read the rows that have already been recovered
+	 * if the file has an index.
+	 */
+	off_t skipped = xlog_cursor_skip(&r->cursor, &r->vclock, r->ignore0);
+	if (skipped > 0) {
+		say_info("skipped %lld bytes of `%s' using the index",
+			 (long long)skipped, r->cursor.name);
+	}
 	return;
 
 gap_error:
@@ -247,11 +257,15 @@ recover_xlog(struct recovery *r, struct xstream *stream,
 	     const struct vclock *stop_vclock)
 {
 	struct xrow_header row;
+	off_t read_offset = r->cursor.read_offset;
 	while (xlog_cursor_next_xc(&r->cursor, &row,
 				   r->wal_dir.force_recovery) == 0) {
-		if (++stream->row_count % WAL_ROWS_PER_YIELD == 0) {
+		if (++stream->row_count % WAL_ROWS_PER_YIELD == 0 ||
+		    (stream->yield_on_read &&
+		     r->cursor.read_offset != read_offset)) {
 			xstream_yield(stream);
 		}
+		read_offset = r->cursor.read_offset;
 		if (stream->row_count % 100000 == 0) {
 			say_info_ratelimited("%.1fM rows processed",
 					     stream->row_count / 1e6);
@@ -364,6 +378,22 @@ recover_current_wal:
 	region_free(&fiber()->gc);
 }
 
+void
+recovery_skip_log(struct recovery *r, bool is_rotated)
+{
+	if (xlog_cursor_is_open(&r->cursor)) {
+		xlog_cursor_close(&r->cursor, false);
+		is_rotated = true;
+	}
+	/*
+	 * Files between the closed one and the one containing
+	 * r->vclock weren't read, so don't check them for gaps.
+	 */
+	r->cursor.state = XLOG_CURSOR_NEW;
+	if (is_rotated)
+		trigger_run_xc(&r->on_close_log, NULL);
+}
+
 void
 recovery_finalize(struct recovery *r)
 {
@@ -56,6 +56,12 @@ struct recovery {
 	struct fiber *watcher;
 	/** List of triggers invoked when the current WAL is closed. */
 	struct rlist on_close_log;
+	/**
+	 * Set if the stream ignores rows signed with zero replica
+	 * id, i.e. local space changes, like a relay does. Lets
+	 * recovery skip more rows using WAL indexes.
+	 */
+	bool ignore0;
 };
 
 struct recovery *
@@ -83,6 +89,17 @@ recovery_follow_local(struct recovery *r, struct xstream *stream,
 void
 recovery_stop_local(struct recovery *r);
 
+/**
+ * Close the current WAL without reading it till the end. Used when
+ * the rows up to r->vclock have been got from elsewhere, e.g. from
+ * memory. The next recover_remaining_wals() opens the WAL containing
+ * r->vclock, so it must be called with scan_dir set. on_close_log
+ * triggers are run if a WAL is closed or @a is_rotated is set, i.e.
+ * a new WAL has been created since the last call.
+ */
+void
+recovery_skip_log(struct recovery *r, bool is_rotated);
+
 void
 recovery_finalize(struct recovery *r);
 
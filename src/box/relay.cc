@@ -46,7 +46,9 @@
 #include "iostream.h"
 #include "iproto_constants.h"
 #include "recovery.h"
+#include "relay_feed.h"
 #include "replication.h"
+#include "schema_def.h"
 #include "trigger.h"
 #include "vclock/vclock.h"
 #include "version.h"
@@ -58,6 +60,17 @@
 #include "raft.h"
 
 #include <stdlib.h>
+#include <small/ibuf.h>
+#include <zstd.h>
+
+enum {
+	/**
+	 * Rows read from WAL are accumulated in the relay output
+	 * buffer and written to the socket at once when the buffer
+	 * reaches this size or the rows read so far are processed.
+	 */
+	RELAY_SEND_BUF_SIZE = 128 * 1024,
+};
 
 /**
  * Cbus message to send status updates from relay to tx thread.
@@ -101,15 +114,59 @@ struct relay_raft_msg {
 	struct relay *relay;
 };
 
+/**
+ * A thread serving relays, see replication_relay_threads. Every relay
+ * assigned to the thread runs in a fiber of its own.
+ */
+struct relay_thread {
+	/** The thread. */
+	struct cord cord;
+	/** A pipe from 'tx' to the thread. */
+	struct cpipe relay_pipe;
+	/** A pipe from the thread to 'tx'. */
+	struct cpipe tx_pipe;
+	/** Number of relays served by the thread, accessed from tx. */
+	int relay_count;
+};
+
+/** Relay threads, replication_relay_threads of them. */
+static struct relay_thread *relay_threads;
+
+/**
+ * Cbus message to run a relay in a relay thread. It travels to the
+ * relay thread when the relay is started and back to tx when the
+ * relay exits.
+ */
+struct relay_thread_msg {
+	struct cmsg base;
+	/** The relay to run. */
+	struct relay *relay;
+	/** Fiber function running the relay. */
+	fiber_func f;
+	/** The fiber waiting for the relay to exit, in tx. */
+	struct fiber *caller;
+	/** Set in tx when the relay has exited. */
+	bool is_done;
+	/** Return code of the relay fiber function. */
+	int rc;
+	/** Error the relay exited with if rc is not 0. */
+	struct diag diag;
+};
 
 /** State of a replication relay. */
 struct relay {
-	/** The thread in which we relay data to the replica. */
+	/**
+	 * The thread in which we relay data to the replica. Not used
+	 * if the relay runs in one of the relay threads.
+	 */
 	struct cord cord;
+	/**
+	 * The relay thread serving the relay or NULL if the relay runs
+	 * in a thread of its own.
+	 */
+	struct relay_thread *thread;
 	/** Replica connection */
 	struct iostream *io;
-	/** Request sync */
-	uint64_t sync;
 	/** Recovery instance to read xlog from the disk */
 	struct recovery *r;
 	/** Xstream argument to recovery */
@@ -134,12 +191,19 @@ struct relay {
 	 */
 	uint64_t sent_raft_term;
 	/**
-	 * A filter of replica ids whose rows should be ignored.
-	 * Each set filter bit corresponds to a replica id whose
-	 * rows shouldn't be relayed. The list of ids to ignore
-	 * is passed by the replica on subscribe.
+	 * Request sync and the filters passed by the replica on
+	 * subscribe, see relay_send_row().
 	 */
-	uint32_t id_filter;
+	struct relay_feed_opts opts;
+	/**
+	 * Rows encoded for the relays subscribed with the same
+	 * options, NULL unless the relay serves a subscribe.
+	 */
+	struct relay_feed *feed;
+	/** Number of WAL writes sent from the feed. */
+	int64_t feed_hits;
+	/** Number of times the relay had to read WAL files. */
+	int64_t feed_misses;
 	/**
 	 * Local vclock at the moment of subscribe, used to check
 	 * dataset on the other side and send missing data rows if any.
@@ -165,6 +229,25 @@ struct relay {
 	 * confirmation from the replica.
 	 */
 	struct stailq pending_gc;
+	/**
+	 * Rows encoded but not yet written to the socket. Used
+	 * only in the relay thread, see relay_send_row().
+	 */
+	struct ibuf send_buf;
+	/** Compression of the stream sent to the replica. */
+	enum iproto_compression compression;
+	/**
+	 * zstd context compressing the stream. The history is kept
+	 * between writes, so small rows compress well. Used only in
+	 * the relay thread.
+	 */
+	ZSTD_CCtx *zstd;
+	/** Compressed data not yet written to the socket. */
+	struct ibuf zstd_buf;
+	/** Bytes sent to the replica before compression. */
+	int64_t zstd_bytes_in;
+	/** Bytes sent to the replica after compression. */
+	int64_t zstd_bytes_out;
 	/** Time when last row was sent to peer. */
 	double last_row_time;
 	/**
@@ -239,6 +322,27 @@ relay_last_row_time(const struct relay *relay)
 	return relay->last_row_time;
 }
 
+bool
+relay_compression_stat(const struct relay *relay, int64_t *bytes_in,
+		       int64_t *bytes_out)
+{
+	if (relay->compression == IPROTO_COMPRESSION_NONE)
+		return false;
+	*bytes_in = relay->zstd_bytes_in;
+	*bytes_out = relay->zstd_bytes_out;
+	return true;
+}
+
+bool
+relay_feed_stat(const struct relay *relay, int64_t *hits, int64_t *misses)
+{
+	if (relay->feed == NULL || !relay_feed_is_enabled())
+		return false;
+	*hits = relay->feed_hits;
+	*misses = relay->feed_misses;
+	return true;
+}
+
 double
 relay_txn_lag(const struct relay *relay)
 {
@@ -251,6 +355,8 @@ static void
 relay_send_initial_join_row(struct xstream *stream, struct xrow_header *row);
 static void
 relay_send_row(struct xstream *stream, struct xrow_header *row);
+static void
+relay_send_error(struct relay *relay, const struct error *e);
 
 struct relay *
 relay_new(struct replica *replica)
@@ -288,11 +394,15 @@ relay_new(struct replica *replica)
 	return relay;
 }
 
+static void
+relay_flush(struct relay *relay);
+
 /** A callback recovery calls every now and then to unblock the event loop. */
 static void
 relay_yield(struct xstream *stream)
 {
-	(void) stream;
+	struct relay *relay = container_of(stream, struct relay, stream);
+	relay_flush(relay);
 	fiber_sleep(0);
 }
 
@@ -304,6 +414,7 @@ static void
 relay_yield_and_send_heartbeat(struct xstream *stream)
 {
 	struct relay *relay = container_of(stream, struct relay, stream);
+	relay_flush(relay);
 	/* Check for a heartbeat timeout. */
 	if (ev_monotonic_now(loop()) - relay->last_row_time >
 	    replication_timeout) {
@@ -325,7 +436,7 @@ relay_start(struct relay *relay, struct iostream *io, uint64_t sync,
 	 */
 	diag_clear(&relay->diag);
 	relay->io = io;
-	relay->sync = sync;
+	relay->opts.sync = sync;
 	relay->state = RELAY_FOLLOW;
 	relay->sent_raft_term = sent_raft_term;
 	relay->last_row_time = ev_monotonic_now(loop());
@@ -360,6 +471,13 @@ relay_exit(struct relay *relay)
 	 */
 	recovery_delete(relay->r);
 	relay->r = NULL;
+	/* Allocated from the relay thread slab cache, too. */
+	ibuf_destroy(&relay->send_buf);
+	if (relay->zstd != NULL) {
+		ZSTD_freeCCtx(relay->zstd);
+		relay->zstd = NULL;
+		ibuf_destroy(&relay->zstd_buf);
+	}
 }
 
 static void
@@ -375,6 +493,10 @@ relay_stop(struct relay *relay)
 	if (relay->r != NULL)
 		recovery_delete(relay->r);
 	relay->r = NULL;
+	relay_feed_opts_destroy(&relay->opts);
+	if (relay->feed != NULL)
+		relay_feed_detach(relay->feed);
+	relay->feed = NULL;
 	relay->state = RELAY_STOPPED;
 	/*
 	 * Needed to track whether relay thread is running or not
@@ -401,19 +523,27 @@ relay_delete(struct relay *relay)
 	free(relay);
 }
 
+/**
+ * Name the relay thread after the peer address. A relay served by
+ * a relay thread names its fiber instead.
+ */
 static void
-relay_set_cord_name(int fd)
+relay_set_name(struct relay *relay)
 {
 	char name[FIBER_NAME_MAX];
 	struct sockaddr_storage peer;
 	socklen_t addrlen = sizeof(peer);
-	if (getpeername(fd, ((struct sockaddr*)&peer), &addrlen) == 0) {
+	if (getpeername(relay->io->fd, ((struct sockaddr*)&peer),
+			&addrlen) == 0) {
 		snprintf(name, sizeof(name), "relay/%s",
 			 sio_strfaddr((struct sockaddr *)&peer, addrlen));
 	} else {
 		snprintf(name, sizeof(name), "relay/<unknown>");
 	}
-	cord_set_name(name);
+	if (relay->thread != NULL)
+		fiber_set_name(fiber(), name);
+	else
+		cord_set_name(name);
 }
 
 void
@@ -497,12 +627,14 @@ relay_final_join_f(va_list ap)
 	auto guard = make_scoped_guard([=] { relay_exit(relay); });
 
 	coio_enable();
-	relay_set_cord_name(relay->io->fd);
+	relay_set_name(relay);
+	ibuf_create(&relay->send_buf, &cord()->slabc, RELAY_SEND_BUF_SIZE);
 
 	/* Send all WALs until stop_vclock */
 	assert(relay->stream.write != NULL);
 	recover_remaining_wals(relay->r, &relay->stream,
 			       &relay->stop_vclock, true);
+	relay_flush(relay);
 	assert(vclock_compare(&relay->r->vclock, &relay->stop_vclock) == 0);
 	return 0;
 }
@@ -528,6 +660,8 @@ relay_final_join(struct iostream *io, uint64_t sync,
 	 */
 	vclock_copy(&relay->recv_vclock, start_vclock);
 	relay->r = recovery_new(wal_dir(), false, start_vclock);
+	/* Local rows aren't relayed, see relay_send_row(). */
+	relay->r->ignore0 = true;
 	vclock_copy(&relay->stop_vclock, stop_vclock);
 
 	int rc = cord_costart(&relay->cord, "final_join",
@@ -666,6 +800,73 @@ relay_set_error(struct relay *relay, struct error *e)
 		diag_set_error(&relay->diag, e);
 }
 
+/**
+ * Check if the relay can send the rows encoded by the WAL, i.e. they
+ * are the same as relay_send_row() would send.
+ */
+static bool
+relay_can_use_feed(struct relay *relay)
+{
+	if (relay->feed == NULL || !relay_feed_is_enabled())
+		return false;
+	/* Error injections are applied in relay_send_row(). */
+	struct errinj *inj = errinj(ERRINJ_RELAY_BREAK_LSN, ERRINJ_INT);
+	if (inj != NULL && inj->iparam >= 0)
+		return false;
+	inj = errinj(ERRINJ_RELAY_SEND_DELAY, ERRINJ_BOOL);
+	if (inj != NULL && inj->bparam)
+		return false;
+	inj = errinj(ERRINJ_RELAY_TIMEOUT, ERRINJ_DOUBLE);
+	if (inj != NULL && inj->dparam > 0)
+		return false;
+	return true;
+}
+
+static void
+relay_send_chunk(struct relay *relay, struct relay_feed_chunk *chunk);
+
+/**
+ * Send the rows following the relay position from the feed while
+ * they are in memory. Returns true if everything written to WAL has
+ * been sent, false if the rest must be read from files.
+ */
+static bool
+relay_send_feed(struct relay *relay, bool is_rotated)
+{
+	struct recovery *r = relay->r;
+	/*
+	 * Chunks have the rows of all instances. The filtered out rows
+	 * and the rows of the replica itself, which are sent back only
+	 * if it lost them, are handled by relay_send_row().
+	 */
+	uint32_t id_filter = relay->opts.id_filter |
+			     1 << relay->replica->id;
+	struct vclock wal_vclock;
+	struct relay_feed_chunk *chunk;
+	while ((chunk = relay_feed_next(relay->feed, &r->vclock,
+					&wal_vclock)) != NULL) {
+		auto chunk_guard = make_scoped_guard([=] {
+			relay_feed_chunk_unref(chunk);
+		});
+		if ((chunk->replica_ids & id_filter) != 0)
+			return false;
+		relay_send_chunk(relay, chunk);
+		vclock_copy(&r->vclock, &chunk->end);
+		relay->feed_hits++;
+	}
+	/*
+	 * The WAL writes not found in the feed may have only local
+	 * rows, which aren't sent anyway.
+	 */
+	if (!vclock_is_set(&wal_vclock) ||
+	    vclock_compare_ignore0(&wal_vclock, &r->vclock) != 0)
+		return false;
+	vclock_copy(&r->vclock, &wal_vclock);
+	/* Let GC remove the files the relay didn't have to read. */
+	recovery_skip_log(r, is_rotated);
+	return true;
+}
+
 static void
 relay_process_wal_event(struct wal_watcher *watcher, unsigned events)
 {
@@ -683,8 +884,20 @@ relay_process_wal_event(struct wal_watcher *watcher, unsigned events)
 		return;
 	}
 	try {
+		bool is_rotated = (events & WAL_EVENT_ROTATE) != 0;
+		if (relay_can_use_feed(relay)) {
+			if (relay_send_feed(relay, is_rotated))
+				return;
+			relay->feed_misses++;
+		}
+		/*
+		 * New WAL files aren't looked for while the relay
+		 * sends the rows from the feed.
+		 */
 		recover_remaining_wals(relay->r, &relay->stream, NULL,
-				       (events & WAL_EVENT_ROTATE) != 0);
+				       is_rotated ||
+				       !xlog_cursor_is_open(&relay->r->cursor));
+		relay_flush(relay);
 	} catch (Exception *e) {
 		relay_set_error(relay, e);
 		fiber_cancel(fiber());
@@ -841,8 +1054,26 @@ relay_subscribe_f(va_list ap)
 {
 	struct relay *relay = va_arg(ap, struct relay *);
 
-	coio_enable();
-	relay_set_cord_name(relay->io->fd);
+	/* Relay threads enable coio once, on start. */
+	if (relay->thread == NULL)
+		coio_enable();
+	/*
+	 * Don't let a relay reading old WAL files from disk stall
+	 * the other relays of the thread.
+	 */
+	relay->stream.yield_on_read = relay->thread != NULL;
+	relay_set_name(relay);
+	ibuf_create(&relay->send_buf, &cord()->slabc, RELAY_SEND_BUF_SIZE);
+	if (relay->compression == IPROTO_COMPRESSION_ZSTD) {
+		relay->zstd = ZSTD_createCCtx();
+		if (relay->zstd == NULL) {
+			diag_set(OutOfMemory, 0, "ZSTD_createCCtx", "zstd");
+			relay_exit(relay);
+			return -1;
+		}
+		ibuf_create(&relay->zstd_buf, &cord()->slabc,
+			    RELAY_SEND_BUF_SIZE);
+	}
 
 	cbus_endpoint_create(&relay->tx_endpoint,
 			     tt_sprintf("relay_tx_%p", relay),
@@ -958,6 +1189,13 @@ relay_subscribe_f(va_list ap)
 	fiber_cancel(reader);
 	fiber_join(reader);
 
+	/*
+	 * The error is also written by iproto once the relay exits,
+	 * but as is, while the replica expects a zstd stream.
+	 */
+	if (relay->zstd != NULL && !diag_is_empty(&relay->diag))
+		relay_send_error(relay, diag_last_error(&relay->diag));
+
 	/* Destroy cpipe to tx. */
 	cbus_unpair(&relay->tx_pipe, &relay->relay_pipe,
 		    NULL, NULL, cbus_process);
@@ -978,11 +1216,163 @@ relay_subscribe_f(va_list ap)
 	return -1;
 }
 
+/** Relay thread fiber function. */
+static int
+relay_thread_f(va_list ap)
+{
+	struct relay_thread *thread = va_arg(ap, struct relay_thread *);
+	struct cbus_endpoint endpoint;
+	int rc = cbus_endpoint_create(&endpoint, cord()->name,
+				      fiber_schedule_cb, fiber());
+	assert(rc == 0);
+	(void)rc;
+
+	coio_enable();
+	cpipe_create(&thread->tx_pipe, "tx_prio");
+
+	cbus_loop(&endpoint);
+
+	unreachable();
+}
+
+void
+relay_init(void)
+{
+	if (replication_relay_threads == 0)
+		return;
+	relay_threads = (struct relay_thread *)
+		xcalloc(replication_relay_threads, sizeof(*relay_threads));
+	for (int i = 0; i < replication_relay_threads; i++) {
+		struct relay_thread *thread = &relay_threads[i];
+		const char *name = tt_sprintf("relay_%d", i + 1);
+		if (cord_costart(&thread->cord, name, relay_thread_f,
+				 thread) != 0)
+			panic("failed to start relay thread");
+		cpipe_create(&thread->relay_pipe, name);
+	}
+}
+
+void
+relay_free(void)
+{
+	for (int i = 0; i < replication_relay_threads; i++) {
+		struct relay_thread *thread = &relay_threads[i];
+		tt_pthread_cancel(thread->cord.id);
+		tt_pthread_join(thread->cord.id, NULL);
+	}
+	free(relay_threads);
+	relay_threads = NULL;
+}
+
+/** Return the relay thread serving the fewest relays. */
+static struct relay_thread *
+relay_thread_next(void)
+{
+	struct relay_thread *next = &relay_threads[0];
+	for (int i = 1; i < replication_relay_threads; i++) {
+		if (relay_threads[i].relay_count < next->relay_count)
+			next = &relay_threads[i];
+	}
+	return next;
+}
+
+/** Called in tx when a relay running in a relay thread exits. */
+static void
+relay_thread_msg_done(struct cmsg *base)
+{
+	struct relay_thread_msg *msg = (struct relay_thread_msg *)base;
+	msg->is_done = true;
+	fiber_wakeup(msg->caller);
+}
+
+/** Send the result of a relay back to tx. */
+static void
+relay_thread_msg_complete(struct relay_thread_msg *msg, int rc)
+{
+	static const struct cmsg_hop route[] = {
+		{relay_thread_msg_done, NULL},
+	};
+	msg->rc = rc;
+	if (rc != 0)
+		diag_move(diag_get(), &msg->diag);
+	cmsg_init(&msg->base, route);
+	cpipe_push(&msg->relay->thread->tx_pipe, &msg->base);
+}
+
+/**
+ * A fiber in a relay thread running the relay in a joinable fiber
+ * and reporting its result to tx.
+ */
+static int
+relay_thread_fiber_f(va_list ap)
+{
+	struct relay_thread_msg *msg = va_arg(ap, struct relay_thread_msg *);
+	struct fiber *relay_fiber = fiber_new("relay", msg->f);
+	if (relay_fiber == NULL) {
+		relay_thread_msg_complete(msg, -1);
+		return 0;
+	}
+	fiber_set_joinable(relay_fiber, true);
+	fiber_start(relay_fiber, msg->relay);
+	relay_thread_msg_complete(msg, fiber_join(relay_fiber));
+	return 0;
+}
+
+/** Start a relay in a relay thread. */
+static void
+relay_thread_msg_start(struct cmsg *base)
+{
+	struct relay_thread_msg *msg = (struct relay_thread_msg *)base;
+	struct fiber *fiber = fiber_new("relay_waiter", relay_thread_fiber_f);
+	if (fiber == NULL) {
+		relay_thread_msg_complete(msg, -1);
+		return;
+	}
+	fiber_start(fiber, msg);
+}
+
+/**
+ * Run the relay in a fiber of the least loaded relay thread and
+ * wait for it to exit. Returns the return code of the fiber function
+ * and sets the diagnostics on failure, like cord_cojoin().
+ */
+static int
+relay_thread_run(struct relay *relay, fiber_func f)
+{
+	assert(relay->thread == NULL);
+	struct relay_thread *thread = relay_thread_next();
+	static const struct cmsg_hop route[] = {
+		{relay_thread_msg_start, NULL},
+	};
+	struct relay_thread_msg msg;
+	cmsg_init(&msg.base, route);
+	msg.relay = relay;
+	msg.f = f;
+	msg.caller = fiber();
+	msg.is_done = false;
+	msg.rc = 0;
+	diag_create(&msg.diag);
+	relay->thread = thread;
+	thread->relay_count++;
+	cpipe_push(&thread->relay_pipe, &msg.base);
+	/* The relay refers to the message until it's done. */
+	while (!msg.is_done)
+		fiber_yield();
+	thread->relay_count--;
+	relay->thread = NULL;
+	if (msg.rc != 0)
+		diag_move(&msg.diag, diag_get());
+	diag_destroy(&msg.diag);
+	return msg.rc;
+}
+
 /** Replication acceptor fiber handler. */
 void
 relay_subscribe(struct replica *replica, struct iostream *io, uint64_t sync,
 		struct vclock *replica_clock, uint32_t replica_version_id,
-		uint32_t replica_id_filter, uint64_t sent_raft_term)
+		uint32_t replica_id_filter, uint64_t sent_raft_term,
+		enum iproto_compression compression, const uint32_t *spaces,
+		uint32_t space_count)
 {
 	assert(replica->anon || replica->id != REPLICA_ID_NIL);
 	struct relay *relay = replica->relay;
@@ -1016,28 +1406,191 @@ relay_subscribe(struct replica *replica, struct iostream *io, uint64_t sync,
 	 */
 	vclock_copy(&relay->recv_vclock, replica_clock);
 	relay->r = recovery_new(wal_dir(), false, replica_clock);
+	/* Local rows aren't relayed, see relay_send_row(). */
+	relay->r->ignore0 = true;
 	vclock_copy(&relay->tx.vclock, replica_clock);
 	relay->version_id = replica_version_id;
 
-	relay->id_filter = replica_id_filter;
-
-	int rc = cord_costart(&relay->cord, "subscribe",
-			      relay_subscribe_f, relay);
-	if (rc == 0)
-		rc = cord_cojoin(&relay->cord);
+	relay_feed_opts_create(&relay->opts, sync, replica_id_filter, spaces,
+			       space_count);
+	relay->feed = relay_feed_attach(&relay->opts);
+	relay->feed_hits = 0;
+	relay->feed_misses = 0;
+	relay->compression = compression;
+	relay->zstd_bytes_in = 0;
+	relay->zstd_bytes_out = 0;
+
+	int rc;
+	if (replication_relay_threads > 0) {
+		rc = relay_thread_run(relay, relay_subscribe_f);
+	} else {
+		rc = cord_costart(&relay->cord, "subscribe",
+				  relay_subscribe_f, relay);
+		if (rc == 0)
+			rc = cord_cojoin(&relay->cord);
+	}
 	if (rc != 0)
 		diag_raise();
 }
 
+/**
+ * Compress the rows accumulated in the relay output buffer into
+ * the compressed output buffer. The zstd stream is flushed, so the
+ * replica can decode all the rows as soon as it receives the data.
+ */
+static void
+relay_compress(struct relay *relay)
+{
+	struct ibuf *buf = &relay->send_buf;
+	ZSTD_inBuffer in = {buf->rpos, ibuf_used(buf), 0};
+	size_t rc;
+	do {
+		size_t size = ZSTD_CStreamOutSize();
+		void *dst = ibuf_reserve(&relay->zstd_buf, size);
+		if (dst == NULL) {
+			tnt_raise(OutOfMemory, size, "ibuf_reserve",
+				  "relay compression buffer");
+		}
+		ZSTD_outBuffer out = {dst, size, 0};
+		rc = ZSTD_compressStream2(relay->zstd, &out, &in,
+					  ZSTD_e_flush);
+		if (ZSTD_isError(rc)) {
+			tnt_raise(ClientError, ER_COMPRESSION,
+				  ZSTD_getErrorName(rc));
+		}
+		ibuf_alloc(&relay->zstd_buf, out.pos);
+	} while (rc != 0);
+	relay->zstd_bytes_in += ibuf_used(buf);
+	relay->zstd_bytes_out += ibuf_used(&relay->zstd_buf);
+	ibuf_reset(buf);
+}
+
+/** Write the rows accumulated by relay_send_row() to the socket. */
 static void
-relay_send(struct relay *relay, struct xrow_header *packet)
+relay_flush(struct relay *relay)
 {
-	ERROR_INJECT_YIELD(ERRINJ_RELAY_SEND_DELAY);
+	struct ibuf *buf = &relay->send_buf;
+	if (ibuf_used(buf) == 0)
+		return;
+	if (relay->zstd != NULL) {
+		relay_compress(relay);
+		buf = &relay->zstd_buf;
+	}
+	size_t size = ibuf_used(buf);
+	struct iovec iov;
+	iov.iov_base = buf->rpos;
+	iov.iov_len = size;
+	if (coio_writev(relay->io, &iov, 1, size) < 0)
+		diag_raise();
+	ibuf_reset(buf);
+}
 
-	packet->sync = relay->sync;
+/** Encode a row into the relay output buffer. */
+static void
+relay_encode_row(struct relay *relay, struct xrow_header *packet)
+{
+	packet->sync = relay->opts.sync;
 	relay->last_row_time = ev_monotonic_now(loop());
-	coio_write_xrow(relay->io, packet);
+	struct iovec iov[XROW_IOVMAX];
+	int iovcnt = xrow_to_iovec_xc(packet, iov);
+	for (int i = 0; i < iovcnt; i++) {
+		void *data = ibuf_alloc(&relay->send_buf, iov[i].iov_len);
+		if (data == NULL) {
+			tnt_raise(OutOfMemory, iov[i].iov_len, "ibuf_alloc",
+				  "relay send buffer");
+		}
+		memcpy(data, iov[i].iov_base, iov[i].iov_len);
+	}
 	fiber_gc();
+}
+
+/** Write the rows of a feed chunk to the socket. */
+static void
+relay_send_chunk(struct relay *relay, struct relay_feed_chunk *chunk)
+{
+	relay->last_row_time = ev_monotonic_now(loop());
+	if (relay->zstd != NULL) {
+		/* The rows must go through the zstd stream. */
+		void *data = ibuf_alloc(&relay->send_buf, chunk->size);
+		if (data == NULL) {
+			tnt_raise(OutOfMemory, chunk->size, "ibuf_alloc",
+				  "relay send buffer");
+		}
+		memcpy(data, chunk->data, chunk->size);
+		relay_flush(relay);
+		return;
+	}
+	relay_flush(relay);
+	struct iovec iov;
+	iov.iov_base = chunk->data;
+	iov.iov_len = chunk->size;
+	if (coio_writev(relay->io, &iov, 1, chunk->size) < 0)
+		diag_raise();
+}
+
+/**
+ * Send the error the relay exits with to the replica through the
+ * compressed stream. The replica stops reading on the error, so
+ * it ignores the uncompressed copy written by iproto after that.
+ * Failures are ignored: the replica reconnects anyway.
+ */
+static void
+relay_send_error(struct relay *relay, const struct error *e)
+{
+	assert(relay->zstd != NULL);
+	/* Unsent rows are sent again on reconnect. */
+	ibuf_reset(&relay->send_buf);
+	struct xrow_header row;
+	try {
+		if (xrow_encode_error(&row, e) != 0)
+			diag_raise();
+		relay_encode_row(relay, &row);
+		relay_flush(relay);
+	} catch (Exception *) {
+	}
+}
+
+/**
+ * Append a row to the relay output buffer. Unlike relay_send(),
+ * the row isn't written right away, so that all rows read from
+ * WAL in one go are written with a single syscall.
+ */
+static void
+relay_send_buffered(struct relay *relay, struct xrow_header *packet)
+{
+	struct errinj *inj = errinj(ERRINJ_RELAY_SEND_DELAY, ERRINJ_BOOL);
+	if (inj != NULL && inj->bparam)
+		relay_flush(relay);
+	ERROR_INJECT_YIELD(ERRINJ_RELAY_SEND_DELAY);
+
+	relay_encode_row(relay, packet);
+	if (ibuf_used(&relay->send_buf) >= RELAY_SEND_BUF_SIZE)
+		relay_flush(relay);
+
+	inj = errinj(ERRINJ_RELAY_TIMEOUT, ERRINJ_DOUBLE);
+	if (inj != NULL && inj->dparam > 0) {
+		relay_flush(relay);
+		fiber_sleep(inj->dparam);
+	}
+}
+
+static void
+relay_send(struct relay *relay, struct xrow_header *packet)
+{
+	/* Keep the order of rows buffered by relay_send_row(). */
+	relay_flush(relay);
+	ERROR_INJECT_YIELD(ERRINJ_RELAY_SEND_DELAY);
+
+	if (relay->zstd != NULL) {
+		/* The row must go through the zstd stream. */
+		relay_encode_row(relay, packet);
+		relay_flush(relay);
+	} else {
+		packet->sync = relay->opts.sync;
+		relay->last_row_time = ev_monotonic_now(loop());
+		coio_write_xrow(relay->io, packet);
+		fiber_gc();
+	}
 
 	struct errinj *inj = errinj(ERRINJ_RELAY_TIMEOUT, ERRINJ_DOUBLE);
 	if (inj != NULL && inj->dparam > 0)
@@ -1118,26 +1671,11 @@ static void
 relay_send_row(struct xstream *stream, struct xrow_header *packet)
 {
 	struct relay *relay = container_of(stream, struct relay, stream);
-	if (packet->group_id == GROUP_LOCAL) {
-		/*
-		 * We do not relay replica-local rows to other
-		 * instances, since we started signing them with
-		 * a zero instance id. However, if replica-local
-		 * rows, signed with a non-zero id are present in
-		 * our WAL, we still need to relay them as NOPs in
-		 * order to correctly promote the vclock on the
-		 * replica.
-		 */
-		if (packet->replica_id == REPLICA_ID_NIL)
-			return;
-		packet->type = IPROTO_NOP;
-		packet->group_id = GROUP_DEFAULT;
-		packet->bodycnt = 0;
-	}
-	assert(iproto_type_is_dml(packet->type) ||
-	       iproto_type_is_synchro_request(packet->type));
-	/* Check if the rows from the instance are filtered. */
-	if ((1 << packet->replica_id & relay->id_filter) != 0)
+	/* The WAL prepares the rows for relay feeds the same way. */
+	bool is_skipped;
+	if (relay_feed_prepare_row(&relay->opts, packet, &is_skipped) != 0)
+		diag_raise();
+	if (is_skipped)
 		return;
 	/*
 	 * We're feeding a WAL, thus responding to FINAL JOIN or SUBSCRIBE
@@ -1166,6 +1704,8 @@ relay_send_row(struct xstream *stream, struct xrow_header *packet)
 		if (iproto_type_is_promote_request(packet->type)) {
 			struct synchro_request req;
 			xrow_decode_synchro(packet, &req);
+			/* Don't hold the rows while waiting for the term. */
+			relay_flush(relay);
 			/*
 			 * PROMOTE/DEMOTE should be sent only after
 			 * corresponding RAFT term was already sent.
@@ -1183,6 +1723,6 @@ relay_send_row(struct xstream *stream, struct xrow_header *packet)
 				fiber_yield();
 			}
 		}
-		relay_send(relay, packet);
+		relay_send_buffered(relay, packet);
 	}
 }
@@ -31,8 +31,11 @@
  * SUCH DAMAGE.
  */
 
+#include <stdbool.h>
 #include <stdint.h>
 
+#include "iproto_constants.h"
+
 #if defined(__cplusplus)
 extern "C" {
 #endif /* defined(__cplusplus) */
@@ -58,6 +61,17 @@ enum relay_state {
 	RELAY_STOPPED,
 };
 
+/**
+ * Start the relay threads, see replication_relay_threads.
+ * Called on replication initialization.
+ */
+void
+relay_init(void);
+
+/** Stop the relay threads. Called on shutdown. */
+void
+relay_free(void);
+
 /** Create a relay which is not running. object. */
 struct relay *
 relay_new(struct replica *replica);
@@ -100,6 +114,26 @@ relay_last_row_time(const struct relay *relay);
 double
 relay_txn_lag(const struct relay *relay);
 
+/**
+ * Get the number of bytes the relay has sent to the replica before
+ * and after compression.
+ * @retval true the stream is compressed.
+ * @retval false the stream isn't compressed, the counters aren't set.
+ */
+bool
+relay_compression_stat(const struct relay *relay, int64_t *bytes_in,
+		       int64_t *bytes_out);
+
+/**
+ * Get the number of WAL writes the relay has sent from memory and the
+ * number of times it had to read WAL files instead.
+ * @retval true the relay uses a replication feed, which is enabled.
+ * @retval false the relay reads all rows from files, the counters
+ *         aren't set.
+ */
+bool
+relay_feed_stat(const struct relay *relay, int64_t *hits, int64_t *misses);
+
 /**
  * Send a Raft update request to the relay channel. It is not
  * guaranteed that it will be delivered. The connection may break.
@@ -136,11 +170,20 @@ relay_final_join(struct iostream *io, uint64_t sync,
 /**
  * Subscribe a replica to updates.
  *
+ * If @a compression is not IPROTO_COMPRESSION_NONE, everything the
+ * relay sends is a single zstd stream, flushed after every write.
+ *
+ * If @a space_count is not 0, rows of user spaces not listed in
+ * @a spaces are sent as NOPs, so the replica's vclock still
+ * follows the master's one.
+ *
  * @return none.
  */
 void
 relay_subscribe(struct replica *replica, struct iostream *io, uint64_t sync,
 		struct vclock *replica_vclock, uint32_t replica_version_id,
-		uint32_t replica_id_filter, uint64_t sent_raft_term);
+		uint32_t replica_id_filter, uint64_t sent_raft_term,
+		enum iproto_compression compression, const uint32_t *spaces,
+		uint32_t space_count);
 
 #endif /* TARANTOOL_REPLICATION_RELAY_H_INCLUDED */
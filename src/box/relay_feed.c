@@ -0,0 +1,436 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright 2010-2022, Tarantool AUTHORS, please see AUTHORS file.
+ */
+#include "relay_feed.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+
+#include <pmatomic.h>
+
+#include "trivia/util.h"
+#include "tt_pthread.h"
+#include "diag.h"
+#include "fiber.h"
+#include "say.h"
+
+#include "iproto_constants.h"
+#include "journal.h"
+#include "replication.h"
+#include "schema_def.h"
+#include "xrow.h"
+
+/** Rows encoded for relays subscribed with the same options. */
+struct relay_feed {
+	/** Link in relay_feeds. */
+	struct rlist in_feeds;
+	/** Subscription options of the relays using the feed. */
+	struct relay_feed_opts opts;
+	/** Number of relays using the feed. */
+	int refs;
+	/** Chunks in memory, from the oldest to the newest. */
+	struct rlist chunks;
+	/** Total size of the chunks. */
+	size_t size;
+	/**
+	 * Vclock of the last WAL write, cleared until the first write
+	 * made while the feeds are enabled.
+	 */
+	struct vclock wal_vclock;
+};
+
+/**
+ * Protects everything below, the feeds and the chunk reference
+ * counters. Taken by the WAL thread once per write and by relays
+ * once per chunk they send.
+ */
+static pthread_mutex_t relay_feed_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/** All feeds in use. */
+static RLIST_HEAD(relay_feeds);
+
+/**
+ * Maximal size of chunks in a feed, see replication_feed_size. Read
+ * by the WAL thread without the lock to skip the feeds quickly when
+ * they are disabled.
+ */
+static size_t relay_feed_size_max;
+
+static int
+relay_feed_space_id_cmp(const void *a, const void *b)
+{
+	uint32_t id_a = *(const uint32_t *)a;
+	uint32_t id_b = *(const uint32_t *)b;
+	return id_a < id_b ? -1 : id_a > id_b;
+}
+
+void
+relay_feed_opts_create(struct relay_feed_opts *opts, uint64_t sync,
+		       uint32_t id_filter, const uint32_t *spaces,
+		       uint32_t space_count)
+{
+	opts->sync = sync;
+	opts->id_filter = id_filter;
+	opts->spaces = NULL;
+	opts->space_count = space_count;
+	if (space_count == 0)
+		return;
+	opts->spaces = xcalloc(space_count, sizeof(*spaces));
+	memcpy(opts->spaces, spaces, space_count * sizeof(*spaces));
+	qsort(opts->spaces, space_count, sizeof(*spaces),
+	      relay_feed_space_id_cmp);
+}
+
+void
+relay_feed_opts_destroy(struct relay_feed_opts *opts)
+{
+	free(opts->spaces);
+	opts->spaces = NULL;
+	opts->space_count = 0;
+}
+
+/** Check if two relays may share a feed, the id filter is ignored. */
+static bool
+relay_feed_opts_equal(const struct relay_feed_opts *a,
+		      const struct relay_feed_opts *b)
+{
+	return a->sync == b->sync && a->space_count == b->space_count &&
+	       (a->space_count == 0 ||
+		memcmp(a->spaces, b->spaces,
+		       a->space_count * sizeof(*a->spaces)) == 0);
+}
+
+/**
+ * Check if a DML row must be sent to the replica as is, i.e. it
+ * changes a system space or a space the replica subscribed to.
+ */
+static int
+relay_feed_row_is_subscribed(const struct relay_feed_opts *opts,
+			     struct xrow_header *row, bool *is_subscribed)
+{
+	*is_subscribed = true;
+	if (opts->space_count == 0 || row->type == IPROTO_NOP)
+		return 0;
+	uint32_t space_id;
+	if (xrow_decode_space_id(row, &space_id) != 0)
+		return -1;
+	if (space_id < BOX_SYSTEM_ID_MAX)
+		return 0;
+	*is_subscribed = bsearch(&space_id, opts->spaces, opts->space_count,
+				 sizeof(space_id),
+				 relay_feed_space_id_cmp) != NULL;
+	return 0;
+}
+
+int
+relay_feed_prepare_row(const struct relay_feed_opts *opts,
+		       struct xrow_header *row, bool *is_skipped)
+{
+	*is_skipped = false;
+	if (row->group_id == GROUP_LOCAL) {
+		/*
+		 * We do not relay replica-local rows to other
+		 * instances, since we started signing them with
+		 * a zero instance id. However, if replica-local
+		 * rows, signed with a non-zero id are present in
+		 * our WAL, we still need to relay them as NOPs in
+		 * order to correctly promote the vclock on the
+		 * replica.
+		 */
+		if (row->replica_id == REPLICA_ID_NIL) {
+			*is_skipped = true;
+			return 0;
+		}
+		row->type = IPROTO_NOP;
+		row->group_id = GROUP_DEFAULT;
+		row->bodycnt = 0;
+	}
+	assert(iproto_type_is_dml(row->type) ||
+	       iproto_type_is_synchro_request(row->type));
+	/* Check if the rows from the instance are filtered. */
+	if ((1 << row->replica_id & opts->id_filter) != 0) {
+		*is_skipped = true;
+		return 0;
+	}
+	/*
+	 * Rows of the spaces the replica didn't subscribe to are
+	 * relayed as NOPs, like local rows, to promote its vclock.
+	 */
+	if (iproto_type_is_dml(row->type)) {
+		bool is_subscribed;
+		if (relay_feed_row_is_subscribed(opts, row,
+						 &is_subscribed) != 0)
+			return -1;
+		if (!is_subscribed) {
+			row->type = IPROTO_NOP;
+			row->bodycnt = 0;
+		}
+	}
+	return 0;
+}
+
+/**
+ * Encode a WAL row as a relay subscribed with the given options
+ * sends it and add the row author to @a replica_ids. Returns the
+ * number of iovecs, 0 if the row isn't sent, -1 on error.
+ */
+static int
+relay_feed_encode_row(const struct relay_feed_opts *opts,
+		      const struct xrow_header *row, struct iovec *iov,
+		      uint32_t *replica_ids)
+{
+	struct xrow_header packet = *row;
+	bool is_skipped;
+	if (relay_feed_prepare_row(opts, &packet, &is_skipped) != 0)
+		return -1;
+	if (is_skipped)
+		return 0;
+	*replica_ids |= 1 << packet.replica_id;
+	packet.sync = opts->sync;
+	return xrow_to_iovec(&packet, iov);
+}
+
+/**
+ * Encode the rows of the given journal entries for a feed. The row
+ * headers are encoded on the fiber region, the bodies are referenced
+ * in place, and everything is copied to the chunk at once. Returns
+ * NULL if no row is sent with these options.
+ */
+static struct relay_feed_chunk *
+relay_feed_encode(const struct relay_feed_opts *opts, struct stailq *entries,
+		  int row_count)
+{
+	struct region *region = &fiber()->gc;
+	size_t region_svp = region_used(region);
+	struct relay_feed_chunk *chunk = NULL;
+	size_t iov_size;
+	struct iovec *iov = region_alloc_array(region, typeof(iov[0]),
+					       row_count * XROW_IOVMAX,
+					       &iov_size);
+	if (iov == NULL) {
+		diag_set(OutOfMemory, iov_size, "region_alloc_array", "iov");
+		goto out;
+	}
+	struct journal_entry *entry;
+	uint32_t replica_ids = 0;
+	size_t size = 0;
+	int iovcnt = 0;
+	stailq_foreach_entry(entry, entries, fifo) {
+		for (int i = 0; i < entry->n_rows; i++) {
+			int rc = relay_feed_encode_row(opts, entry->rows[i],
+						       iov + iovcnt,
+						       &replica_ids);
+			if (rc < 0)
+				goto out;
+			for (int j = iovcnt; j < iovcnt + rc; j++)
+				size += iov[j].iov_len;
+			iovcnt += rc;
+		}
+	}
+	if (size == 0)
+		goto out;
+	chunk = xmalloc(sizeof(*chunk) + size);
+	chunk->refs = 1;
+	chunk->replica_ids = replica_ids;
+	chunk->size = size;
+	char *pos = chunk->data;
+	for (int i = 0; i < iovcnt; i++) {
+		memcpy(pos, iov[i].iov_base, iov[i].iov_len);
+		pos += iov[i].iov_len;
+	}
+	assert(pos == chunk->data + size);
+out:
+	region_truncate(region, region_svp);
+	if (!diag_is_empty(diag_get())) {
+		/* Relays read such rows from the file and fail there. */
+		diag_log();
+		diag_clear(diag_get());
+	}
+	return chunk;
+}
+
+/**
+ * Count the rows of the given journal entries. Returns -1 if there
+ * are PROMOTE or DEMOTE rows: a relay holds them until it sends the
+ * Raft term they belong to, so batches with them are read from files.
+ */
+static int
+relay_feed_count_rows(struct stailq *entries)
+{
+	int row_count = 0;
+	struct journal_entry *entry;
+	stailq_foreach_entry(entry, entries, fifo) {
+		for (int i = 0; i < entry->n_rows; i++) {
+			if (iproto_type_is_promote_request(
+					entry->rows[i]->type))
+				return -1;
+		}
+		row_count += entry->n_rows;
+	}
+	return row_count;
+}
+
+/** Must be called under relay_feed_mutex. */
+static void
+relay_feed_chunk_unref_locked(struct relay_feed_chunk *chunk)
+{
+	assert(chunk->refs > 0);
+	if (--chunk->refs == 0)
+		free(chunk);
+}
+
+void
+relay_feed_chunk_unref(struct relay_feed_chunk *chunk)
+{
+	tt_pthread_mutex_lock(&relay_feed_mutex);
+	relay_feed_chunk_unref_locked(chunk);
+	tt_pthread_mutex_unlock(&relay_feed_mutex);
+}
+
+/** Drop the oldest chunks that don't fit in the feed size limit. */
+static void
+relay_feed_trim(struct relay_feed *feed, size_t size_max)
+{
+	while (feed->size > size_max) {
+		assert(!rlist_empty(&feed->chunks));
+		struct relay_feed_chunk *chunk = rlist_first_entry(
+			&feed->chunks, struct relay_feed_chunk, in_feed);
+		rlist_del_entry(chunk, in_feed);
+		feed->size -= chunk->size;
+		relay_feed_chunk_unref_locked(chunk);
+	}
+}
+
+struct relay_feed *
+relay_feed_attach(const struct relay_feed_opts *opts)
+{
+	tt_pthread_mutex_lock(&relay_feed_mutex);
+	struct relay_feed *feed;
+	rlist_foreach_entry(feed, &relay_feeds, in_feeds) {
+		if (relay_feed_opts_equal(&feed->opts, opts)) {
+			feed->refs++;
+			goto out;
+		}
+	}
+	feed = xmalloc(sizeof(*feed));
+	relay_feed_opts_create(&feed->opts, opts->sync, 0, opts->spaces,
+			       opts->space_count);
+	feed->refs = 1;
+	rlist_create(&feed->chunks);
+	feed->size = 0;
+	vclock_clear(&feed->wal_vclock);
+	rlist_add_tail_entry(&relay_feeds, feed, in_feeds);
+out:
+	tt_pthread_mutex_unlock(&relay_feed_mutex);
+	return feed;
+}
+
+void
+relay_feed_detach(struct relay_feed *feed)
+{
+	tt_pthread_mutex_lock(&relay_feed_mutex);
+	assert(feed->refs > 0);
+	if (--feed->refs > 0) {
+		tt_pthread_mutex_unlock(&relay_feed_mutex);
+		return;
+	}
+	rlist_del_entry(feed, in_feeds);
+	relay_feed_trim(feed, 0);
+	tt_pthread_mutex_unlock(&relay_feed_mutex);
+	relay_feed_opts_destroy(&feed->opts);
+	free(feed);
+}
+
+/** Vclock signature without the local component. */
+static inline int64_t
+relay_feed_vclock_sum(const struct vclock *vclock)
+{
+	return vclock_sum(vclock) - vclock_get(vclock, 0);
+}
+
+struct relay_feed_chunk *
+relay_feed_next(struct relay_feed *feed, const struct vclock *vclock,
+		struct vclock *wal_vclock)
+{
+	int64_t sum = relay_feed_vclock_sum(vclock);
+	tt_pthread_mutex_lock(&relay_feed_mutex);
+	/*
+	 * Caught up relays need the newest chunk, so look from the
+	 * end. Chunks go in the WAL order, so stop at the first one
+	 * older than the position.
+	 */
+	struct relay_feed_chunk *chunk;
+	rlist_foreach_entry_reverse(chunk, &feed->chunks, in_feed) {
+		int64_t chunk_sum = relay_feed_vclock_sum(&chunk->start);
+		if (chunk_sum < sum)
+			break;
+		if (chunk_sum == sum &&
+		    vclock_compare_ignore0(&chunk->start, vclock) == 0) {
+			chunk->refs++;
+			tt_pthread_mutex_unlock(&relay_feed_mutex);
+			return chunk;
+		}
+	}
+	vclock_copy(wal_vclock, &feed->wal_vclock);
+	tt_pthread_mutex_unlock(&relay_feed_mutex);
+	return NULL;
+}
+
+void
+relay_feed_write(const struct vclock *start, const struct vclock *end,
+		 struct stailq *entries)
+{
+	/* Don't make commits wait for the lock if nobody needs it. */
+	if (pm_atomic_load(&relay_feed_size_max) == 0)
+		return;
+	int row_count = relay_feed_count_rows(entries);
+	tt_pthread_mutex_lock(&relay_feed_mutex);
+	if (relay_feed_size_max == 0) {
+		tt_pthread_mutex_unlock(&relay_feed_mutex);
+		return;
+	}
+	struct relay_feed *feed;
+	rlist_foreach_entry(feed, &relay_feeds, in_feeds) {
+		vclock_copy(&feed->wal_vclock, end);
+		if (row_count <= 0)
+			continue;
+		struct relay_feed_chunk *chunk =
+			relay_feed_encode(&feed->opts, entries, row_count);
+		if (chunk == NULL)
+			continue;
+		vclock_copy(&chunk->start, start);
+		vclock_copy(&chunk->end, end);
+		rlist_add_tail_entry(&feed->chunks, chunk, in_feed);
+		feed->size += chunk->size;
+		relay_feed_trim(feed, relay_feed_size_max);
+	}
+	tt_pthread_mutex_unlock(&relay_feed_mutex);
+}
+
+bool
+relay_feed_is_enabled(void)
+{
+	return pm_atomic_load(&relay_feed_size_max) > 0;
+}
+
+void
+relay_feed_set_size(size_t size)
+{
+	tt_pthread_mutex_lock(&relay_feed_mutex);
+	pm_atomic_store(&relay_feed_size_max, size);
+	struct relay_feed *feed;
+	rlist_foreach_entry(feed, &relay_feeds, in_feeds) {
+		relay_feed_trim(feed, size);
+		/*
+		 * The WAL doesn't update the vclock of disabled feeds,
+		 * so it mustn't be used when they are enabled again.
+		 */
+		if (size == 0)
+			vclock_clear(&feed->wal_vclock);
+	}
+	tt_pthread_mutex_unlock(&relay_feed_mutex);
+}
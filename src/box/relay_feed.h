@@ -0,0 +1,154 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright 2010-2022, Tarantool AUTHORS, please see AUTHORS file.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <small/rlist.h>
+
+#include "vclock/vclock.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+struct stailq;
+struct xrow_header;
+
+/**
+ * Replication feed: WAL rows encoded once for all relays that send
+ * them the same way.
+ *
+ * After every successful write the WAL thread encodes the written
+ * rows as relay_send_row() would do it, once per set of subscription
+ * options in use, and appends them to the feed of these options as a
+ * refcounted chunk. A relay that has sent everything preceding a chunk
+ * writes the chunk to the socket as is instead of reading the rows
+ * from the xlog file. Relays that lag behind the chunks still in
+ * memory read the files. The size of the chunks kept by a feed is
+ * limited by replication_feed_size, the oldest ones are dropped.
+ * The encoding is done before the write is acknowledged to tx, so
+ * the feeds are disabled by default.
+ *
+ * Replicas usually filter out their own rows, so the instance id
+ * filter isn't a part of the feed options, otherwise every relay
+ * would get a feed of its own. Chunks have the rows of all instances
+ * instead, and a relay reads the chunks with the rows it doesn't
+ * send from the file.
+ */
+
+/** Subscription options that define how a relay encodes WAL rows. */
+struct relay_feed_opts {
+	/** Sync of the SUBSCRIBE request, sent in every row. */
+	uint64_t sync;
+	/**
+	 * A filter of replica ids whose rows aren't relayed: each
+	 * set bit corresponds to a replica id.
+	 */
+	uint32_t id_filter;
+	/**
+	 * Sorted ids of the spaces the replica subscribed to, all
+	 * spaces if space_count is 0. Rows of the other user spaces
+	 * are relayed as NOPs.
+	 */
+	uint32_t *spaces;
+	/** Number of ids in spaces. */
+	uint32_t space_count;
+};
+
+/** Rows of one WAL write encoded for a feed. */
+struct relay_feed_chunk {
+	/** Link in relay_feed::chunks. */
+	struct rlist in_feed;
+	/** Reference counter, protected by the feed mutex. */
+	int refs;
+	/** WAL vclock before the first row of the chunk. */
+	struct vclock start;
+	/** WAL vclock after the last row of the chunk. */
+	struct vclock end;
+	/** Bitmap of the ids of the instances whose rows are sent. */
+	uint32_t replica_ids;
+	/** Size of the encoded rows. */
+	size_t size;
+	/** The encoded rows, ready to be sent to a replica. */
+	char data[0];
+};
+
+struct relay_feed;
+
+/** Initialize subscription options. The space ids are copied. */
+void
+relay_feed_opts_create(struct relay_feed_opts *opts, uint64_t sync,
+		       uint32_t id_filter, const uint32_t *spaces,
+		       uint32_t space_count);
+
+/** Free the space ids of subscription options. */
+void
+relay_feed_opts_destroy(struct relay_feed_opts *opts);
+
+/**
+ * Prepare a WAL row to be sent to a replica subscribed with the given
+ * options. Replica-local rows and rows of the spaces the replica
+ * didn't subscribe to are turned into NOPs. Sets @a is_skipped if the
+ * row mustn't be sent at all.
+ * @retval 0 success.
+ * @retval -1 the row can't be decoded, the diag is set.
+ */
+int
+relay_feed_prepare_row(const struct relay_feed_opts *opts,
+		       struct xrow_header *row, bool *is_skipped);
+
+/**
+ * Get the feed of the given options, creating it if needed. The WAL
+ * thread starts filling it with the next write. The options are
+ * copied, the instance id filter is ignored. Never fails.
+ */
+struct relay_feed *
+relay_feed_attach(const struct relay_feed_opts *opts);
+
+/** Release a feed got with relay_feed_attach(). */
+void
+relay_feed_detach(struct relay_feed *feed);
+
+/**
+ * Find the chunk following @a vclock, ignoring the local component.
+ * Returns a referenced chunk or NULL if there's none in memory. In
+ * the latter case @a wal_vclock is set to the vclock of the last WAL
+ * write, or cleared if it's unknown.
+ */
+struct relay_feed_chunk *
+relay_feed_next(struct relay_feed *feed, const struct vclock *vclock,
+		struct vclock *wal_vclock);
+
+/** Release a chunk got with relay_feed_next(). */
+void
+relay_feed_chunk_unref(struct relay_feed_chunk *chunk);
+
+/**
+ * Add the rows of the given journal entries, written to WAL from
+ * @a start to @a end, to the feeds. Called by the WAL thread after
+ * every write, even failed or empty ones, so that relays know the
+ * current WAL vclock. Returns at once if the feeds are disabled.
+ */
+void
+relay_feed_write(const struct vclock *start, const struct vclock *end,
+		 struct stailq *entries);
+
+/** Check if the feeds are enabled, i.e. replication_feed_size > 0. */
+bool
+relay_feed_is_enabled(void);
+
+/**
+ * Set the maximal size of chunks kept by each feed, 0 disables
+ * the feeds and frees the chunks.
+ */
+void
+relay_feed_set_size(size_t size);
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif /* defined(__cplusplus) */
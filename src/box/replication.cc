@@ -55,8 +55,13 @@ int replication_synchro_quorum = 1;
 double replication_synchro_timeout = 5.0; /* seconds */
 double replication_sync_timeout = 300.0; /* seconds */
 bool replication_skip_conflict = false;
+bool replication_compression = false;
+uint32_t *replication_spaces = NULL;
+uint32_t replication_space_count = 0;
+bool replication_spaces_are_used = false;
 bool replication_anon = false;
 int replication_threads = 1;
+int replication_relay_threads = 0;
 
 struct replicaset replicaset;
 
@@ -91,7 +96,7 @@ replicaset_quorum(void)
 }
 
 void
-replication_init(int num_threads)
+replication_init(int num_threads, int num_relay_threads)
 {
 	memset(&replicaset, 0, sizeof(replicaset));
 	replica_hash_new(&replicaset.hash);
@@ -110,11 +115,13 @@ replication_init(int num_threads)
 	diag_create(&replicaset.applier.diag);
 
 	replication_threads = num_threads;
+	replication_relay_threads = num_relay_threads;
 
 	/* The local instance is always part of the quorum. */
 	replicaset.healthy_count = 1;
 
 	applier_init();
+	relay_init();
 }
 
 void
@@ -127,11 +134,13 @@ replication_free(void)
 	 */
 	replicaset_foreach(replica)
 		relay_cancel(replica->relay);
+	relay_free();
 
 	diag_destroy(&replicaset.applier.diag);
 	trigger_destroy(&replicaset.on_ack);
 
 	applier_free();
+	free(replication_spaces);
 }
 
 int
@@ -151,6 +151,27 @@ extern double replication_sync_timeout;
  */
 extern bool replication_skip_conflict;
 
+/**
+ * Whether to request a compressed replication stream from masters.
+ * Takes effect on the next SUBSCRIBE.
+ */
+extern bool replication_compression;
+
+/**
+ * Ids of the spaces whose rows to request from masters, all
+ * spaces if replication_space_count is 0. Rows of system spaces
+ * are always replicated. Takes effect on the next SUBSCRIBE.
+ */
+extern uint32_t *replication_spaces;
+extern uint32_t replication_space_count;
+
+/**
+ * Set once this instance has subscribed with a non-empty
+ * replication_spaces. After that the list can only be narrowed,
+ * since the rows of the other spaces were skipped.
+ */
+extern bool replication_spaces_are_used;
+
 /**
  * Whether this replica will be anonymous or not, e.g. be preset
  * in _cluster table and have a non-zero id.
@@ -160,6 +181,12 @@ extern bool replication_anon;
 /** How many threads to use for decoding incoming replication stream. */
 extern int replication_threads;
 
+/**
+ * How many threads to use for relaying data to replicas. Each of them
+ * serves many relays. 0 means that every relay gets a thread of its own.
+ */
+extern int replication_relay_threads;
+
 /**
  * A list of triggers fired once quorum of "healthy" connections is acquired.
  */
@@ -191,7 +218,7 @@ replication_disconnect_timeout(void)
 }
 
 void
-replication_init(int num_threads);
+replication_init(int num_threads, int num_relay_threads);
 
 void
 replication_free(void);
@@ -41,7 +41,11 @@
 #include "vy_log.h"
 #include "cbus.h"
 #include "coio_task.h"
+#include "coio_file.h"
 #include "replication.h"
+#include "relay_feed.h"
+#include "histogram.h"
+#include "info/info.h"
 
 enum {
 	/**
@@ -53,6 +57,14 @@ enum {
 	 * latency. 1 MB seems to be a well balanced choice.
 	 */
 	WAL_FALLOCATE_LEN = 1024 * 1024,
+	/**
+	 * Distance between entries of the index written next to
+	 * a WAL file, see xlog_opts::index_step. A relay starting
+	 * from the middle of a file reads at most this much data
+	 * it doesn't need. The index of a 256 MB file takes a few
+	 * KB.
+	 */
+	WAL_INDEX_STEP = 1024 * 1024,
 };
 
 const char *wal_mode_STRS[WAL_MODE_MAX] = {
@@ -107,11 +119,52 @@ struct wal_writer
 	 * rolled back too.
 	 */
 	struct journal_entry *last_entry;
+	/**
+	 * Maximal time a journal entry may be held in tx waiting
+	 * for the previous batch to be written, 0 disables group
+	 * commit. See wal_write_async().
+	 */
+	double group_commit_max_delay;
+	/**
+	 * While a batch is being written, new entries are collected
+	 * in this batch rather than sent to WAL thread in batches of
+	 * their own. NULL if there are no such entries.
+	 */
+	struct wal_msg *pending_batch;
+	/** Time when the pending batch got its first entry. */
+	double pending_batch_start;
+	/** Flushes the pending batch after group_commit_max_delay. */
+	struct ev_timer group_commit_timer;
+	/** Number of batches sent to WAL thread and not completed. */
+	int n_batches_in_flight;
+	/** Number of journal entries in written batches. */
+	struct histogram *batch_size_hist;
+	/** Time spent by batches in pending state, in microseconds. */
+	struct histogram *batch_wait_hist;
+	/**
+	 * Vclock of the rows known to be synced to disk. Updated
+	 * by notifications from WAL thread, see wal_fsync_f().
+	 */
+	struct vclock synced_vclock;
+	/**
+	 * Set if the WAL is synced periodically, i.e. synced_vclock
+	 * is maintained in wal_mode = 'write'. The tx copy of the
+	 * fsync options, see wal_set_fsync().
+	 */
+	bool is_fsync_periodic;
 	/* ----------------- wal ------------------- */
 	/** A setting from instance configuration - wal_max_size */
 	int64_t wal_max_size;
 	/** Another one - wal_mode */
 	enum wal_mode wal_mode;
+	/** Number of WAL compression threads, wal_compression_threads. */
+	int compression_threads;
+	/**
+	 * Threads compressing WAL blocks ahead of the WAL thread,
+	 * NULL if blocks are compressed by the WAL thread itself.
+	 * Owned by the WAL thread.
+	 */
+	struct xlog_compressor *compressor;
 	/** wal_dir, from the configuration file. */
 	struct xdir wal_dir;
 	/** 'wal' thread doing the writes. */
@@ -141,6 +194,11 @@ struct wal_writer
 	struct vclock checkpoint_vclock;
 	/** Total size of WAL files written since the last checkpoint. */
 	int64_t checkpoint_wal_size;
+	/**
+	 * Compression statistics of WAL files. Updated by xlog in
+	 * WAL thread and read by tx without locks.
+	 */
+	struct xlog_compression_stat compression_stat;
 	/**
 	 * Checkpoint threshold: when the total size of WAL files
 	 * written since the last checkpoint exceeds the value of
@@ -158,6 +216,28 @@ struct wal_writer
 	bool checkpoint_triggered;
 	/** The current WAL file. */
 	struct xlog current_wal;
+	/**
+	 * Periodic fsync policy for wal_mode = 'write': the current
+	 * WAL file is synced in background at least every
+	 * fsync_interval seconds and after every fsync_bytes bytes
+	 * written. 0 disables the respective limit.
+	 */
+	double fsync_interval;
+	int64_t fsync_bytes;
+	/** Bytes written to WAL since the last sync started. */
+	int64_t unsynced_bytes;
+	/** Time when the last sync started. */
+	double last_sync_time;
+	/** WAL thread copy of synced_vclock. */
+	struct vclock wal_synced_vclock;
+	/** Fiber syncing the current WAL file, see wal_fsync_f(). */
+	struct fiber *fsync_fiber;
+	/**
+	 * WAL files closed on rotation and not synced yet, linked
+	 * by wal_closed_file::in_queue. They are synced by the
+	 * fsync fiber before the current one.
+	 */
+	struct stailq closed_files;
 	/**
 	 * Used if there was a WAL I/O error and we need to
 	 * keep adding all incoming requests to the rollback
@@ -176,6 +256,8 @@ struct wal_msg {
 	struct cmsg base;
 	/** Approximate size of this request when encoded. */
 	size_t approx_len;
+	/** Number of journal entries in the batch. */
+	int n_entries;
 	/** Input queue, on output contains all committed requests. */
 	struct stailq commit;
 	/**
@@ -226,6 +308,7 @@ wal_msg_create(struct wal_msg *batch)
 {
 	cmsg_init(&batch->base, wal_request_route);
 	batch->approx_len = 0;
+	batch->n_entries = 0;
 	stailq_create(&batch->commit);
 	stailq_create(&batch->rollback);
 	vclock_create(&batch->vclock);
@@ -349,6 +432,33 @@ tx_complete_rollback(void)
 	cpipe_push(&writer->wal_pipe, &msg);
 }
 
+/**
+ * Send the batch collected while the previous one was being
+ * written to WAL thread.
+ */
+static void
+wal_flush_pending_batch(struct wal_writer *writer)
+{
+	struct wal_msg *batch = writer->pending_batch;
+	if (batch == NULL)
+		return;
+	writer->pending_batch = NULL;
+	ev_timer_stop(loop(), &writer->group_commit_timer);
+	double wait = ev_monotonic_time() - writer->pending_batch_start;
+	histogram_collect(writer->batch_wait_hist, wait * 1e6);
+	writer->n_batches_in_flight++;
+	cpipe_push(&writer->wal_pipe, &batch->base);
+}
+
+static void
+wal_group_commit_timer_cb(struct ev_loop *loop, struct ev_timer *timer,
+			  int events)
+{
+	(void)loop;
+	(void)events;
+	wal_flush_pending_batch((struct wal_writer *)timer->data);
+}
+
 /**
  * Complete execution of a batch of WAL write requests:
  * schedule all committed requests, and, should there
@@ -362,6 +472,14 @@ tx_complete_batch(struct cmsg *msg)
 {
 	struct wal_writer *writer = &wal_writer_singleton;
 	struct wal_msg *batch = (struct wal_msg *) msg;
+	histogram_collect(writer->batch_size_hist, batch->n_entries);
+	/*
+	 * Group commit: the previous write is done, so send the
+	 * entries accumulated meanwhile.
+	 */
+	assert(writer->n_batches_in_flight > 0);
+	if (--writer->n_batches_in_flight == 0)
+		wal_flush_pending_batch(writer);
 	/*
 	 * Move the rollback list to the writer first, since
 	 * wal_msg memory disappears after the first
@@ -373,6 +491,9 @@ tx_complete_batch(struct cmsg *msg)
 	}
 	/* Update the tx vclock to the latest written by wal. */
 	vclock_copy(&replicaset.vclock, &batch->vclock);
+	/* Each write is synced in this mode. */
+	if (writer->wal_mode == WAL_FSYNC)
+		vclock_copy(&writer->synced_vclock, &batch->vclock);
 	tx_schedule_queue(&batch->commit);
 	mempool_free(&writer->msg_pool, container_of(msg, struct wal_msg, base));
 }
@@ -414,12 +535,15 @@ tx_notify_checkpoint(struct cmsg *msg)
 static void
 wal_writer_create(struct wal_writer *writer, enum wal_mode wal_mode,
 		  const char *wal_dirname, int64_t wal_max_size,
+		  int compression_threads,
 		  const struct tt_uuid *instance_uuid,
 		  wal_on_garbage_collection_f on_garbage_collection,
 		  wal_on_checkpoint_threshold_f on_checkpoint_threshold)
 {
 	writer->wal_mode = wal_mode;
 	writer->wal_max_size = wal_max_size;
+	writer->compression_threads = compression_threads;
+	writer->compressor = NULL;
 
 	journal_create(&writer->base,
 		       wal_mode == WAL_NONE ?
@@ -427,8 +551,12 @@ wal_writer_create(struct wal_writer *writer, enum wal_mode wal_mode,
 		       wal_mode == WAL_NONE ?
 		       wal_write_none : wal_write);
 
+	memset(&writer->compression_stat, 0,
+	       sizeof(writer->compression_stat));
 	struct xlog_opts opts = xlog_opts_default;
 	opts.sync_is_async = true;
+	opts.compression_stat = &writer->compression_stat;
+	opts.index_step = WAL_INDEX_STEP;
 	xdir_create(&writer->wal_dir, wal_dirname, XLOG, instance_uuid, &opts);
 	xlog_clear(&writer->current_wal);
 	if (wal_mode == WAL_FSYNC)
@@ -443,19 +571,45 @@ wal_writer_create(struct wal_writer *writer, enum wal_mode wal_mode,
 
 	vclock_create(&writer->vclock);
 	vclock_create(&writer->checkpoint_vclock);
+	vclock_create(&writer->synced_vclock);
+	vclock_create(&writer->wal_synced_vclock);
 	rlist_create(&writer->watchers);
+	writer->is_fsync_periodic = false;
+
+	writer->fsync_interval = 0;
+	writer->fsync_bytes = 0;
+	writer->unsynced_bytes = 0;
+	writer->last_sync_time = 0;
+	writer->fsync_fiber = NULL;
+	stailq_create(&writer->closed_files);
 
 	writer->on_garbage_collection = on_garbage_collection;
 	writer->on_checkpoint_threshold = on_checkpoint_threshold;
 
 	mempool_create(&writer->msg_pool, &cord()->slabc,
 		       sizeof(struct wal_msg));
+
+	/*
+	 * group_commit_max_delay isn't reset here, because it
+	 * may be configured before the writer is created.
+	 */
+	writer->pending_batch = NULL;
+	writer->pending_batch_start = 0;
+	writer->n_batches_in_flight = 0;
+	ev_timer_init(&writer->group_commit_timer,
+		      wal_group_commit_timer_cb, 0, 0);
+	writer->group_commit_timer.data = writer;
 }
 
 /** Destroy a WAL writer structure. */
 static void
 wal_writer_destroy(struct wal_writer *writer)
 {
+	ev_timer_stop(loop(), &writer->group_commit_timer);
+	if (writer->batch_size_hist != NULL)
+		histogram_delete(writer->batch_size_hist);
+	if (writer->batch_wait_hist != NULL)
+		histogram_delete(writer->batch_wait_hist);
 	xdir_destroy(&writer->wal_dir);
 }
 
@@ -534,16 +688,34 @@ wal_open(struct wal_writer *writer)
 
 int
 wal_init(enum wal_mode wal_mode, const char *wal_dirname,
-	 int64_t wal_max_size, const struct tt_uuid *instance_uuid,
+	 int64_t wal_max_size, int compression_threads,
+	 const struct tt_uuid *instance_uuid,
 	 wal_on_garbage_collection_f on_garbage_collection,
 	 wal_on_checkpoint_threshold_f on_checkpoint_threshold)
 {
 	/* Initialize the state. */
 	struct wal_writer *writer = &wal_writer_singleton;
 	wal_writer_create(writer, wal_mode, wal_dirname, wal_max_size,
-			  instance_uuid, on_garbage_collection,
+			  compression_threads, instance_uuid, on_garbage_collection,
 			  on_checkpoint_threshold);
 
+	static const int64_t batch_size_buckets[] = {
+		1, 2, 4, 8, 16, 32, 64, 128, 256, 512, 1024,
+	};
+	static const int64_t batch_wait_buckets[] = {
+		10, 20, 50, 100, 200, 500, 1000, 2000, 5000,
+		10000, 20000, 50000, 100000,
+	};
+	writer->batch_size_hist = histogram_new(batch_size_buckets,
+						lengthof(batch_size_buckets));
+	writer->batch_wait_hist = histogram_new(batch_wait_buckets,
+						lengthof(batch_wait_buckets));
+	if (writer->batch_size_hist == NULL ||
+	    writer->batch_wait_hist == NULL) {
+		diag_set(OutOfMemory, 0, "histogram_new", "wal histograms");
+		return -1;
+	}
+
 	/* Start WAL thread. */
 	if (cord_costart(&writer->cord, "wal", wal_writer_f, NULL) != 0)
 		return -1;
@@ -561,6 +733,8 @@ wal_enable(void)
 
 	/* Initialize the writer vclock from the recovery state. */
 	vclock_copy(&writer->vclock, &replicaset.vclock);
+	vclock_copy(&writer->synced_vclock, &replicaset.vclock);
+	vclock_copy(&writer->wal_synced_vclock, &replicaset.vclock);
 
 	/*
 	 * Scan the WAL directory to build an index of all
@@ -584,6 +758,7 @@ wal_free(void)
 {
 	struct wal_writer *writer = &wal_writer_singleton;
 
+	wal_flush_pending_batch(writer);
 	cbus_stop_loop(&writer->wal_pipe);
 
 	if (cord_join(&writer->cord)) {
@@ -594,6 +769,242 @@ wal_free(void)
 	wal_writer_destroy(writer);
 }
 
+/** Notification of tx about rows synced to disk. */
+struct wal_synced_msg {
+	struct cmsg base;
+	struct vclock vclock;
+};
+
+static void
+tx_notify_synced(struct cmsg *msg)
+{
+	struct wal_writer *writer = &wal_writer_singleton;
+	struct wal_synced_msg *m = (struct wal_synced_msg *)msg;
+	if (vclock_sum(&m->vclock) > vclock_sum(&writer->synced_vclock))
+		vclock_copy(&writer->synced_vclock, &m->vclock);
+	free(m);
+}
+
+/**
+ * Advance the vclock of the rows synced to disk and let tx
+ * know about it. Called in WAL thread.
+ */
+static void
+wal_notify_synced(struct wal_writer *writer, const struct vclock *vclock)
+{
+	if (vclock_sum(vclock) <= vclock_sum(&writer->wal_synced_vclock))
+		return;
+	vclock_copy(&writer->wal_synced_vclock, vclock);
+	/*
+	 * Use malloc() and don't panic on error, tx will be
+	 * notified after the next sync.
+	 */
+	static struct cmsg_hop route[] = {
+		{ tx_notify_synced, NULL },
+	};
+	struct wal_synced_msg *msg = malloc(sizeof(*msg));
+	if (msg == NULL) {
+		say_warn("failed to allocate WAL sync notification message");
+		return;
+	}
+	cmsg_init(&msg->base, route);
+	vclock_copy(&msg->vclock, vclock);
+	cpipe_push(&writer->tx_prio_pipe, &msg->base);
+}
+
+/** Check if the WAL is synced periodically. */
+static inline bool
+wal_fsync_is_periodic(struct wal_writer *writer)
+{
+	return writer->wal_mode == WAL_WRITE &&
+	       (writer->fsync_interval > 0 || writer->fsync_bytes > 0);
+}
+
+/**
+ * Sync the current WAL file in a coio thread. The WAL thread
+ * keeps writing meanwhile.
+ */
+static void
+wal_fsync(struct wal_writer *writer)
+{
+	struct xlog *l = &writer->current_wal;
+	struct vclock vclock;
+	vclock_copy(&vclock, &writer->vclock);
+	writer->last_sync_time = ev_monotonic_now(loop());
+	writer->unsynced_bytes = 0;
+	/* The file may be closed on rotation while it's synced. */
+	int fd = dup(l->fd);
+	if (fd < 0) {
+		say_syserror("%s: dup() failed", l->filename);
+		return;
+	}
+	if (coio_fdatasync(fd) == 0)
+		wal_notify_synced(writer, &vclock);
+	else
+		say_syserror("%s: fdatasync() failed", fio_filename(fd));
+	close(fd);
+}
+
+/** A WAL file closed on rotation, see wal_close_current(). */
+struct wal_closed_file {
+	/** Link in wal_writer::closed_files. */
+	struct stailq_entry in_queue;
+	/** Duplicate of the file descriptor of the file. */
+	int fd;
+	/** Vclock of the last row of the file. */
+	struct vclock vclock;
+};
+
+/** Sync the first of the closed WAL files in a coio thread. */
+static void
+wal_fsync_closed(struct wal_writer *writer)
+{
+	struct wal_closed_file *file =
+		stailq_shift_entry(&writer->closed_files,
+				   struct wal_closed_file, in_queue);
+	if (coio_fdatasync(file->fd) == 0)
+		wal_notify_synced(writer, &file->vclock);
+	else
+		say_syserror("%s: fdatasync() failed", fio_filename(file->fd));
+	close(file->fd);
+	free(file);
+}
+
+/**
+ * Background fsync of the WAL, see wal_writer::fsync_interval.
+ * Gives bounded data loss on a system crash without syncing
+ * each write as wal_mode = 'fsync' does.
+ */
+static int
+wal_fsync_f(va_list ap)
+{
+	(void)ap;
+	struct wal_writer *writer = &wal_writer_singleton;
+	while (!fiber_is_cancelled()) {
+		/*
+		 * Sync the closed files first, so that the synced
+		 * vclock only covers rows which are all on disk.
+		 */
+		if (!stailq_empty(&writer->closed_files)) {
+			wal_fsync_closed(writer);
+			continue;
+		}
+		double now = ev_monotonic_now(loop());
+		if (!wal_fsync_is_periodic(writer) ||
+		    !xlog_is_open(&writer->current_wal) ||
+		    vclock_sum(&writer->wal_synced_vclock) ==
+		    vclock_sum(&writer->vclock)) {
+			/* Nothing to sync. */
+			writer->last_sync_time = now;
+			fiber_sleep(writer->fsync_interval > 0 ?
+				    writer->fsync_interval : TIMEOUT_INFINITY);
+			continue;
+		}
+		double timeout = TIMEOUT_INFINITY;
+		if (writer->fsync_interval > 0) {
+			timeout = writer->last_sync_time +
+				  writer->fsync_interval - now;
+		}
+		if (timeout > 0 && (writer->fsync_bytes == 0 ||
+				    writer->unsynced_bytes <
+				    writer->fsync_bytes)) {
+			fiber_sleep(timeout);
+			continue;
+		}
+		wal_fsync(writer);
+	}
+	return 0;
+}
+
+/**
+ * Queue the current WAL file to be synced by the fsync fiber
+ * in a coio thread, since the background sync only follows
+ * the current file. The file is synced in place if it fails.
+ */
+static void
+wal_queue_closed(struct wal_writer *writer)
+{
+	struct xlog *l = &writer->current_wal;
+	struct wal_closed_file *file =
+		(struct wal_closed_file *)malloc(sizeof(*file));
+	if (file != NULL)
+		file->fd = dup(l->fd);
+	if (file == NULL || file->fd < 0) {
+		free(file);
+		if (fdatasync(l->fd) == 0)
+			wal_notify_synced(writer, &writer->vclock);
+		else
+			say_syserror("%s: fdatasync() failed", l->filename);
+		return;
+	}
+	vclock_copy(&file->vclock, &writer->vclock);
+	stailq_add_tail_entry(&writer->closed_files, file, in_queue);
+	fiber_wakeup(writer->fsync_fiber);
+}
+
+/**
+ * Close the current WAL file. If the WAL is synced periodically,
+ * the rows written after the last sync are synced in background.
+ */
+static void
+wal_close_current(struct wal_writer *writer)
+{
+	struct xlog *l = &writer->current_wal;
+	if (wal_fsync_is_periodic(writer) &&
+	    vclock_sum(&writer->wal_synced_vclock) <
+	    vclock_sum(&writer->vclock)) {
+		wal_queue_closed(writer);
+		writer->unsynced_bytes = 0;
+	}
+	/*
+	 * We can not handle xlog_close() failure in any
+	 * reasonable way. A warning is written to the error log.
+	 */
+	xlog_close(l, false);
+}
+
+struct wal_set_fsync_msg {
+	struct cbus_call_msg base;
+	double interval;
+	int64_t bytes;
+};
+
+static int
+wal_set_fsync_f(struct cbus_call_msg *data)
+{
+	struct wal_writer *writer = &wal_writer_singleton;
+	struct wal_set_fsync_msg *msg = (struct wal_set_fsync_msg *)data;
+	writer->fsync_interval = msg->interval;
+	writer->fsync_bytes = msg->bytes;
+	/* Apply the new limits right away. */
+	fiber_wakeup(writer->fsync_fiber);
+	return 0;
+}
+
+void
+wal_set_fsync(double interval, int64_t bytes)
+{
+	struct wal_writer *writer = &wal_writer_singleton;
+	if (writer->wal_mode == WAL_NONE)
+		return;
+	writer->is_fsync_periodic = interval > 0 || bytes > 0;
+	struct wal_set_fsync_msg msg;
+	msg.interval = interval;
+	msg.bytes = bytes;
+	cbus_call(&writer->wal_pipe, &writer->tx_prio_pipe,
+		  &msg.base, wal_set_fsync_f, NULL, TIMEOUT_INFINITY);
+}
+
+const struct vclock *
+wal_synced_vclock(void)
+{
+	struct wal_writer *writer = &wal_writer_singleton;
+	if (writer->wal_mode == WAL_FSYNC ||
+	    (writer->wal_mode == WAL_WRITE && writer->is_fsync_periodic))
+		return &writer->synced_vclock;
+	return NULL;
+}
+
 struct wal_vclock_msg {
     struct cbus_call_msg base;
     struct vclock vclock;
@@ -632,6 +1043,8 @@ wal_sync(struct vclock *vclock)
 		diag_set(ClientError, ER_CASCADE_ROLLBACK);
 		return -1;
 	}
+	/* The entries waiting for group commit must be synced too. */
+	wal_flush_pending_batch(writer);
 	struct wal_vclock_msg msg;
 	int rc = cbus_call(&writer->wal_pipe, &writer->tx_prio_pipe,
 			   &msg.base, wal_sync_f, NULL, TIMEOUT_INFINITY);
@@ -661,7 +1074,7 @@ wal_begin_checkpoint_f(struct cbus_call_msg *data)
 	    vclock_sum(&writer->current_wal.meta.vclock) !=
 	    vclock_sum(&writer->vclock)) {
 
-		xlog_close(&writer->current_wal, false);
+		wal_close_current(writer);
 		/*
 		 * The next WAL will be created on the first write.
 		 */
@@ -692,6 +1105,7 @@ wal_begin_checkpoint(struct wal_checkpoint *checkpoint)
 		diag_set(ClientError, ER_CASCADE_ROLLBACK);
 		return -1;
 	}
+	wal_flush_pending_batch(writer);
 	int rc = cbus_call(&writer->wal_pipe, &writer->tx_prio_pipe,
 			   &checkpoint->base, wal_begin_checkpoint_f, NULL,
 			   TIMEOUT_INFINITY);
@@ -769,6 +1183,44 @@ wal_set_queue_max_size(int64_t size)
 	journal_queue_set_max_size(size);
 }
 
+void
+wal_set_group_commit_max_delay(double delay)
+{
+	struct wal_writer *writer = &wal_writer_singleton;
+	writer->group_commit_max_delay = delay;
+	if (delay == 0)
+		wal_flush_pending_batch(writer);
+}
+
+void
+wal_stat(struct info_handler *h)
+{
+	struct wal_writer *writer = &wal_writer_singleton;
+	char buf[1024];
+	info_begin(h);
+	if (writer->batch_size_hist == NULL) {
+		/* WAL writer isn't initialized yet. */
+		info_end(h);
+		return;
+	}
+	info_append_int(h, "batch_count", writer->batch_size_hist->total);
+	histogram_snprint(buf, sizeof(buf), writer->batch_size_hist);
+	info_append_str(h, "batch_size_histogram", buf);
+	histogram_snprint(buf, sizeof(buf), writer->batch_wait_hist);
+	info_append_str(h, "batch_wait_histogram", buf);
+
+	struct xlog_compression_stat *stat = &writer->compression_stat;
+	info_table_begin(h, "compression");
+	info_append_int(h, "blocks", stat->blocks);
+	info_append_int(h, "bytes_in", stat->bytes_in);
+	info_append_int(h, "bytes_out", stat->bytes_out);
+	info_append_double(h, "ratio", stat->bytes_out > 0 ?
+			   (double)stat->bytes_in / stat->bytes_out : 0);
+	info_append_double(h, "time", stat->time);
+	info_table_end(h);
+	info_end(h);
+}
+
 struct wal_gc_msg
 {
 	struct cbus_call_msg base;
@@ -840,14 +1292,8 @@ wal_opt_rotate(struct wal_writer *writer)
 	 * one.
 	 */
 	if (xlog_is_open(&writer->current_wal) &&
-	    writer->current_wal.offset >= writer->wal_max_size) {
-		/*
-		 * We can not handle xlog_close()
-		 * failure in any reasonable way.
-		 * A warning is written to the error log.
-		 */
-		xlog_close(&writer->current_wal, false);
-	}
+	    writer->current_wal.offset >= writer->wal_max_size)
+		wal_close_current(writer);
 
 	if (xlog_is_open(&writer->current_wal))
 		return 0;
@@ -1040,6 +1486,9 @@ wal_write_to_disk(struct cmsg *msg)
 	 */
 	struct vclock vclock_diff;
 	vclock_create(&vclock_diff);
+	/* WAL vclock before the batch, for relay feeds. */
+	struct vclock start_vclock;
+	vclock_copy(&start_vclock, &writer->vclock);
 
 	ERROR_INJECT_SLEEP(ERRINJ_WAL_DELAY);
 
@@ -1105,6 +1554,7 @@ wal_write_to_disk(struct cmsg *msg)
 		}
 		if (rc > 0) {
 			writer->checkpoint_wal_size += rc;
+			writer->unsynced_bytes += rc;
 			last_committed = &entry->fifo;
 			vclock_merge(&writer->vclock, &vclock_diff);
 		}
@@ -1117,8 +1567,12 @@ wal_write_to_disk(struct cmsg *msg)
 	}
 
 	writer->checkpoint_wal_size += rc;
+	writer->unsynced_bytes += rc;
 	last_committed = stailq_last(&wal_msg->commit);
 	vclock_merge(&writer->vclock, &vclock_diff);
+	if (writer->fsync_bytes > 0 &&
+	    writer->unsynced_bytes >= writer->fsync_bytes)
+		fiber_wakeup(writer->fsync_fiber);
 
 	/*
 	 * Notify TX if the checkpoint threshold has been exceeded.
@@ -1176,6 +1630,11 @@ done:
 	} else {
 		assert(err_code == JOURNAL_ENTRY_ERR_UNKNOWN);
 	}
+	/*
+	 * Let caught up relays send the written rows without
+	 * reading them back from the file.
+	 */
+	relay_feed_write(&start_vclock, &writer->vclock, &wal_msg->commit);
 	fiber_gc();
 	wal_notify_watchers(writer, WAL_EVENT_WRITE);
 	ERROR_INJECT_SLEEP(ERRINJ_RELAY_FASTER_THAN_TX);
@@ -1200,8 +1659,33 @@ wal_writer_f(va_list ap)
 	 */
 	cpipe_create(&writer->tx_prio_pipe, "tx_prio");
 
+	/*
+	 * The compressor must be created by the WAL thread, which
+	 * receives compressed blocks. WAL files are opened after
+	 * the thread is started, so they all get it in options.
+	 */
+	if (writer->wal_mode != WAL_NONE && writer->compression_threads > 0) {
+		writer->compressor = xlog_compressor_new(
+			"wal.compress", writer->compression_threads);
+		if (writer->compressor == NULL)
+			panic("failed to start WAL compression threads");
+		writer->wal_dir.opts.compressor = writer->compressor;
+	}
+
+	writer->fsync_fiber = fiber_new("wal_fsync", wal_fsync_f);
+	if (writer->fsync_fiber == NULL)
+		panic("failed to create WAL fsync fiber");
+	fiber_set_joinable(writer->fsync_fiber, true);
+	fiber_start(writer->fsync_fiber);
+
 	cbus_loop(&endpoint);
 
+	fiber_cancel(writer->fsync_fiber);
+	fiber_join(writer->fsync_fiber);
+	writer->fsync_fiber = NULL;
+	while (!stailq_empty(&writer->closed_files))
+		wal_fsync_closed(writer);
+
 	/*
 	 * Create a new empty WAL on shutdown so that we don't
 	 * have to rescan the last WAL to find the instance vclock.
@@ -1225,6 +1709,12 @@ wal_writer_f(va_list ap)
 	if (xlog_is_open(&vy_log_writer.xlog))
 		xlog_close(&vy_log_writer.xlog, false);
 
+	if (writer->compressor != NULL) {
+		xlog_compressor_delete(writer->compressor);
+		writer->compressor = NULL;
+		writer->wal_dir.opts.compressor = NULL;
+	}
+
 	cpipe_destroy(&writer->tx_prio_pipe);
 	return 0;
 }
@@ -1259,10 +1749,40 @@ wal_write_async(struct journal *journal, struct journal_entry *entry)
 	}
 
 	struct wal_msg *batch;
-	if (!stailq_empty(&writer->wal_pipe.input) &&
+	if (writer->pending_batch == NULL &&
+	    !stailq_empty(&writer->wal_pipe.input) &&
 	    (batch = wal_msg(stailq_first_entry(&writer->wal_pipe.input,
 						struct cmsg, fifo)))) {
 
+		stailq_add_tail_entry(&batch->commit, entry, fifo);
+	} else if (writer->pending_batch != NULL ||
+		   (writer->group_commit_max_delay > 0 &&
+		    writer->n_batches_in_flight > 0)) {
+		/*
+		 * Group commit: a batch is being written, so hold
+		 * the entry until it's done and then write all such
+		 * entries at once. The delay adapts to the write
+		 * cost and the rate of entries by itself: the slower
+		 * writes or the more entries, the bigger the batch.
+		 * If a write takes too long, the timer sends the
+		 * pending batch anyway.
+		 */
+		batch = writer->pending_batch;
+		if (batch == NULL) {
+			batch = (struct wal_msg *)
+				mempool_alloc(&writer->msg_pool);
+			if (batch == NULL) {
+				diag_set(OutOfMemory, sizeof(struct wal_msg),
+					 "region", "struct wal_msg");
+				goto fail;
+			}
+			wal_msg_create(batch);
+			writer->pending_batch = batch;
+			writer->pending_batch_start = ev_monotonic_time();
+			ev_timer_set(&writer->group_commit_timer,
+				     writer->group_commit_max_delay, 0);
+			ev_timer_start(loop(), &writer->group_commit_timer);
+		}
 		stailq_add_tail_entry(&batch->commit, entry, fifo);
 	} else {
 		batch = (struct wal_msg *)mempool_alloc(&writer->msg_pool);
@@ -1278,6 +1798,7 @@ wal_write_async(struct journal *journal, struct journal_entry *entry)
 		 * thread right away.
 		 */
 		stailq_add_tail_entry(&batch->commit, entry, fifo);
+		writer->n_batches_in_flight++;
 		cpipe_push(&writer->wal_pipe, &batch->base);
 	}
 	/*
@@ -1287,7 +1808,9 @@ wal_write_async(struct journal *journal, struct journal_entry *entry)
 	 */
 	writer->last_entry = entry;
 	batch->approx_len += entry->approx_len;
-	writer->wal_pipe.n_input += entry->n_rows * XROW_IOVMAX;
+	batch->n_entries++;
+	if (batch != writer->pending_batch)
+		writer->wal_pipe.n_input += entry->n_rows * XROW_IOVMAX;
 #ifndef NDEBUG
 	++errinj(ERRINJ_WAL_WRITE_COUNT, ERRINJ_INT)->iparam;
 #endif
@@ -97,11 +97,14 @@ typedef void (*wal_on_garbage_collection_f)(const struct vclock *vclock);
 typedef void (*wal_on_checkpoint_threshold_f)(void);
 
 /**
- * Start WAL thread and initialize WAL writer.
+ * Start WAL thread and initialize WAL writer. If
+ * @a compression_threads is not 0, WAL blocks are compressed
+ * by that many threads ahead of the WAL thread.
  */
 int
 wal_init(enum wal_mode wal_mode, const char *wal_dirname,
-	 int64_t wal_max_size, const struct tt_uuid *instance_uuid,
+	 int64_t wal_max_size, int compression_threads,
+	 const struct tt_uuid *instance_uuid,
 	 wal_on_garbage_collection_f on_garbage_collection,
 	 wal_on_checkpoint_threshold_f on_checkpoint_threshold);
 
@@ -263,6 +266,40 @@ wal_set_checkpoint_threshold(int64_t threshold);
 void
 wal_set_queue_max_size(int64_t size);
 
+/**
+ * Set the maximal time a journal entry may wait for the previous
+ * write to complete so as to be written together with other
+ * entries. 0 disables group commit.
+ */
+void
+wal_set_group_commit_max_delay(double delay);
+
+/**
+ * Set the periodic fsync policy for wal_mode = 'write': sync the
+ * WAL in background at least every @interval seconds and after
+ * every @bytes written. 0 disables the respective limit.
+ */
+void
+wal_set_fsync(double interval, int64_t bytes);
+
+/**
+ * Return the vclock of the rows known to be synced to disk,
+ * i.e. which survive a system crash, or NULL if it isn't
+ * tracked: the WAL is neither synced on each write nor
+ * periodically.
+ */
+const struct vclock *
+wal_synced_vclock(void);
+
+struct info_handler;
+
+/**
+ * Fill WAL writer statistics: histograms of the number of
+ * entries per write and of the group commit delay.
+ */
+void
+wal_stat(struct info_handler *h);
+
 /**
  * Remove WAL files that are not needed by consumers reading
  * rows at @vclock or newer.
@@ -34,6 +34,7 @@
 #include <ctype.h>
 
 #include "fiber.h"
+#include "cbus.h"
 #include "exception.h"
 #include "crc32.h"
 #include "fio.h"
@@ -88,14 +89,24 @@ enum {
 	 * Maybe this should be a configuration option.
 	 */
 	XLOG_TX_COMPRESS_THRESHOLD = 2 * 1024,
+	/** Zstd compression level of xlog blocks. */
+	XLOG_ZSTD_LEVEL = 3,
+	/** Initial size of the buffer for xlog index entries. */
+	XLOG_INDEX_BUF_SIZE = 16 * 1024,
 };
 
+/** Suffix of the index file written next to an xlog. */
+static const char index_suffix[] = ".index";
+
 const struct xlog_opts xlog_opts_default = {
 	.rate_limit = 0,
 	.sync_interval = 0,
 	.free_cache = false,
 	.sync_is_async = false,
 	.no_compression = false,
+	.compression_stat = NULL,
+	.compressor = NULL,
+	.index_step = 0,
 };
 
 /* {{{ struct xlog_meta */
@@ -114,7 +125,14 @@ enum {
 #define VCLOCK_KEY "VClock"
 #define VERSION_KEY "Version"
 #define PREV_VCLOCK_KEY "PrevVClock"
+#define PARTS_KEY "Parts"
 
+/*
+ * Snapshots split into several files. Older versions would read
+ * the main file only and lose the rest of the data, so they must
+ * refuse to open such a snapshot.
+ */
+static const char v14[] = "0.14";
 static const char v13[] = "0.13";
 static const char v12[] = "0.12";
 
@@ -134,6 +152,7 @@ xlog_meta_create(struct xlog_meta *meta, const char *filetype,
 		vclock_copy(&meta->prev_vclock, prev_vclock);
 	else
 		vclock_clear(&meta->prev_vclock);
+	meta->parts = 0;
 }
 
 /**
@@ -157,7 +176,7 @@ xlog_meta_format(const struct xlog_meta *meta, char *buf, int size)
 		"%s\n"
 		VERSION_KEY ": %s\n"
 		INSTANCE_UUID_KEY ": %s\n",
-		meta->filetype, v13, PACKAGE_VERSION,
+		meta->filetype, meta->parts > 0 ? v14 : v13, PACKAGE_VERSION,
 		tt_uuid_str(&meta->instance_uuid));
 	if (vclock_is_set(&meta->vclock)) {
 		SNPRINT(total, snprintf, buf, size, VCLOCK_KEY ": %s\n",
@@ -167,6 +186,10 @@ xlog_meta_format(const struct xlog_meta *meta, char *buf, int size)
 		SNPRINT(total, snprintf, buf, size, PREV_VCLOCK_KEY ": %s\n",
 			vclock_to_string(&meta->prev_vclock));
 	}
+	if (meta->parts > 0) {
+		SNPRINT(total, snprintf, buf, size, PARTS_KEY ": %u\n",
+			(unsigned)meta->parts);
+	}
 	SNPRINT(total, snprintf, buf, size, "\n");
 	assert(total > 0);
 	return total;
@@ -236,7 +259,7 @@ xlog_meta_parse(struct xlog_meta *meta, const char **data,
 	assert(pos <= end);
 
 	/*
-	 * Parse version string, i.e. "0.12" or "0.13"
+	 * Parse version string, i.e. "0.12", "0.13" or "0.14"
 	 */
 	char version[10];
 	eol = (const char *)memchr(pos, '\n', end - pos);
@@ -249,7 +272,8 @@ xlog_meta_parse(struct xlog_meta *meta, const char **data,
 	pos = eol + 1;
 	assert(pos <= end);
 	if (strncmp(version, v12, sizeof(v12)) != 0 &&
-	    strncmp(version, v13, sizeof(v13)) != 0) {
+	    strncmp(version, v13, sizeof(v13)) != 0 &&
+	    strncmp(version, v14, sizeof(v14)) != 0) {
 		diag_set(XlogError,
 			  "unsupported file format version %s",
 			  version);
@@ -308,6 +332,17 @@ xlog_meta_parse(struct xlog_meta *meta, const char **data,
 			 */
 			if (parse_vclock(val, val_end, &meta->prev_vclock) != 0)
 				return -1;
+		} else if (xlog_meta_key_equal(key, key_end, PARTS_KEY)) {
+			/*
+			 * Parts: <number>
+			 */
+			char *parts_end;
+			unsigned long parts = strtoul(val, &parts_end, 10);
+			if (parts_end != val_end || parts > UINT32_MAX) {
+				diag_set(XlogError, "can't parse snapshot parts");
+				return -1;
+			}
+			meta->parts = parts;
 		} else if (xlog_meta_key_equal(key, key_end, VERSION_KEY)) {
 			/* Ignore Version: for now */
 		} else {
@@ -684,11 +719,20 @@ xdir_collect_garbage(struct xdir *dir, int64_t signature, unsigned flags)
 	       vclock_sum(vclock) < signature) {
 		const char *filename =
 			xdir_format_filename(dir, vclock_sum(vclock), NONE);
+		const char *index_filename = dir->type != XLOG ? NULL :
+			tt_sprintf("%s%s", filename, index_suffix);
 		if (flags & XDIR_GC_ASYNC) {
 			eio_unlink(filename, 0, xdir_complete_gc, NULL);
+			if (index_filename != NULL)
+				eio_unlink(index_filename, 0,
+					   xdir_complete_gc, NULL);
 		} else {
 			int rc = unlink(filename);
 			xdir_say_gc(rc, errno, filename);
+			if (index_filename != NULL) {
+				rc = unlink(index_filename);
+				xdir_say_gc(rc, errno, index_filename);
+			}
 		}
 		vclockset_remove(&dir->index, vclock);
 		free(vclock);
@@ -710,6 +754,12 @@ xdir_remove_file_by_vclock(struct xdir *dir, struct vclock *to_remove)
 	xdir_say_gc(rc, errno, filename);
 	if (rc != 0)
 		return -1;
+	if (dir->type == XLOG) {
+		const char *index_filename =
+			tt_sprintf("%s%s", filename, index_suffix);
+		rc = unlink(index_filename);
+		xdir_say_gc(rc, errno, index_filename);
+	}
 	vclockset_remove(&dir->index, find);
 	free(find);
 	return 0;
@@ -753,6 +803,299 @@ xdir_add_vclock(struct xdir *xdir, const struct vclock *vclock)
 
 /* }}} */
 
+/* {{{ xlog compressor */
+
+/** Thread of an xlog compressor. */
+struct xlog_compressor_worker {
+	struct cord cord;
+	/** Pipe from the writer thread to the worker thread. */
+	struct cpipe worker_pipe;
+	/** Pipe from the worker thread to the writer thread. */
+	struct cpipe writer_pipe;
+	/** Compression context, used only by the worker thread. */
+	ZSTD_CCtx *zctx;
+	/** Route of blocks compressed by the worker. */
+	struct cmsg_hop route[2];
+	/** Compressor the worker belongs to. */
+	struct xlog_compressor *compressor;
+};
+
+struct xlog_compressor {
+	/** Name of the endpoint receiving compressed blocks. */
+	char name[FIBER_NAME_MAX];
+	/** Endpoint receiving compressed blocks in the writer thread. */
+	struct cbus_endpoint endpoint;
+	/** Index of the worker to send the next block to. */
+	int next_worker;
+	/** Number of started workers. */
+	int worker_count;
+	struct xlog_compressor_worker workers[0];
+};
+
+/**
+ * A block of rows queued for writing to an xlog, see
+ * xlog_opts::compressor.
+ */
+struct xlog_block {
+	struct cmsg base;
+	/** Link in xlog::blocks. */
+	struct stailq_entry in_xlog;
+	/** Worker compressing the block, NULL if not compressed. */
+	struct xlog_compressor_worker *worker;
+	/** Rows of the block, with room for a fixheader at start. */
+	struct obuf obuf;
+	/** Number of rows in the block. */
+	int64_t rows;
+	/** Vclock of the rows written up to the block end. */
+	struct vclock vclock;
+	/** Compressed block with its fixheader, allocated with malloc. */
+	char *data;
+	/** Size of the compressed block. */
+	size_t size;
+	/** Time spent compressing the block, in seconds. */
+	double time;
+	/** Set when the block is ready to be written. */
+	bool is_done;
+	/** Fiber waiting for the block to be compressed, if any. */
+	struct fiber *waiter;
+	/** Compression error, if any. */
+	struct diag diag;
+};
+
+/**
+ * Encode the fixheader of a block of @a len bytes of rows with
+ * checksum @a crc32c.
+ */
+static void
+xlog_fixheader_encode(char *fixheader, log_magic_t magic, size_t len,
+		      uint32_t crc32c)
+{
+	*(log_magic_t *)fixheader = magic;
+	char *data = fixheader + sizeof(log_magic_t);
+	data = mp_encode_uint(data, len);
+	/* Encode crc32 for previous row */
+	data = mp_encode_uint(data, 0);
+	/* Encode crc32 for current row */
+	data = mp_encode_uint(data, crc32c);
+	/*
+	 * Encode a padding, to ensure the resulting
+	 * fixheader always has the same size.
+	 */
+	ssize_t padding = XLOG_FIXHEADER_SIZE - (data - fixheader);
+	if (padding > 0) {
+		data = mp_encode_strl(data, padding - 1);
+		if (padding > 1) {
+			memset(data, 0, padding - 1);
+			data += padding - 1;
+		}
+	}
+}
+
+/** Compress a block, called in a compressor thread. */
+static void
+xlog_block_compress_f(struct cmsg *base)
+{
+	struct xlog_block *block = (struct xlog_block *)base;
+	ZSTD_CCtx *zctx = block->worker->zctx;
+	struct obuf *obuf = &block->obuf;
+	double start_time = ev_monotonic_time();
+	struct iovec *iov;
+	size_t zmax_size = XLOG_FIXHEADER_SIZE;
+	size_t offset = XLOG_FIXHEADER_SIZE;
+	for (iov = obuf->iov; iov->iov_len; ++iov) {
+		zmax_size += ZSTD_compressBound(iov->iov_len - offset);
+		offset = 0;
+	}
+	char *data = (char *)malloc(zmax_size);
+	if (data == NULL) {
+		diag_set(OutOfMemory, zmax_size, "malloc",
+			 "compression buffer");
+		goto error;
+	}
+	ZSTD_compressBegin(zctx, XLOG_ZSTD_LEVEL);
+	char *pos = data + XLOG_FIXHEADER_SIZE;
+	offset = XLOG_FIXHEADER_SIZE;
+	for (iov = obuf->iov; iov->iov_len; ++iov) {
+		size_t (*fcompress)(ZSTD_CCtx *, void *, size_t,
+				    const void *, size_t);
+		if (iov == obuf->iov + obuf->pos || !(iov + 1)->iov_len)
+			fcompress = ZSTD_compressEnd;
+		else
+			fcompress = ZSTD_compressContinue;
+		size_t zsize = fcompress(zctx, pos, data + zmax_size - pos,
+					 (char *)iov->iov_base + offset,
+					 iov->iov_len - offset);
+		if (ZSTD_isError(zsize)) {
+			diag_set(ClientError, ER_COMPRESSION,
+				 ZSTD_getErrorName(zsize));
+			goto error;
+		}
+		pos += zsize;
+		offset = 0;
+	}
+	size_t len = pos - data - XLOG_FIXHEADER_SIZE;
+	xlog_fixheader_encode(data, zrow_marker, len,
+			      crc32_calc(0, data + XLOG_FIXHEADER_SIZE, len));
+	block->data = data;
+	block->size = pos - data;
+	block->time = ev_monotonic_time() - start_time;
+	return;
+error:
+	free(data);
+	diag_move(diag_get(), &block->diag);
+}
+
+/** Mark a block compressed, called in the writer thread. */
+static void
+xlog_block_complete_f(struct cmsg *base)
+{
+	struct xlog_block *block = (struct xlog_block *)base;
+	block->is_done = true;
+	if (block->waiter != NULL)
+		fiber_wakeup(block->waiter);
+}
+
+/**
+ * Wait until a block is compressed. Cancellation is ignored,
+ * because the compressor thread uses the block memory until it
+ * is done, so the fiber only yields until it's woken up by
+ * xlog_block_complete_f().
+ */
+static void
+xlog_block_wait(struct xlog_block *block)
+{
+	assert(block->waiter == NULL);
+	block->waiter = fiber();
+	while (!block->is_done)
+		fiber_yield();
+	block->waiter = NULL;
+}
+
+/** Compressor thread function. */
+static int
+xlog_compressor_worker_f(va_list ap)
+{
+	struct xlog_compressor_worker *worker =
+		va_arg(ap, struct xlog_compressor_worker *);
+	struct cbus_endpoint endpoint;
+
+	cpipe_create(&worker->writer_pipe, worker->compressor->name);
+	cbus_endpoint_create(&endpoint, cord_name(cord()),
+			     fiber_schedule_cb, fiber());
+	cbus_loop(&endpoint);
+	cbus_endpoint_destroy(&endpoint, cbus_process);
+	cpipe_destroy(&worker->writer_pipe);
+	return 0;
+}
+
+/**
+ * Deliver compressed blocks in the writer thread. Blocks are
+ * delivered without a fiber, because the writer fiber waits for
+ * them in the middle of processing its own messages.
+ */
+static void
+xlog_compressor_cb(struct ev_loop *loop, struct ev_watcher *watcher,
+		   int events)
+{
+	(void)loop;
+	(void)events;
+	struct cbus_endpoint *endpoint = (struct cbus_endpoint *)watcher->data;
+	cbus_process(endpoint);
+}
+
+struct xlog_compressor *
+xlog_compressor_new(const char *name, int thread_count)
+{
+	assert(thread_count > 0 &&
+	       thread_count <= XLOG_COMPRESSOR_THREADS_MAX);
+	size_t size = sizeof(struct xlog_compressor) +
+		      thread_count * sizeof(struct xlog_compressor_worker);
+	struct xlog_compressor *compressor =
+		(struct xlog_compressor *)calloc(1, size);
+	if (compressor == NULL) {
+		diag_set(OutOfMemory, size, "calloc",
+			 "struct xlog_compressor");
+		return NULL;
+	}
+	snprintf(compressor->name, sizeof(compressor->name), "%s", name);
+	if (cbus_endpoint_create(&compressor->endpoint, compressor->name,
+				 xlog_compressor_cb,
+				 &compressor->endpoint) != 0) {
+		free(compressor);
+		return NULL;
+	}
+	for (int i = 0; i < thread_count; i++) {
+		struct xlog_compressor_worker *worker =
+			&compressor->workers[i];
+		worker->compressor = compressor;
+		worker->zctx = ZSTD_createCCtx();
+		if (worker->zctx == NULL) {
+			diag_set(ClientError, ER_COMPRESSION,
+				 "failed to create context");
+			goto fail;
+		}
+		char worker_name[FIBER_NAME_MAX];
+		snprintf(worker_name, sizeof(worker_name), "%s.%d", name, i);
+		if (cord_costart(&worker->cord, worker_name,
+				 xlog_compressor_worker_f, worker) != 0) {
+			ZSTD_freeCCtx(worker->zctx);
+			goto fail;
+		}
+		cpipe_create(&worker->worker_pipe, worker_name);
+		worker->route[0].f = xlog_block_compress_f;
+		worker->route[0].pipe = &worker->writer_pipe;
+		worker->route[1].f = xlog_block_complete_f;
+		worker->route[1].pipe = NULL;
+		compressor->worker_count++;
+	}
+	return compressor;
+fail:
+	xlog_compressor_delete(compressor);
+	return NULL;
+}
+
+void
+xlog_compressor_delete(struct xlog_compressor *compressor)
+{
+	for (int i = 0; i < compressor->worker_count; i++) {
+		struct xlog_compressor_worker *worker =
+			&compressor->workers[i];
+		cbus_stop_loop(&worker->worker_pipe);
+		cpipe_destroy(&worker->worker_pipe);
+		if (cord_cojoin(&worker->cord) != 0)
+			diag_log();
+		ZSTD_freeCCtx(worker->zctx);
+	}
+	cbus_endpoint_destroy(&compressor->endpoint, cbus_process);
+	free(compressor);
+}
+
+static void
+xlog_block_delete(struct xlog_block *block)
+{
+	obuf_destroy(&block->obuf);
+	free(block->data);
+	diag_destroy(&block->diag);
+	free(block);
+}
+
+/**
+ * Drop the blocks of an xlog that haven't been written yet.
+ * Blocks being compressed are waited for, since compressor
+ * threads use their memory.
+ */
+static void
+xlog_discard_blocks(struct xlog *log)
+{
+	while (!stailq_empty(&log->blocks)) {
+		struct xlog_block *block = stailq_shift_entry(
+			&log->blocks, struct xlog_block, in_xlog);
+		xlog_block_wait(block);
+		xlog_block_delete(block);
+	}
+}
+
+/* }}} */
 
 /* {{{ struct xlog */
 
@@ -793,6 +1136,10 @@ xlog_init(struct xlog *xlog, const struct xlog_opts *opts)
 	xlog->is_autocommit = true;
 	obuf_create(&xlog->obuf, &cord()->slabc, XLOG_TX_AUTOCOMMIT_THRESHOLD);
 	obuf_create(&xlog->zbuf, &cord()->slabc, XLOG_TX_AUTOCOMMIT_THRESHOLD);
+	ibuf_create(&xlog->index, &cord()->slabc, XLOG_INDEX_BUF_SIZE);
+	vclock_create(&xlog->rows_vclock);
+	vclock_create(&xlog->tx_vclock);
+	stailq_create(&xlog->blocks);
 	if (!opts->no_compression) {
 		xlog->zctx = ZSTD_createCCtx();
 		if (xlog->zctx == NULL) {
@@ -816,8 +1163,10 @@ xlog_destroy(struct xlog *xlog)
 {
 	assert(xlog->obuf.slabc == &cord()->slabc);
 	assert(xlog->zbuf.slabc == &cord()->slabc);
+	xlog_discard_blocks(xlog);
 	obuf_destroy(&xlog->obuf);
 	obuf_destroy(&xlog->zbuf);
+	ibuf_destroy(&xlog->index);
 	ZSTD_freeCCtx(xlog->zctx);
 	TRASH(xlog);
 	xlog->fd = -1;
@@ -889,6 +1238,7 @@ xlog_create(struct xlog *xlog, const char *name, int flags,
 	}
 
 	xlog->offset = meta_len; /* first log starts after meta */
+	xlog->index_offset = meta_len;
 	return 0;
 err_write:
 	close(xlog->fd);
@@ -913,6 +1263,13 @@ xlog_open(struct xlog *xlog, const char *name, const struct xlog_opts *opts)
 
 	strncpy(xlog->filename, name, sizeof(xlog->filename));
 	xlog->filename[sizeof(xlog->filename) - 1] = '\0';
+	/*
+	 * The rows already written to the file are unknown, so
+	 * it can't be indexed. Remove the index of the previous
+	 * writer, it will be stale after the first write.
+	 */
+	xlog->opts.index_step = 0;
+	unlink(tt_sprintf("%s%s", xlog->filename, index_suffix));
 
 	xlog->fd = open(xlog->filename, O_RDWR);
 	if (xlog->fd < 0) {
@@ -1067,62 +1424,44 @@ xlog_fallocate(struct xlog *log, size_t len)
 }
 
 /**
- * Write a sequence of uncompressed xrow objects.
+ * Write a sequence of uncompressed xrow objects buffered
+ * in @a obuf.
  *
  * @retval -1 error
  * @retval >= 0 the number of bytes written
  */
 static off_t
-xlog_tx_write_plain(struct xlog *log)
+xlog_tx_write_plain(struct xlog *log, struct obuf *obuf)
 {
 	/**
 	 * We created an obuf savepoint at start of xlog_tx,
 	 * now populate it with data.
 	 */
-	char *fixheader = (char *)log->obuf.iov[0].iov_base;
-	*(log_magic_t *)fixheader = row_marker;
-	char *data = fixheader + sizeof(log_magic_t);
-
-	data = mp_encode_uint(data,
-			      obuf_size(&log->obuf) - XLOG_FIXHEADER_SIZE);
-	/* Encode crc32 for previous row */
-	data = mp_encode_uint(data, 0);
-	/* Encode crc32 for current row */
+	char *fixheader = (char *)obuf->iov[0].iov_base;
 	uint32_t crc32c = 0;
 	struct iovec *iov;
 	size_t offset = XLOG_FIXHEADER_SIZE;
-	for (iov = log->obuf.iov; iov->iov_len; ++iov) {
+	for (iov = obuf->iov; iov->iov_len; ++iov) {
 		crc32c = crc32_calc(crc32c,
 				    (char *)iov->iov_base + offset,
 				    iov->iov_len - offset);
 		offset = 0;
 	}
-	data = mp_encode_uint(data, crc32c);
-	/*
-	 * Encode a padding, to ensure the resulting
-	 * fixheader always has the same size.
-	 */
-	ssize_t padding = XLOG_FIXHEADER_SIZE - (data - fixheader);
-	if (padding > 0) {
-		data = mp_encode_strl(data, padding - 1);
-		if (padding > 1) {
-			memset(data, 0, padding - 1);
-			data += padding - 1;
-		}
-	}
+	xlog_fixheader_encode(fixheader, row_marker,
+			      obuf_size(obuf) - XLOG_FIXHEADER_SIZE, crc32c);
 
 	ERROR_INJECT(ERRINJ_WAL_WRITE_DISK, {
 		diag_set(ClientError, ER_INJECTION, "xlog write injection");
 		return -1;
 	});
 
-	ssize_t written = fio_writevn(log->fd, log->obuf.iov, log->obuf.pos + 1);
+	ssize_t written = fio_writevn(log->fd, obuf->iov, obuf->pos + 1);
 	if (written < 0) {
 		diag_set(SystemError, "failed to write to '%s' file",
 			 log->filename);
 		return -1;
 	}
-	return obuf_size(&log->obuf);
+	return obuf_size(obuf);
 }
 
 /**
@@ -1138,8 +1477,9 @@ xlog_tx_write_zstd(struct xlog *log)
 
 	uint32_t crc32c = 0;
 	struct iovec *iov;
-	/* 3 is compression level. */
-	ZSTD_compressBegin(log->zctx, 3);
+	struct xlog_compression_stat *stat = log->opts.compression_stat;
+	double start_time = stat != NULL ? ev_monotonic_time() : 0;
+	ZSTD_compressBegin(log->zctx, XLOG_ZSTD_LEVEL);
 	size_t offset = XLOG_FIXHEADER_SIZE;
 	for (iov = log->obuf.iov; iov->iov_len; ++iov) {
 		/* Estimate max output buffer size. */
@@ -1179,24 +1519,15 @@ xlog_tx_write_zstd(struct xlog *log)
 		offset = 0;
 	}
 
-	*(log_magic_t *)fixheader = zrow_marker;
-	char *data;
-	data = fixheader + sizeof(log_magic_t);
-	data = mp_encode_uint(data,
-			      obuf_size(&log->zbuf) - XLOG_FIXHEADER_SIZE);
-	/* Encode crc32 for previous row */
-	data = mp_encode_uint(data, 0);
-	/* Encode crc32 for current row */
-	data = mp_encode_uint(data, crc32c);
-	/* Encode padding */
-	ssize_t padding;
-	padding = XLOG_FIXHEADER_SIZE - (data - fixheader);
-	if (padding > 0) {
-		data = mp_encode_strl(data, padding - 1);
-		if (padding > 1) {
-			memset(data, 0, padding - 1);
-			data += padding - 1;
-		}
+	xlog_fixheader_encode(fixheader, zrow_marker,
+			      obuf_size(&log->zbuf) - XLOG_FIXHEADER_SIZE,
+			      crc32c);
+
+	if (stat != NULL) {
+		stat->blocks++;
+		stat->bytes_in += obuf_size(&log->obuf) - XLOG_FIXHEADER_SIZE;
+		stat->bytes_out += obuf_size(&log->zbuf) - XLOG_FIXHEADER_SIZE;
+		stat->time += ev_monotonic_time() - start_time;
 	}
 
 	ERROR_INJECT(ERRINJ_WAL_WRITE_DISK, {
@@ -1226,46 +1557,94 @@ error:
 #define SYNC_ROUND_UP(size)	(SYNC_ROUND_DOWN(size + SYNC_MASK))
 
 /**
- * Writes xlog batch to file
+ * Add an entry pointing to the current end of file to the xlog
+ * index. An entry is a MsgPack array of the file offset and the
+ * vclock of the rows written before it. Errors are ignored: the
+ * index is only a hint for readers.
  */
-static ssize_t
-xlog_tx_write(struct xlog *log)
+static void
+xlog_index_append(struct xlog *log)
 {
-	if (obuf_size(&log->obuf) == XLOG_FIXHEADER_SIZE)
-		return 0;
-	ssize_t written;
+	const struct vclock *vclock = &log->rows_vclock;
+	uint32_t vclock_len = vclock_size(vclock);
+	size_t size = mp_sizeof_array(2) + mp_sizeof_uint(log->offset) +
+		      mp_sizeof_map(vclock_len) +
+		      vclock_len * (mp_sizeof_uint(UINT32_MAX) +
+				    mp_sizeof_uint(UINT64_MAX));
+	char *data = ibuf_reserve(&log->index, size);
+	if (data == NULL)
+		return;
+	char *pos = mp_encode_array(data, 2);
+	pos = mp_encode_uint(pos, log->offset);
+	pos = mp_encode_map(pos, vclock_len);
+	struct vclock_iterator it;
+	vclock_iterator_init(&it, vclock);
+	vclock_foreach(&it, replica) {
+		pos = mp_encode_uint(pos, replica.id);
+		pos = mp_encode_uint(pos, replica.lsn);
+	}
+	assert((size_t)(pos - data) <= size);
+	ibuf_alloc(&log->index, pos - data);
+	log->index_size++;
+	log->index_offset = log->offset;
+}
 
-	if (!log->opts.no_compression &&
-	    obuf_size(&log->obuf) >= XLOG_TX_COMPRESS_THRESHOLD) {
-		written = xlog_tx_write_zstd(log);
-	} else {
-		written = xlog_tx_write_plain(log);
+/**
+ * Write the index of a closed xlog to <xlog name>.index. The file
+ * is a MsgPack array of the xlog data size, which is used to check
+ * that the index matches the xlog, and the array of index entries.
+ * The index isn't synced: readers validate it and fall back on
+ * reading the xlog from the beginning.
+ */
+static void
+xlog_index_write(struct xlog *l)
+{
+	char path[PATH_MAX];
+	char new_path[PATH_MAX];
+	snprintf(new_path, sizeof(new_path), "%s%s", l->filename,
+		 index_suffix);
+	snprintf(path, sizeof(path), "%s%s", new_path, inprogress_suffix);
+	char header[16];
+	char *pos = mp_encode_array(header, 2);
+	pos = mp_encode_uint(pos, l->offset);
+	pos = mp_encode_array(pos, l->index_size);
+	assert(pos <= header + sizeof(header));
+	struct iovec iov[2] = {
+		{ header, (size_t)(pos - header) },
+		{ l->index.rpos, ibuf_used(&l->index) },
+	};
+	int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		say_syserror("failed to create '%s'", path);
+		return;
 	}
-	ERROR_INJECT(ERRINJ_WAL_WRITE, {
-		diag_set(ClientError, ER_INJECTION, "xlog write injection");
-		written = -1;
-	});
-
-	obuf_reset(&log->obuf);
-	/*
-	 * Simplify recovery after a temporary write failure:
-	 * truncate the file to the best known good write
-	 * position.
-	 */
-	if (written < 0) {
-		if (lseek(log->fd, log->offset, SEEK_SET) < 0 ||
-		    ftruncate(log->fd, log->offset) != 0)
-			panic_syserror("failed to truncate xlog after write error");
-		log->allocated = 0;
-		return -1;
+	if (fio_writevn(fd, iov, lengthof(iov)) < 0) {
+		say_syserror("failed to write '%s'", path);
+		goto err;
 	}
+	close(fd);
+	if (rename(path, new_path) != 0) {
+		say_syserror("can't rename %s to %s", path, new_path);
+		unlink(path);
+	}
+	return;
+err:
+	close(fd);
+	unlink(path);
+}
+
+/**
+ * Account @a written bytes appended to an xlog file and sync
+ * the file if it's time to.
+ */
+static void
+xlog_advance(struct xlog *log, ssize_t written)
+{
 	if (log->allocated > (size_t)written)
 		log->allocated -= written;
 	else
 		log->allocated = 0;
 	log->offset += written;
-	log->rows += log->tx_rows;
-	log->tx_rows = 0;
 	if ((log->opts.sync_interval && log->offset >=
 	    (off_t)(log->synced_size + log->opts.sync_interval)) ||
 	    (log->opts.rate_limit && log->offset >=
@@ -1304,6 +1683,201 @@ xlog_tx_write(struct xlog *log)
 		}
 		log->synced_size = log->offset;
 	}
+}
+
+/**
+ * Hand the buffered rows over to xlog_opts::compressor. Blocks
+ * too small to compress are queued as is to keep the write order.
+ */
+static int
+xlog_tx_submit(struct xlog *log)
+{
+	struct xlog_compressor *compressor = log->opts.compressor;
+	struct xlog_block *block =
+		(struct xlog_block *)malloc(sizeof(*block));
+	if (block == NULL) {
+		diag_set(OutOfMemory, sizeof(*block), "malloc",
+			 "struct xlog_block");
+		return -1;
+	}
+	/* The block takes over the buffered rows. */
+	block->obuf = log->obuf;
+	obuf_create(&log->obuf, &cord()->slabc, XLOG_TX_AUTOCOMMIT_THRESHOLD);
+	block->rows = log->tx_rows;
+	log->tx_rows = 0;
+	vclock_copy(&block->vclock, &log->tx_vclock);
+	block->worker = NULL;
+	block->data = NULL;
+	block->size = 0;
+	block->time = 0;
+	block->is_done = true;
+	block->waiter = NULL;
+	diag_create(&block->diag);
+	stailq_add_tail_entry(&log->blocks, block, in_xlog);
+	if (log->opts.no_compression ||
+	    obuf_size(&block->obuf) < XLOG_TX_COMPRESS_THRESHOLD)
+		return 0;
+	struct xlog_compressor_worker *worker =
+		&compressor->workers[compressor->next_worker];
+	compressor->next_worker = (compressor->next_worker + 1) %
+				  compressor->worker_count;
+	block->worker = worker;
+	block->is_done = false;
+	cmsg_init(&block->base, worker->route);
+	/* Start compressing at once, the writer goes on meanwhile. */
+	cpipe_push_input(&worker->worker_pipe, &block->base);
+	cpipe_deliver_now(&worker->worker_pipe);
+	return 0;
+}
+
+/**
+ * Write the blocks handed to xlog_opts::compressor in order,
+ * waiting for the blocks being compressed. While a block is
+ * written, the blocks following it are compressed.
+ *
+ * On error, all blocks are dropped and the file is truncated
+ * to where it was, because the caller doesn't know about the
+ * blocks written by this call yet.
+ *
+ * @retval -1 error
+ * @retval >= 0 the number of bytes written
+ */
+static ssize_t
+xlog_write_blocks(struct xlog *log)
+{
+	struct xlog_compression_stat *stat = log->opts.compression_stat;
+	off_t offset = log->offset;
+	int64_t rows = log->rows;
+	size_t index_used = ibuf_used(&log->index);
+	uint32_t index_size = log->index_size;
+	off_t index_offset = log->index_offset;
+	struct vclock vclock;
+	vclock_copy(&vclock, &log->rows_vclock);
+	ssize_t total = 0;
+	while (!stailq_empty(&log->blocks)) {
+		struct xlog_block *block = stailq_first_entry(
+			&log->blocks, struct xlog_block, in_xlog);
+		xlog_block_wait(block);
+		if (!diag_is_empty(&block->diag)) {
+			diag_move(&block->diag, diag_get());
+			goto error;
+		}
+		if (log->opts.index_step > 0 &&
+		    log->offset - log->index_offset >=
+		    (off_t)log->opts.index_step)
+			xlog_index_append(log);
+		ssize_t written;
+		if (block->data != NULL) {
+			written = block->size;
+			ERROR_INJECT(ERRINJ_WAL_WRITE_DISK, {
+				diag_set(ClientError, ER_INJECTION,
+					 "xlog write injection");
+				goto error;
+			});
+			if (fio_writen(log->fd, block->data,
+				       block->size) < 0) {
+				diag_set(SystemError, "failed to write to "
+					 "'%s' file", log->filename);
+				goto error;
+			}
+			if (stat != NULL) {
+				stat->blocks++;
+				stat->bytes_in += obuf_size(&block->obuf) -
+						  XLOG_FIXHEADER_SIZE;
+				stat->bytes_out += block->size -
+						   XLOG_FIXHEADER_SIZE;
+				stat->time += block->time;
+			}
+		} else {
+			written = xlog_tx_write_plain(log, &block->obuf);
+			if (written < 0)
+				goto error;
+		}
+		ERROR_INJECT(ERRINJ_WAL_WRITE, {
+			diag_set(ClientError, ER_INJECTION,
+				 "xlog write injection");
+			goto error;
+		});
+		stailq_shift(&log->blocks);
+		vclock_copy(&log->rows_vclock, &block->vclock);
+		log->rows += block->rows;
+		xlog_advance(log, written);
+		total += written;
+		xlog_block_delete(block);
+	}
+	return total;
+error:
+	xlog_discard_blocks(log);
+	if (lseek(log->fd, offset, SEEK_SET) < 0 ||
+	    ftruncate(log->fd, offset) != 0)
+		panic_syserror("failed to truncate xlog after write error");
+	log->offset = offset;
+	log->allocated = 0;
+	log->synced_size = MIN(log->synced_size, (uint64_t)offset);
+	log->rows = rows;
+	vclock_copy(&log->rows_vclock, &vclock);
+	vclock_copy(&log->tx_vclock, &vclock);
+	log->index.wpos = log->index.rpos + index_used;
+	log->index_size = index_size;
+	log->index_offset = index_offset;
+	return -1;
+}
+
+/**
+ * Writes xlog batch to file
+ */
+static ssize_t
+xlog_tx_write(struct xlog *log)
+{
+	if (obuf_size(&log->obuf) == XLOG_FIXHEADER_SIZE)
+		return 0;
+	ssize_t written;
+
+	if (log->opts.compressor != NULL) {
+		/* Written in xlog_flush(), see xlog_write_blocks(). */
+		if (xlog_tx_submit(log) != 0) {
+			obuf_reset(&log->obuf);
+			log->tx_rows = 0;
+			xlog_discard_blocks(log);
+			vclock_copy(&log->tx_vclock, &log->rows_vclock);
+			return -1;
+		}
+		return 0;
+	}
+
+	if (log->opts.index_step > 0 &&
+	    log->offset - log->index_offset >= (off_t)log->opts.index_step)
+		xlog_index_append(log);
+
+	if (!log->opts.no_compression &&
+	    obuf_size(&log->obuf) >= XLOG_TX_COMPRESS_THRESHOLD) {
+		written = xlog_tx_write_zstd(log);
+	} else {
+		written = xlog_tx_write_plain(log, &log->obuf);
+	}
+	ERROR_INJECT(ERRINJ_WAL_WRITE, {
+		diag_set(ClientError, ER_INJECTION, "xlog write injection");
+		written = -1;
+	});
+
+	obuf_reset(&log->obuf);
+	/*
+	 * Simplify recovery after a temporary write failure:
+	 * truncate the file to the best known good write
+	 * position.
+	 */
+	if (written < 0) {
+		if (lseek(log->fd, log->offset, SEEK_SET) < 0 ||
+		    ftruncate(log->fd, log->offset) != 0)
+			panic_syserror("failed to truncate xlog after write error");
+		log->allocated = 0;
+		vclock_copy(&log->tx_vclock, &log->rows_vclock);
+		return -1;
+	}
+	vclock_copy(&log->rows_vclock, &log->tx_vclock);
+	log->rows += log->tx_rows;
+	log->tx_rows = 0;
+	xlog_advance(log, written);
 	return written;
 }
 
@@ -1359,6 +1933,9 @@ xlog_write_row(struct xlog *log, const struct xrow_header *packet)
 	}
 	assert(iovcnt <= XROW_IOVMAX);
 	log->tx_rows++;
+	if (log->opts.index_step > 0 &&
+	    packet->lsn > vclock_get(&log->tx_vclock, packet->replica_id))
+		vclock_reset(&log->tx_vclock, packet->replica_id, packet->lsn);
 
 	size_t row_size = obuf_size(&log->obuf) - page_offset;
 	if (log->is_autocommit &&
@@ -1407,6 +1984,8 @@ xlog_tx_rollback(struct xlog *log)
 	log->is_autocommit = true;
 	log->tx_rows = 0;
 	obuf_reset(&log->obuf);
+	xlog_discard_blocks(log);
+	vclock_copy(&log->tx_vclock, &log->rows_vclock);
 }
 
 /**
@@ -1417,6 +1996,11 @@ ssize_t
 xlog_flush(struct xlog *log)
 {
 	assert(log->is_autocommit);
+	if (log->opts.compressor != NULL) {
+		if (log->obuf.used > 0 && xlog_tx_write(log) < 0)
+			return -1;
+		return xlog_write_blocks(log);
+	}
 	if (log->obuf.used == 0)
 		return 0;
 	return xlog_tx_write(log);
@@ -1494,6 +2078,9 @@ xlog_close(struct xlog *l, bool reuse_fd)
 	 */
 	xlog_sync(l);
 
+	if (rc == 0 && l->index_size > 0 && !l->is_inprogress)
+		xlog_index_write(l);
+
 	if (!reuse_fd) {
 		rc = close(l->fd);
 		if (rc < 0)
@@ -1941,6 +2528,16 @@ xlog_cursor_next_row(struct xlog_cursor *cursor, struct xrow_header *xrow)
 	return rc;
 }
 
+void
+xlog_cursor_skip_tx(struct xlog_cursor *cursor)
+{
+	assert(xlog_cursor_is_open(cursor));
+	if (cursor->state != XLOG_CURSOR_TX)
+		return;
+	cursor->state = XLOG_CURSOR_ACTIVE;
+	xlog_tx_cursor_destroy(&cursor->tx_cursor);
+}
+
 int
 xlog_cursor_next(struct xlog_cursor *cursor,
 		 struct xrow_header *xrow, bool force_recovery)
@@ -2071,6 +2668,132 @@ error:
 	return -1;
 }
 
+/**
+ * Check if an index entry vclock is covered by the given one.
+ * Advances @data past the vclock.
+ */
+static bool
+xlog_index_vclock_le(const char **data, const struct vclock *vclock,
+		     bool ignore0)
+{
+	bool is_le = true;
+	uint32_t size = mp_decode_map(data);
+	for (uint32_t i = 0; i < size; i++) {
+		if (mp_typeof(**data) != MP_UINT) {
+			mp_next(data);
+			mp_next(data);
+			is_le = false;
+			continue;
+		}
+		uint64_t id = mp_decode_uint(data);
+		if (mp_typeof(**data) != MP_UINT || id >= VCLOCK_MAX) {
+			mp_next(data);
+			is_le = false;
+			continue;
+		}
+		uint64_t lsn = mp_decode_uint(data);
+		if (id == 0 && ignore0)
+			continue;
+		if (lsn > (uint64_t)vclock_get(vclock, id))
+			is_le = false;
+	}
+	return is_le;
+}
+
+/**
+ * Look up the offset to start reading an xlog from in its index.
+ * Returns 0 if there's no suitable entry or the index is invalid.
+ */
+static off_t
+xlog_index_lookup(struct xlog_cursor *i, const struct vclock *vclock,
+		  bool ignore0)
+{
+	const char *path = tt_sprintf("%s%s", i->name, index_suffix);
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return 0;
+	off_t result = 0;
+	char *buf = NULL;
+	struct stat index_st, xlog_st;
+	if (fstat(fd, &index_st) != 0 || fstat(i->fd, &xlog_st) != 0)
+		goto out;
+	size_t size = index_st.st_size;
+	buf = (char *)malloc(size);
+	if (buf == NULL)
+		goto out;
+	if (fio_pread(fd, buf, size, 0) != (ssize_t)size)
+		goto out;
+	const char *data = buf;
+	if (mp_check(&data, buf + size) != 0 || data != buf + size)
+		goto invalid;
+	data = buf;
+	/*
+	 * The index is written only for files closed with an EOF
+	 * marker, check that the file hasn't changed since then.
+	 */
+	if (mp_typeof(*data) != MP_ARRAY || mp_decode_array(&data) != 2 ||
+	    mp_typeof(*data) != MP_UINT ||
+	    mp_decode_uint(&data) + sizeof(log_magic_t) !=
+	    (uint64_t)xlog_st.st_size || mp_typeof(*data) != MP_ARRAY)
+		goto invalid;
+	off_t min_offset = xlog_cursor_pos(i);
+	uint32_t count = mp_decode_array(&data);
+	for (uint32_t k = 0; k < count; k++) {
+		if (mp_typeof(*data) != MP_ARRAY ||
+		    mp_decode_array(&data) != 2 ||
+		    mp_typeof(*data) != MP_UINT)
+			goto invalid;
+		uint64_t offset = mp_decode_uint(&data);
+		if (mp_typeof(*data) != MP_MAP ||
+		    offset < (uint64_t)min_offset ||
+		    offset >= (uint64_t)xlog_st.st_size)
+			goto invalid;
+		/*
+		 * Entries follow in the file order, so their
+		 * vclocks don't decrease.
+		 */
+		if (!xlog_index_vclock_le(&data, vclock, ignore0))
+			break;
+		result = offset;
+		min_offset = offset;
+	}
+	goto out;
+invalid:
+	say_warn("invalid xlog index '%s', ignored", path);
+	result = 0;
+out:
+	free(buf);
+	close(fd);
+	return result;
+}
+
+off_t
+xlog_cursor_skip(struct xlog_cursor *i, const struct vclock *vclock,
+		 bool ignore0)
+{
+	assert(i->state == XLOG_CURSOR_ACTIVE);
+	if (i->fd < 0)
+		return 0;
+	off_t offset = xlog_index_lookup(i, vclock, ignore0);
+	if (offset == 0)
+		return 0;
+	off_t pos = xlog_cursor_pos(i);
+	ibuf_reset(&i->rbuf);
+	i->read_offset = offset;
+	/*
+	 * Check that the index points to the beginning of
+	 * a transaction. The transaction is read anyway.
+	 */
+	if (xlog_cursor_next_tx(i) == 0)
+		return offset - pos;
+	say_warn("invalid xlog index '%s%s', ignored", i->name, index_suffix);
+	diag_clear(diag_get());
+	ibuf_reset(&i->rbuf);
+	i->read_offset = pos;
+	i->state = XLOG_CURSOR_ACTIVE;
+	return 0;
+}
+
 void
 xlog_cursor_close(struct xlog_cursor *i, bool reuse_fd)
 {
@@ -35,6 +35,7 @@
 #include <sys/stat.h>
 #include "tt_uuid.h"
 #include "vclock/vclock.h"
+#include "salad/stailq.h"
 
 #define ZSTD_STATIC_LINKING_ONLY
 #include "zstd.h"
@@ -44,11 +45,24 @@
 
 struct iovec;
 struct xrow_header;
+struct xlog_compressor;
 
 #if defined(__cplusplus)
 extern "C" {
 #endif /* defined(__cplusplus) */
 
+/** Statistics of compressed xlog writes. */
+struct xlog_compression_stat {
+	/** Number of compressed blocks. */
+	int64_t blocks;
+	/** Size of the blocks before compression. */
+	int64_t bytes_in;
+	/** Size of the blocks after compression. */
+	int64_t bytes_out;
+	/** Time spent compressing, in seconds. */
+	double time;
+};
+
 /**
  * This structure combines all xlog write options set on xlog
  * creation.
@@ -82,10 +96,60 @@ struct xlog_opts {
 	 * to be read frequently, e.g. L1 run files in Vinyl.
 	 */
 	bool no_compression;
+	/**
+	 * If not NULL, statistics of compressed writes are
+	 * accumulated here. May be shared by several xlogs.
+	 */
+	struct xlog_compression_stat *compression_stat;
+	/**
+	 * If not NULL, blocks are compressed by the compressor
+	 * threads instead of the thread writing the xlog, which
+	 * only writes them out in order in xlog_flush(). The
+	 * compressor must have been created by the writer thread.
+	 *
+	 * This option is useful for WAL files, so that compression
+	 * of a block is done while the previous one is written.
+	 */
+	struct xlog_compressor *compressor;
+	/**
+	 * If not 0, a sparse index mapping vclock to file offset,
+	 * with an entry every index_step bytes, is written next
+	 * to the file when it's closed, see xlog_cursor_skip().
+	 *
+	 * This option is useful for WAL files, which relays start
+	 * reading from the middle.
+	 */
+	uint64_t index_step;
 };
 
 extern const struct xlog_opts xlog_opts_default;
 
+/* {{{ xlog compressor */
+
+enum {
+	/** Max number of threads of an xlog compressor. */
+	XLOG_COMPRESSOR_THREADS_MAX = 32,
+};
+
+/**
+ * Create a pool of @a thread_count threads compressing xlog
+ * blocks for the calling thread, see xlog_opts::compressor.
+ * Blocks are sent back to the calling thread via a cbus
+ * endpoint named @a name, the threads are named after it.
+ */
+struct xlog_compressor *
+xlog_compressor_new(const char *name, int thread_count);
+
+/**
+ * Stop the compressor threads. Must be called by the thread
+ * that created the compressor after all xlogs using it have
+ * been closed.
+ */
+void
+xlog_compressor_delete(struct xlog_compressor *compressor);
+
+/* }}} */
+
 /* {{{ log dir */
 
 /**
@@ -319,6 +383,14 @@ struct xlog_meta {
 	 * directory for missing WALs.
 	 */
 	struct vclock prev_vclock;
+	/**
+	 * Text file header: number of additional files a
+	 * snapshot is split into. The files are named
+	 * <snapshot file name>.<1..parts>. 0 if the snapshot
+	 * is a single file. A snapshot with parts is written with
+	 * format version 0.14, so that older versions refuse it.
+	 */
+	uint32_t parts;
 };
 
 /**
@@ -401,6 +473,24 @@ struct xlog {
 	uint64_t synced_size;
 	/** Time when xlog wast synced last time */
 	double sync_time;
+	/**
+	 * Vector clock of the rows written to the file. Maintained
+	 * only if xlog_opts::index_step is set.
+	 */
+	struct vclock rows_vclock;
+	/** Same as rows_vclock, but includes the buffered rows. */
+	struct vclock tx_vclock;
+	/** Encoded index entries, see xlog_opts::index_step. */
+	struct ibuf index;
+	/** Number of entries in the index. */
+	uint32_t index_size;
+	/** Offset of the last index entry. */
+	off_t index_offset;
+	/**
+	 * Blocks handed to xlog_opts::compressor and not written
+	 * yet, linked by xlog_block::in_xlog in the write order.
+	 */
+	struct stailq blocks;
 };
 
 /**
@@ -533,7 +623,13 @@ void
 xlog_tx_rollback(struct xlog *log);
 
 /**
- * Flush buffered rows and sync file
+ * Flush buffered rows and sync file. If the rows are compressed
+ * by xlog_opts::compressor, wait for all blocks to be compressed
+ * and written.
+ *
+ * @retval count of bytes written since xlog_flush() or
+ *         xlog_tx_commit() returned a positive count last time
+ * @retval -1 if error, nothing has been written since then
  */
 ssize_t
 xlog_flush(struct xlog *log);
@@ -760,6 +856,14 @@ xlog_cursor_next_tx(struct xlog_cursor *cursor);
 int
 xlog_cursor_next_row(struct xlog_cursor *cursor, struct xrow_header *xrow);
 
+/**
+ * Skip the rest of the current xlog tx, so that the next call
+ * of xlog_cursor_next_tx() opens the following one. Does
+ * nothing if there's no current tx.
+ */
+void
+xlog_cursor_skip_tx(struct xlog_cursor *cursor);
+
 /**
  * Fetch next row from cursor, ignores xlog tx boundary,
  * open a next one tx if current is done.
@@ -782,6 +886,23 @@ xlog_cursor_next(struct xlog_cursor *cursor,
 int
 xlog_cursor_find_tx_magic(struct xlog_cursor *i);
 
+/**
+ * Skip the rows of a file that precede @vclock without reading
+ * them, using the index written next to the file on close (see
+ * xlog_opts::index_step). The cursor is moved to the last indexed
+ * transaction before which all rows are covered by @vclock. Rows
+ * signed with zero replica id aren't taken into account if
+ * @ignore0 is set.
+ *
+ * Must be called right after the cursor is opened. If the file
+ * has no valid index, the cursor is left as is.
+ *
+ * @retval the number of bytes skipped
+ */
+off_t
+xlog_cursor_skip(struct xlog_cursor *cursor, const struct vclock *vclock,
+		 bool ignore0);
+
 /**
  * Cursor xlog position
  *
@@ -34,6 +34,7 @@
 #include <small/region.h>
 #include <small/obuf.h>
 #include <base64.h>
+#include <zstd.h>
 
 #include "fiber.h"
 #include "iostream.h"
@@ -194,6 +195,9 @@ xrow_header_decode(struct xrow_header *header, const char **pos,
 		case IPROTO_STREAM_ID:
 			header->stream_id = mp_decode_uint(pos);
 			break;
+		case IPROTO_COMPRESSION:
+			header->compression = mp_decode_uint(pos);
+			break;
 		default:
 			/* unknown header */
 			mp_next(pos);
@@ -609,6 +613,31 @@ iproto_reply_error(struct obuf *out, const struct error *e, uint64_t sync,
 	return is_error ? -1 : 0;
 }
 
+int
+xrow_encode_error(struct xrow_header *row, const struct error *e)
+{
+	memset(row, 0, sizeof(*row));
+	bool is_error = false;
+	struct mpstream stream;
+	struct region *region = &fiber()->gc;
+	mpstream_init(&stream, region, region_reserve_cb, region_alloc_cb,
+		      mpstream_error_handler, &is_error);
+	size_t region_svp = region_used(region);
+	mpstream_iproto_encode_error(&stream, e);
+	mpstream_flush(&stream);
+	size_t size = region_used(region) - region_svp;
+	char *body = is_error ? NULL : (char *)region_join(region, size);
+	if (body == NULL) {
+		diag_set(OutOfMemory, size, "region", "error body");
+		return -1;
+	}
+	row->type = iproto_encode_error(box_error_code(e));
+	row->body[0].iov_base = body;
+	row->body[0].iov_len = size;
+	row->bodycnt = 1;
+	return 0;
+}
+
 void
 iproto_do_write_error(struct iostream *io, const struct error *e,
 		      uint32_t schema_version, uint64_t sync)
@@ -664,12 +693,13 @@ iproto_prepare_header(struct obuf *buf, struct obuf_svp *svp, size_t size)
 	return 0;
 }
 
-void
-iproto_reply_select(struct obuf *buf, struct obuf_svp *svp, uint64_t sync,
-		    uint32_t schema_version, uint32_t count)
+static void
+iproto_reply_select_impl(struct obuf *buf, struct obuf_svp *svp,
+			 uint32_t type, uint64_t sync,
+			 uint32_t schema_version, uint32_t count)
 {
 	char *pos = (char *) obuf_svp_to_ptr(buf, svp);
-	iproto_header_encode(pos, IPROTO_OK, sync, schema_version,
+	iproto_header_encode(pos, type, sync, schema_version,
 			        obuf_size(buf) - svp->used -
 				IPROTO_HEADER_LEN);
 
@@ -679,6 +709,71 @@ iproto_reply_select(struct obuf *buf, struct obuf_svp *svp, uint64_t sync,
 	memcpy(pos + IPROTO_HEADER_LEN, &body, sizeof(body));
 }
 
+void
+iproto_reply_select(struct obuf *buf, struct obuf_svp *svp, uint64_t sync,
+		    uint32_t schema_version, uint32_t count)
+{
+	iproto_reply_select_impl(buf, svp, IPROTO_OK, sync, schema_version,
+				 count);
+}
+
+void
+iproto_reply_select_chunk(struct obuf *buf, struct obuf_svp *svp,
+			  uint64_t sync, uint32_t schema_version,
+			  uint32_t count)
+{
+	iproto_reply_select_impl(buf, svp, IPROTO_CHUNK, sync, schema_version,
+				 count);
+}
+
+int
+iproto_reply_select_with_position(struct obuf *buf, struct obuf_svp *svp,
+				  uint64_t sync, uint32_t schema_version,
+				  uint32_t count, const char *packed_pos,
+				  const char *packed_pos_end)
+{
+	uint32_t pos_len = packed_pos_end - packed_pos;
+	size_t size = mp_sizeof_uint(IPROTO_POSITION) + mp_sizeof_str(pos_len);
+	char *ptr = obuf_alloc(buf, size);
+	if (ptr == NULL) {
+		diag_set(OutOfMemory, size, "obuf_alloc", "ptr");
+		return -1;
+	}
+	ptr = mp_encode_uint(ptr, IPROTO_POSITION);
+	mp_encode_str(ptr, packed_pos, pos_len);
+	iproto_reply_select(buf, svp, sync, schema_version, count);
+	/* The body map has two keys: IPROTO_DATA and IPROTO_POSITION. */
+	char *body = (char *)obuf_svp_to_ptr(buf, svp) + IPROTO_HEADER_LEN;
+	*body = 0x82;
+	return 0;
+}
+
+int
+iproto_reply_batch_with_error(struct obuf *buf, struct obuf_svp *svp,
+			      uint64_t sync, uint32_t schema_version,
+			      uint32_t count, const struct error *e)
+{
+	bool is_error = false;
+	struct mpstream stream;
+	mpstream_init(&stream, buf, obuf_reserve_cb, obuf_alloc_cb,
+		      mpstream_error_handler, &is_error);
+	mpstream_encode_uint(&stream, IPROTO_ERROR_24);
+	mpstream_encode_str(&stream, e->errmsg);
+	mpstream_encode_uint(&stream, IPROTO_ERROR);
+	error_to_mpstream_noext(e, &stream);
+	mpstream_flush(&stream);
+	if (is_error)
+		return -1;
+	iproto_reply_select(buf, svp, sync, schema_version, count);
+	/*
+	 * The body map has three keys: IPROTO_DATA, IPROTO_ERROR_24
+	 * and IPROTO_ERROR.
+	 */
+	char *body = (char *)obuf_svp_to_ptr(buf, svp) + IPROTO_HEADER_LEN;
+	*body = 0x83;
+	return 0;
+}
+
 int
 xrow_decode_sql(const struct xrow_header *row, struct sql_request *request)
 {
@@ -874,6 +969,19 @@ error:
 			request->new_tuple = value;
 			request->new_tuple_end = data;
 			break;
+		case IPROTO_AFTER_POSITION: {
+			uint32_t len;
+			request->after_position = mp_decode_str(&value, &len);
+			request->after_position_end =
+				request->after_position + len;
+			break;
+		}
+		case IPROTO_FETCH_POSITION:
+			request->fetch_position = mp_decode_bool(&value);
+			break;
+		case IPROTO_CHUNK_SIZE:
+			request->chunk_size = mp_decode_uint(&value);
+			break;
 		default:
 			break;
 		}
@@ -888,6 +996,82 @@ done:
 	return 0;
 }
 
+int
+xrow_decode_space_id(struct xrow_header *row, uint32_t *space_id)
+{
+	*space_id = 0;
+	if (row->bodycnt == 0)
+		return 0;
+	assert(row->bodycnt == 1);
+	const char *data = (const char *) row->body[0].iov_base;
+	if (mp_typeof(*data) != MP_MAP) {
+error:
+		xrow_on_decode_err(row, ER_INVALID_MSGPACK, "packet body");
+		return -1;
+	}
+	uint32_t size = mp_decode_map(&data);
+	for (uint32_t i = 0; i < size; i++) {
+		if (mp_typeof(*data) != MP_UINT) {
+			mp_next(&data);
+			mp_next(&data);
+			continue;
+		}
+		if (mp_decode_uint(&data) != IPROTO_SPACE_ID) {
+			mp_next(&data);
+			continue;
+		}
+		if (mp_typeof(*data) != MP_UINT)
+			goto error;
+		*space_id = mp_decode_uint(&data);
+		return 0;
+	}
+	return 0;
+}
+
+int
+xrow_decompress(struct xrow_header *row, struct ZSTD_DCtx_s *zctx,
+		void *(*alloc)(void *ctx, size_t size), void *alloc_ctx)
+{
+	if (row->compression != IPROTO_COMPRESSION_ZSTD) {
+		diag_set(ClientError, ER_DECOMPRESSION,
+			 tt_sprintf("unknown compression %u",
+				    (unsigned)row->compression));
+		return -1;
+	}
+	if (row->bodycnt == 0 ||
+	    mp_typeof(*(const char *)row->body[0].iov_base) != MP_BIN) {
+		diag_set(ClientError, ER_INVALID_MSGPACK, "compressed body");
+		return -1;
+	}
+	const char *data = (const char *)row->body[0].iov_base;
+	uint32_t len = mp_decode_binl(&data);
+	unsigned long long size = ZSTD_getFrameContentSize(data, len);
+	if (size == ZSTD_CONTENTSIZE_UNKNOWN ||
+	    size == ZSTD_CONTENTSIZE_ERROR || size == 0 ||
+	    size > UINT32_MAX) {
+		diag_set(ClientError, ER_DECOMPRESSION,
+			 "invalid frame content size");
+		return -1;
+	}
+	char *body = (char *)alloc(alloc_ctx, size);
+	if (body == NULL)
+		return -1;
+	size_t rc = ZSTD_decompressDCtx(zctx, body, size, data, len);
+	if (ZSTD_isError(rc)) {
+		diag_set(ClientError, ER_DECOMPRESSION, ZSTD_getErrorName(rc));
+		return -1;
+	}
+	const char *pos = body;
+	if (rc != size || mp_check(&pos, body + size) != 0 ||
+	    pos != body + size) {
+		diag_set(ClientError, ER_INVALID_MSGPACK, "packet body");
+		return -1;
+	}
+	row->body[0].iov_base = body;
+	row->body[0].iov_len = size;
+	return 0;
+}
+
 static int
 request_snprint(char *buf, int size, const struct request *request)
 {
@@ -1610,6 +1794,133 @@ bad_msgpack:
 	return -1;
 }
 
+/**
+ * Decode one request of a BATCH given by its body map.
+ */
+static int
+xrow_decode_batch_item(const struct xrow_header *row, const char *data,
+		       const char *data_end, struct request *request)
+{
+	if (mp_typeof(*data) != MP_MAP)
+		goto bad_msgpack;
+	/* Look up the request type in the request body. */
+	uint64_t type = IPROTO_OK;
+	const char *d = data;
+	uint32_t map_size = mp_decode_map(&d);
+	for (uint32_t i = 0; i < map_size; i++) {
+		if (mp_typeof(*d) != MP_UINT)
+			goto bad_msgpack;
+		uint64_t key = mp_decode_uint(&d);
+		if (key == IPROTO_REQUEST_TYPE) {
+			if (mp_typeof(*d) != MP_UINT)
+				goto bad_msgpack;
+			type = mp_decode_uint(&d);
+			break;
+		}
+		mp_next(&d);
+	}
+	if (type != IPROTO_SELECT && type != IPROTO_UPSERT &&
+	    (type < IPROTO_INSERT || type > IPROTO_DELETE)) {
+		diag_set(ClientError, ER_UNKNOWN_REQUEST_TYPE, (uint32_t)type);
+		return -1;
+	}
+	struct xrow_header item;
+	memset(&item, 0, sizeof(item));
+	item.type = type;
+	item.bodycnt = 1;
+	item.body[0].iov_base = (void *)data;
+	item.body[0].iov_len = data_end - data;
+	if (xrow_decode_dml(&item, request, dml_request_key_map(type)) != 0)
+		return -1;
+	/* The item header lives on stack, see also iproto_msg_decode(). */
+	request->header = NULL;
+	return 0;
+
+bad_msgpack:
+	xrow_on_decode_err(row, ER_INVALID_MSGPACK, "batch request");
+	return -1;
+}
+
+int
+xrow_decode_batch(const struct xrow_header *row,
+		  struct batch_request *request)
+{
+	assert(row->type == IPROTO_BATCH);
+	memset(request, 0, sizeof(*request));
+
+	if (row->bodycnt == 0) {
+		xrow_on_decode_err(row, ER_MISSING_REQUEST_FIELD,
+				   iproto_key_name(IPROTO_REQUESTS));
+		return -1;
+	}
+	const char *d = row->body[0].iov_base;
+	if (mp_typeof(*d) != MP_MAP)
+		goto bad_msgpack;
+
+	const char *requests = NULL;
+	uint32_t map_size = mp_decode_map(&d);
+	for (uint32_t i = 0; i < map_size; ++i) {
+		if (mp_typeof(*d) != MP_UINT)
+			goto bad_msgpack;
+		uint64_t key = mp_decode_uint(&d);
+		if (key >= IPROTO_KEY_MAX ||
+		    mp_typeof(*d) != iproto_key_type[key])
+			goto bad_msgpack;
+		switch (key) {
+		case IPROTO_REQUESTS:
+			requests = d;
+			mp_next(&d);
+			break;
+		case IPROTO_IS_ATOMIC:
+			request->is_atomic = mp_decode_bool(&d);
+			break;
+		default:
+			mp_next(&d);
+			break;
+		}
+	}
+	if (requests == NULL) {
+		xrow_on_decode_err(row, ER_MISSING_REQUEST_FIELD,
+				   iproto_key_name(IPROTO_REQUESTS));
+		return -1;
+	}
+	uint32_t count = mp_decode_array(&requests);
+	if (count == 0) {
+		xrow_on_decode_err(row, ER_MISSING_REQUEST_FIELD,
+				   iproto_key_name(IPROTO_REQUESTS));
+		return -1;
+	}
+	size_t size = count * sizeof(*request->requests);
+	request->requests = malloc(size);
+	if (request->requests == NULL) {
+		diag_set(OutOfMemory, size, "malloc", "request->requests");
+		return -1;
+	}
+	for (uint32_t i = 0; i < count; i++) {
+		const char *item = requests;
+		mp_next(&requests);
+		if (xrow_decode_batch_item(row, item, requests,
+					   &request->requests[i]) != 0) {
+			batch_request_destroy(request);
+			return -1;
+		}
+	}
+	request->request_count = count;
+	return 0;
+
+bad_msgpack:
+	xrow_on_decode_err(row, ER_INVALID_MSGPACK, "request body");
+	return -1;
+}
+
+void
+batch_request_destroy(struct batch_request *request)
+{
+	free(request->requests);
+	request->requests = NULL;
+	request->request_count = 0;
+}
+
 void
 xrow_encode_vote(struct xrow_header *row)
 {
@@ -1740,11 +2051,13 @@ xrow_encode_subscribe(struct xrow_header *row,
 		      const struct tt_uuid *replicaset_uuid,
 		      const struct tt_uuid *instance_uuid,
 		      const struct vclock *vclock, bool anon,
-		      uint32_t id_filter)
+		      uint32_t id_filter, uint8_t compression,
+		      const uint32_t *spaces, uint32_t space_count)
 {
 	memset(row, 0, sizeof(*row));
 	size_t size = XROW_BODY_LEN_MAX +
-		      mp_sizeof_vclock_ignore0(vclock);
+		      mp_sizeof_vclock_ignore0(vclock) +
+		      space_count * mp_sizeof_uint(UINT32_MAX);
 	char *buf = (char *) region_alloc(&fiber()->gc, size);
 	if (buf == NULL) {
 		diag_set(OutOfMemory, size, "region_alloc", "buf");
@@ -1752,7 +2065,9 @@ xrow_encode_subscribe(struct xrow_header *row,
 	}
 	char *data = buf;
 	int filter_size = bit_count_u32(id_filter);
-	data = mp_encode_map(data, filter_size != 0 ? 6 : 5);
+	data = mp_encode_map(data, 5 + (filter_size != 0) +
+				   (compression != IPROTO_COMPRESSION_NONE) +
+				   (space_count != 0));
 	data = mp_encode_uint(data, IPROTO_CLUSTER_UUID);
 	data = xrow_encode_uuid(data, replicaset_uuid);
 	data = mp_encode_uint(data, IPROTO_INSTANCE_UUID);
@@ -1774,6 +2089,16 @@ xrow_encode_subscribe(struct xrow_header *row,
 			data = mp_encode_uint(data, id);
 		}
 	}
+	if (compression != IPROTO_COMPRESSION_NONE) {
+		data = mp_encode_uint(data, IPROTO_REPLICATION_COMPRESSION);
+		data = mp_encode_uint(data, compression);
+	}
+	if (space_count != 0) {
+		data = mp_encode_uint(data, IPROTO_REPLICATION_SPACES);
+		data = mp_encode_array(data, space_count);
+		for (uint32_t i = 0; i < space_count; i++)
+			data = mp_encode_uint(data, spaces[i]);
+	}
 	assert(data <= buf + size);
 	row->body[0].iov_base = buf;
 	row->body[0].iov_len = (data - buf);
@@ -1786,7 +2111,9 @@ int
 xrow_decode_subscribe(const struct xrow_header *row,
 		      struct tt_uuid *replicaset_uuid,
 		      struct tt_uuid *instance_uuid, struct vclock *vclock,
-		      uint32_t *version_id, bool *anon, uint32_t *id_filter)
+		      uint32_t *version_id, bool *anon, uint32_t *id_filter,
+		      uint8_t *compression, uint32_t **spaces,
+		      uint32_t *space_count)
 {
 	if (row->bodycnt == 0) {
 		diag_set(ClientError, ER_INVALID_MSGPACK, "request body");
@@ -1811,6 +2138,12 @@ xrow_decode_subscribe(const struct xrow_header *row,
 		*anon = false;
 	if (id_filter != NULL)
 		*id_filter = 0;
+	if (compression != NULL)
+		*compression = IPROTO_COMPRESSION_NONE;
+	if (spaces != NULL) {
+		*spaces = NULL;
+		*space_count = 0;
+	}
 
 	uint32_t map_size = mp_decode_map(&d);
 	for (uint32_t i = 0; i < map_size; i++) {
@@ -1886,6 +2219,46 @@ id_filter_decode_err:		xrow_on_decode_err(row, ER_INVALID_MSGPACK,
 				*id_filter |= 1 << val;
 			}
 			break;
+		case IPROTO_REPLICATION_COMPRESSION:
+			if (compression == NULL)
+				goto skip;
+			if (mp_typeof(*d) != MP_UINT) {
+				xrow_on_decode_err(row, ER_INVALID_MSGPACK,
+						   "invalid COMPRESSION");
+				return -1;
+			}
+			*compression = mp_decode_uint(&d);
+			break;
+		case IPROTO_REPLICATION_SPACES: {
+			if (spaces == NULL)
+				goto skip;
+			if (mp_typeof(*d) != MP_ARRAY) {
+spaces_decode_err:		xrow_on_decode_err(row, ER_INVALID_MSGPACK,
+						   "invalid REPLICATION_SPACES");
+				return -1;
+			}
+			uint32_t len = mp_decode_array(&d);
+			size_t size;
+			uint32_t *ids = region_alloc_array(&fiber()->gc,
+							   uint32_t, len,
+							   &size);
+			if (ids == NULL) {
+				diag_set(OutOfMemory, size,
+					 "region_alloc_array", "ids");
+				return -1;
+			}
+			for (uint32_t i = 0; i < len; ++i) {
+				if (mp_typeof(*d) != MP_UINT)
+					goto spaces_decode_err;
+				uint64_t val = mp_decode_uint(&d);
+				if (val > UINT32_MAX)
+					goto spaces_decode_err;
+				ids[i] = val;
+			}
+			*spaces = ids;
+			*space_count = len;
+			break;
+		}
 		default: skip:
 			mp_next(&d); /* value */
 		}
@@ -1947,25 +2320,33 @@ xrow_encode_vclock(struct xrow_header *row, const struct vclock *vclock)
 int
 xrow_encode_subscribe_response(struct xrow_header *row,
 			       const struct tt_uuid *replicaset_uuid,
-			       const struct vclock *vclock)
+			       const struct vclock *vclock,
+			       uint8_t compression)
 {
 	memset(row, 0, sizeof(*row));
-	size_t size = mp_sizeof_map(2) +
+	size_t size = mp_sizeof_map(3) +
 		      mp_sizeof_uint(IPROTO_VCLOCK) +
 		      mp_sizeof_vclock_ignore0(vclock) +
 		      mp_sizeof_uint(IPROTO_CLUSTER_UUID) +
-		      mp_sizeof_str(UUID_STR_LEN);
+		      mp_sizeof_str(UUID_STR_LEN) +
+		      mp_sizeof_uint(IPROTO_REPLICATION_COMPRESSION) +
+		      mp_sizeof_uint(compression);
 	char *buf = (char *) region_alloc(&fiber()->gc, size);
 	if (buf == NULL) {
 		diag_set(OutOfMemory, size, "region_alloc", "buf");
 		return -1;
 	}
 	char *data = buf;
-	data = mp_encode_map(data, 2);
+	bool has_compression = compression != IPROTO_COMPRESSION_NONE;
+	data = mp_encode_map(data, 2 + has_compression);
 	data = mp_encode_uint(data, IPROTO_VCLOCK);
 	data = mp_encode_vclock_ignore0(data, vclock);
 	data = mp_encode_uint(data, IPROTO_CLUSTER_UUID);
 	data = xrow_encode_uuid(data, replicaset_uuid);
+	if (has_compression) {
+		data = mp_encode_uint(data, IPROTO_REPLICATION_COMPRESSION);
+		data = mp_encode_uint(data, compression);
+	}
 	assert(data <= buf + size);
 	row->body[0].iov_base = buf;
 	row->body[0].iov_len = (data - buf);
@@ -88,6 +88,11 @@ struct xrow_header {
 	 * Zero if stream is not used.
 	 */
 	uint64_t stream_id;
+	/**
+	 * Compression of the body, see enum iproto_compression.
+	 * Used only in iproto packets, never written to WAL.
+	 */
+	uint8_t compression;
 	/** Transaction meta flags set only in the last transaction row. */
 	union {
 		uint8_t flags;
@@ -202,6 +207,20 @@ struct request {
 	const char *new_tuple;
 	/** End of @new_tuple. */
 	const char *new_tuple_end;
+	/**
+	 * Iterator position to start SELECT after, as returned
+	 * by a previous SELECT (MsgPack string contents).
+	 */
+	const char *after_position;
+	/** End of @after_position. */
+	const char *after_position_end;
+	/** True if SELECT must return the iterator position. */
+	bool fetch_position;
+	/**
+	 * Max number of tuples in an IPROTO_CHUNK packet of
+	 * a SELECT response, 0 if the response is not chunked.
+	 */
+	uint32_t chunk_size;
 	/** Base field offset for UPDATE/UPSERT, e.g. 0 for C and 1 for Lua. */
 	int index_base;
 };
@@ -224,6 +243,35 @@ int
 xrow_decode_dml(struct xrow_header *xrow, struct request *request,
 		uint64_t key_map);
 
+/**
+ * Decode only the space id of a DML request, without looking at
+ * the keys following it.
+ * @param row request header.
+ * @param[out] space_id the space id, 0 if the request has none.
+ * @retval 0 on success
+ * @retval -1 on error
+ */
+int
+xrow_decode_space_id(struct xrow_header *row, uint32_t *space_id);
+
+struct ZSTD_DCtx_s;
+
+/**
+ * Decompress the body of a row compressed with IPROTO_COMPRESSION
+ * and make the row point to the decompressed body.
+ * @param row row with a compressed body.
+ * @param zctx zstd decompression context.
+ * @param alloc allocates the buffer for the decompressed body of
+ *        the given size, returns NULL and sets the diag if the
+ *        size is too big or on memory error.
+ * @param alloc_ctx the first argument of @a alloc.
+ * @retval 0 on success
+ * @retval -1 on error
+ */
+int
+xrow_decompress(struct xrow_header *row, struct ZSTD_DCtx_s *zctx,
+		void *(*alloc)(void *ctx, size_t size), void *alloc_ctx);
+
 /**
  * Encode the request fields to iovec using region_alloc().
  * @param request request to encode
@@ -486,6 +534,12 @@ xrow_encode_register(struct xrow_header *row,
  * @param anon Whether it is an anonymous subscribe request or not.
  * @param id_filter A List of replica ids to skip rows from
  *		    when feeding a replica.
+ * @param compression Compression of the replication stream
+ *		      requested by the replica, see enum
+ *		      iproto_compression.
+ * @param spaces Ids of the spaces whose rows the replica wants
+ *		 to receive, all spaces if space_count is 0.
+ * @param space_count Number of ids in spaces.
  *
  * @retval  0 Success.
  * @retval -1 Memory error.
@@ -495,7 +549,8 @@ xrow_encode_subscribe(struct xrow_header *row,
 		      const struct tt_uuid *replicaset_uuid,
 		      const struct tt_uuid *instance_uuid,
 		      const struct vclock *vclock, bool anon,
-		      uint32_t id_filter);
+		      uint32_t id_filter, uint8_t compression,
+		      const uint32_t *spaces, uint32_t space_count);
 
 /**
  * Decode SUBSCRIBE command.
@@ -507,6 +562,11 @@ xrow_encode_subscribe(struct xrow_header *row,
  * @param[out] anon Whether it is an anonymous subscribe.
  * @param[out] id_filter A list of ids to skip rows from when
  *			 feeding a replica.
+ * @param[out] compression Compression of the replication stream.
+ * @param[out] spaces Ids of the spaces the replica subscribes to,
+ *			   allocated on the fiber region, NULL if the
+ *			   replica subscribes to all spaces.
+ * @param[out] space_count Number of ids in spaces.
  *
  * @retval  0 Success.
  * @retval -1 Memory or format error.
@@ -515,7 +575,9 @@ int
 xrow_decode_subscribe(const struct xrow_header *row,
 		      struct tt_uuid *replicaset_uuid,
 		      struct tt_uuid *instance_uuid, struct vclock *vclock,
-		      uint32_t *version_id, bool *anon, uint32_t *id_filter);
+		      uint32_t *version_id, bool *anon, uint32_t *id_filter,
+		      uint8_t *compression, uint32_t **spaces,
+		      uint32_t *space_count);
 
 /**
  * Encode JOIN command.
@@ -542,7 +604,7 @@ xrow_decode_join(const struct xrow_header *row, struct tt_uuid *instance_uuid,
 		 uint32_t *version_id)
 {
 	return xrow_decode_subscribe(row, NULL, instance_uuid, NULL, version_id,
-				     NULL, NULL);
+				     NULL, NULL, NULL, NULL, NULL);
 }
 
 /**
@@ -561,7 +623,7 @@ xrow_decode_register(const struct xrow_header *row,
 		     uint32_t *version_id)
 {
 	return xrow_decode_subscribe(row, NULL, instance_uuid, vclock,
-				     version_id, NULL, NULL);
+				     version_id, NULL, NULL, NULL, NULL, NULL);
 }
 
 /**
@@ -586,7 +648,8 @@ xrow_encode_vclock(struct xrow_header *row, const struct vclock *vclock);
 static inline int
 xrow_decode_vclock(const struct xrow_header *row, struct vclock *vclock)
 {
-	return xrow_decode_subscribe(row, NULL, NULL, vclock, NULL, NULL, NULL);
+	return xrow_decode_subscribe(row, NULL, NULL, vclock, NULL, NULL, NULL,
+				     NULL, NULL, NULL);
 }
 
 /**
@@ -594,6 +657,8 @@ xrow_decode_vclock(const struct xrow_header *row, struct vclock *vclock)
  * @param row[out] Row to encode into.
  * @param replicaset_uuid.
  * @param vclock.
+ * @param compression Compression of the replication stream
+ *		      following the response.
  *
  * @retval 0 Success.
  * @retval -1 Memory error.
@@ -601,13 +666,15 @@ xrow_decode_vclock(const struct xrow_header *row, struct vclock *vclock)
 int
 xrow_encode_subscribe_response(struct xrow_header *row,
 			      const struct tt_uuid *replicaset_uuid,
-			      const struct vclock *vclock);
+			      const struct vclock *vclock,
+			      uint8_t compression);
 
 /**
  * Decode a response to subscribe request.
  * @param row Row to decode.
  * @param[out] replicaset_uuid.
  * @param[out] vclock.
+ * @param[out] compression.
  *
  * @retval 0 Success.
  * @retval -1 Memory or format error.
@@ -615,10 +682,10 @@ xrow_encode_subscribe_response(struct xrow_header *row,
 static inline int
 xrow_decode_subscribe_response(const struct xrow_header *row,
 			       struct tt_uuid *replicaset_uuid,
-			       struct vclock *vclock)
+			       struct vclock *vclock, uint8_t *compression)
 {
 	return xrow_decode_subscribe(row, replicaset_uuid, NULL, vclock, NULL,
-				     NULL, NULL);
+				     NULL, NULL, compression, NULL, NULL);
 }
 
 /**
@@ -692,6 +759,57 @@ void
 iproto_reply_select(struct obuf *buf, struct obuf_svp *svp, uint64_t sync,
 		    uint32_t schema_version, uint32_t count);
 
+/**
+ * Same as iproto_reply_select(), but writes an IPROTO_CHUNK
+ * header carrying a part of the SELECT result.
+ */
+void
+iproto_reply_select_chunk(struct obuf *buf, struct obuf_svp *svp,
+			  uint64_t sync, uint32_t schema_version,
+			  uint32_t count);
+
+/**
+ * Append the iterator position to the select result set and
+ * write the select header to a preallocated buffer. The reply
+ * body is {IPROTO_DATA: [tuples], IPROTO_POSITION: position}.
+ * @param buf Out buffer.
+ * @param svp Savepoint of the header beginning.
+ * @param sync Request sync.
+ * @param schema_version Schema version.
+ * @param count Number of tuples in the result set.
+ * @param packed_pos Iterator position.
+ * @param packed_pos_end End of @a packed_pos.
+ *
+ * @retval  0 Success.
+ * @retval -1 Memory error.
+ */
+int
+iproto_reply_select_with_position(struct obuf *buf, struct obuf_svp *svp,
+				  uint64_t sync, uint32_t schema_version,
+				  uint32_t count, const char *packed_pos,
+				  const char *packed_pos_end);
+
+/**
+ * Append the error of a failed request of a BATCH to the result
+ * set and write the select header to a preallocated buffer. The
+ * reply body is {IPROTO_DATA: [results], IPROTO_ERROR_24: message,
+ * IPROTO_ERROR: error}, where the results are those of the
+ * requests preceding the failed one.
+ * @param buf Out buffer.
+ * @param svp Savepoint of the header beginning.
+ * @param sync Request sync.
+ * @param schema_version Schema version.
+ * @param count Number of results in the result set.
+ * @param e Error of the failed request.
+ *
+ * @retval  0 Success.
+ * @retval -1 Memory error.
+ */
+int
+iproto_reply_batch_with_error(struct obuf *buf, struct obuf_svp *svp,
+			      uint64_t sync, uint32_t schema_version,
+			      uint32_t count, const struct error *e);
+
 /**
  * Encode iproto header with IPROTO_OK response code.
  * @param out Encode to.
@@ -818,6 +936,18 @@ void
 iproto_do_write_error(struct iostream *io, const struct error *e,
 		      uint32_t schema_version, uint64_t sync);
 
+/**
+ * Encode an error response into a row. The body is allocated on
+ * the fiber region.
+ * @param[out] row Row to encode into.
+ * @param e Error to encode.
+ *
+ * @retval  0 Success.
+ * @retval -1 Memory error.
+ */
+int
+xrow_encode_error(struct xrow_header *row, const struct error *e);
+
 enum {
 	/* Maximal length of protocol name in handshake */
 	GREETING_PROTOCOL_LEN_MAX = 32,
@@ -923,6 +1053,43 @@ struct begin_request {
 int
 xrow_decode_begin(const struct xrow_header *row, struct begin_request *request);
 
+/**
+ * BATCH request.
+ */
+struct batch_request {
+	/**
+	 * Decoded requests of the batch, allocated with malloc().
+	 * Must be freed with batch_request_destroy().
+	 */
+	struct request *requests;
+	/** Number of requests in the batch. */
+	uint32_t request_count;
+	/**
+	 * True if all requests of the batch must be executed in
+	 * one transaction.
+	 */
+	bool is_atomic;
+};
+
+/**
+ * Parse the BATCH request. Every request of the batch is
+ * decoded as a DML request of its own type, which must be
+ * one of SELECT, INSERT, REPLACE, UPDATE, DELETE, UPSERT.
+ * An empty batch is rejected.
+ * @param row Encoded data.
+ * @param[out] request Request to decode to.
+ *
+ * @retval  0 Sucess.
+ * @retval -1 Format error.
+ */
+int
+xrow_decode_batch(const struct xrow_header *row,
+		  struct batch_request *request);
+
+/** Free memory allocated by xrow_decode_batch(). */
+void
+batch_request_destroy(struct batch_request *request);
+
 /**
  * Update vclock with the next LSN value for given replica id.
  * The function will cause panic if the next LSN happens to be
@@ -1057,10 +1224,12 @@ xrow_encode_subscribe_xc(struct xrow_header *row,
 			 const struct tt_uuid *replicaset_uuid,
 			 const struct tt_uuid *instance_uuid,
 			 const struct vclock *vclock, bool anon,
-			 uint32_t id_filter)
+			 uint32_t id_filter, uint8_t compression,
+			 const uint32_t *spaces, uint32_t space_count)
 {
 	if (xrow_encode_subscribe(row, replicaset_uuid, instance_uuid,
-				  vclock, anon, id_filter) != 0)
+				  vclock, anon, id_filter, compression,
+				  spaces, space_count) != 0)
 		diag_raise();
 }
 
@@ -1070,11 +1239,13 @@ xrow_decode_subscribe_xc(const struct xrow_header *row,
 			 struct tt_uuid *replicaset_uuid,
 			 struct tt_uuid *instance_uuid, struct vclock *vclock,
 			 uint32_t *replica_version_id, bool *anon,
-			 uint32_t *id_filter)
+			 uint32_t *id_filter, uint8_t *compression,
+			 uint32_t **spaces, uint32_t *space_count)
 {
 	if (xrow_decode_subscribe(row, replicaset_uuid, instance_uuid,
 				  vclock, replica_version_id, anon,
-				  id_filter) != 0)
+				  id_filter, compression, spaces,
+				  space_count) != 0)
 		diag_raise();
 }
 
@@ -1126,9 +1297,11 @@ xrow_decode_vclock_xc(const struct xrow_header *row, struct vclock *vclock)
 static inline void
 xrow_encode_subscribe_response_xc(struct xrow_header *row,
 				  const struct tt_uuid *replicaset_uuid,
-				  const struct vclock *vclock)
+				  const struct vclock *vclock,
+				  uint8_t compression)
 {
-	if (xrow_encode_subscribe_response(row, replicaset_uuid, vclock) != 0)
+	if (xrow_encode_subscribe_response(row, replicaset_uuid, vclock,
+					   compression) != 0)
 		diag_raise();
 }
 
@@ -1136,9 +1309,10 @@ xrow_encode_subscribe_response_xc(struct xrow_header *row,
 static inline void
 xrow_decode_subscribe_response_xc(const struct xrow_header *row,
 				  struct tt_uuid *replicaset_uuid,
-				  struct vclock *vclock)
+				  struct vclock *vclock, uint8_t *compression)
 {
-	if (xrow_decode_subscribe_response(row, replicaset_uuid, vclock) != 0)
+	if (xrow_decode_subscribe_response(row, replicaset_uuid, vclock,
+					   compression) != 0)
 		diag_raise();
 }
 
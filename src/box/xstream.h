@@ -53,6 +53,12 @@ struct xstream {
 	xstream_write_f write;
 	xstream_yield_f yield;
 	uint64_t row_count;
+	/**
+	 * Set if recovery must yield after each read from disk and
+	 * not only every WAL_ROWS_PER_YIELD rows, so as not to block
+	 * other fibers of the thread on disk reads for long.
+	 */
+	bool yield_on_read;
 };
 
 static inline void
@@ -62,6 +68,7 @@ xstream_create(struct xstream *xstream, xstream_write_f write,
 	xstream->write = write;
 	xstream->yield = yield;
 	xstream->row_count = 0;
+	xstream->yield_on_read = false;
 }
 
 static inline void
@@ -202,6 +202,9 @@ evio_service_entry_accept_cb(ev_loop *loop, ev_io *watcher, int events)
 		}
 		/* Must be moved by the callback. */
 		assert(!iostream_is_initialized(&io));
+		/* The callback may pause the service. */
+		if (!ev_is_active(&entry->ev))
+			return;
 	}
 	if (fd >= 0)
 		close(fd);
@@ -514,6 +517,27 @@ evio_service_listen(struct evio_service *service)
 	return 0;
 }
 
+void
+evio_service_pause(struct evio_service *service)
+{
+	for (int i = 0; i < service->entry_count; i++) {
+		struct evio_service_entry *entry = &service->entries[i];
+		if (ev_is_active(&entry->ev))
+			ev_io_stop(service->loop, &entry->ev);
+	}
+}
+
+void
+evio_service_resume(struct evio_service *service)
+{
+	for (int i = 0; i < service->entry_count; i++) {
+		struct evio_service_entry *entry = &service->entries[i];
+		if (evio_service_entry_is_active(entry) &&
+		    !ev_is_active(&entry->ev))
+			ev_io_start(service->loop, &entry->ev);
+	}
+}
+
 void
 evio_service_stop(struct evio_service *service)
 {
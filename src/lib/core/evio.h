@@ -129,6 +129,18 @@ evio_service_detach(struct evio_service *service);
 void
 evio_service_stop(struct evio_service *service);
 
+/**
+ * Stop accepting new connections without closing the acceptor
+ * sockets. Pending connections stay in the listen backlog and
+ * may be accepted by other services sharing the sockets.
+ */
+void
+evio_service_pause(struct evio_service *service);
+
+/** Resume accepting new connections after evio_service_pause(). */
+void
+evio_service_resume(struct evio_service *service);
+
 /**
  * Updates @a dst evio_service socket settings according @a src evio service.
  */
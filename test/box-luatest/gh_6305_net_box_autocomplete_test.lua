@@ -28,6 +28,7 @@ g.test_autocomplete = function()
     -- connection should provide all functions available
     local r = tabcomplete('conn1:')
     t.assert_equals(r, {'conn1:',
+                        'conn1:batch(',
                         'conn1:eval_16(',
                         'conn1:call(',
                         'conn1:reload_schema(',
@@ -0,0 +1,119 @@
+local net = require('net.box')
+local server = require('test.luatest_helpers.server')
+local t = require('luatest')
+
+local g = t.group('iproto_batch', {{engine = 'memtx'}, {engine = 'vinyl'}})
+
+g.before_all(function(cg)
+    cg.server = server:new({alias = 'master'})
+    cg.server:start()
+    cg.server:exec(function(engine)
+        local s = box.schema.space.create('test', {engine = engine})
+        s:create_index('pk')
+        s:create_index('sk', {parts = {2, 'unsigned'}, unique = false})
+        box.schema.user.grant('guest', 'read,write', 'space', 'test')
+    end, {cg.params.engine})
+end)
+
+g.after_all(function(cg)
+    cg.server:drop()
+end)
+
+g.before_each(function(cg)
+    cg.conn = net.connect(cg.server.net_box_uri)
+end)
+
+g.after_each(function(cg)
+    cg.conn:close()
+    cg.server:exec(function()
+        box.space.test:truncate()
+    end)
+end)
+
+g.test_batch = function(cg)
+    local res, err = cg.conn:batch({
+        {'insert', 'test', {1, 10}},
+        {'replace', 'test', {2, 20}},
+        {'upsert', 'test', {3, 30}, {{'+', 2, 1}}},
+        {'upsert', 'test', {3, 30}, {{'+', 2, 1}}},
+        {'update', 'test', {1}, {{'+', 2, 1}}},
+        {'delete', 'test', {2}},
+        {'select', 'test', {}, {iterator = 'GE'}},
+        {'select', 'test', {31}, {index = 'sk', iterator = 'LE', limit = 1}},
+    })
+    t.assert_equals(err, nil)
+    t.assert_equals(res[1], {1, 10})
+    t.assert_equals(res[2], {2, 20})
+    t.assert_equals(res[3], nil)
+    t.assert_equals(res[4], nil)
+    t.assert_equals(res[5], {1, 11})
+    t.assert_equals(res[6], {2, 20})
+    t.assert_equals(res[7], {{1, 11}, {3, 31}})
+    t.assert_equals(res[8], {{3, 31}})
+    t.assert_equals(#res, 8)
+end
+
+g.test_batch_atomic = function(cg)
+    local res = cg.conn:batch({
+        {'insert', 'test', {1, 10}},
+        {'insert', 'test', {2, 20}},
+    }, {is_atomic = true})
+    t.assert_equals(res, {{1, 10}, {2, 20}})
+    t.assert_error_msg_contains('Duplicate key exists', cg.conn.batch,
+                                cg.conn, {
+        {'insert', 'test', {3, 30}},
+        {'insert', 'test', {1, 10}},
+    }, {is_atomic = true})
+    -- Nothing is applied.
+    t.assert_equals(cg.conn.space.test:select(), {{1, 10}, {2, 20}})
+end
+
+g.test_batch_partial = function(cg)
+    local res, err = cg.conn:batch({
+        {'insert', 'test', {1, 10}},
+        {'insert', 'test', {1, 10}},
+        {'insert', 'test', {2, 20}},
+    })
+    t.assert_equals(res, {{1, 10}})
+    t.assert_equals(err.type, 'ClientError')
+    t.assert_equals(err.code, box.error.TUPLE_FOUND)
+    t.assert_equals(cg.conn.space.test:select(), {{1, 10}})
+end
+
+g.test_batch_errors = function(cg)
+    t.assert_error_msg_contains('batch request must be', cg.conn.batch,
+                                cg.conn, {{'call', 'test'}})
+    local stream = cg.conn:new_stream()
+    t.assert_error_msg_contains('Unable to process BATCH request in stream',
+                                stream.batch, stream,
+                                {{'insert', 'test', {1, 10}}})
+    -- Empty batch.
+    t.assert_error_msg_equals("Missing mandatory field 'requests' in request",
+                              cg.conn.batch, cg.conn, {})
+end
+
+-- Requests of a batch yield on WAL writes, while replies to other
+-- requests of the same connection are written.
+g.test_batch_concurrent = function(cg)
+    local fiber = require('fiber')
+    local fibers = {}
+    for i = 1, 10 do
+        local f = fiber.new(function()
+            local res = cg.conn:batch({
+                {'insert', 'test', {i * 2, i}},
+                {'select', 'test', {i * 2}},
+            }, {is_atomic = i % 2 == 0})
+            local tuple = cg.conn.space.test:insert({i * 2 + 1, i})
+            return res, tuple
+        end)
+        f:set_joinable(true)
+        table.insert(fibers, f)
+    end
+    for i, f in ipairs(fibers) do
+        local ok, res, tuple = f:join()
+        t.assert(ok)
+        t.assert_equals(res, {{i * 2, i}, {{i * 2, i}}})
+        t.assert_equals(tuple, {i * 2 + 1, i})
+    end
+    t.assert_equals(cg.conn.space.test:count(), 20)
+end
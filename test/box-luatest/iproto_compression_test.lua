@@ -0,0 +1,147 @@
+local msgpack = require('msgpack')
+local net = require('net.box')
+local server = require('test.luatest_helpers.server')
+local t = require('luatest')
+
+local g = t.group()
+
+g.before_all(function(cg)
+    cg.server = server:new({alias = 'master'})
+    cg.server:start()
+    cg.server:exec(function()
+        local s = box.schema.space.create('test')
+        s:create_index('primary')
+        box.schema.user.grant('guest', 'read,write', 'space', 'test')
+    end)
+end)
+
+g.after_all(function(cg)
+    cg.server:drop()
+end)
+
+g.after_each(function(cg)
+    cg.server:exec(function()
+        box.space.test:truncate()
+        box.cfg{iproto_compression_threshold = 4096}
+        box.cfg{iproto_max_decompressed_size = 16 * 1024 * 1024}
+    end)
+end)
+
+local function net_stat(cg)
+    return cg.server:exec(function()
+        local stat = box.stat.net()
+        return {sent = stat.SENT.total, received = stat.RECEIVED.total}
+    end)
+end
+
+-- Sends a tuple with a big compressible string there and back, returns
+-- the number of bytes sent and received by the server.
+local function round_trip(cg, conn)
+    local data = string.rep('abcdefgh', 16 * 1024)
+    local before = net_stat(cg)
+    conn.space.test:replace({1, data})
+    t.assert_equals(conn.space.test:get(1), {1, data})
+    local after = net_stat(cg)
+    return after.sent - before.sent, after.received - before.received
+end
+
+g.test_feature = function(cg)
+    local conn = net.connect(cg.server.net_box_uri)
+    t.assert_equals(conn.peer_protocol_version, 4)
+    t.assert(conn.peer_protocol_features.compression)
+    conn:close()
+end
+
+g.test_compression = function(cg)
+    local conn = net.connect(cg.server.net_box_uri, {compression = true})
+    local sent, received = round_trip(cg, conn)
+    t.assert_lt(sent, 16 * 1024)
+    t.assert_lt(received, 16 * 1024)
+    conn:close()
+end
+
+g.test_no_compression = function(cg)
+    local conn = net.connect(cg.server.net_box_uri)
+    local sent, received = round_trip(cg, conn)
+    t.assert_gt(sent, 128 * 1024)
+    t.assert_gt(received, 128 * 1024)
+    conn:close()
+end
+
+g.test_threshold = function(cg)
+    cg.server:exec(function()
+        box.cfg{iproto_compression_threshold = 0}
+    end)
+    local conn = net.connect(cg.server.net_box_uri, {compression = true})
+    local sent, received = round_trip(cg, conn)
+    -- Responses are not compressed, but requests still are.
+    t.assert_gt(sent, 128 * 1024)
+    t.assert_lt(received, 16 * 1024)
+    conn:close()
+    cg.server:exec(function()
+        local t = require('luatest')
+        box.cfg{iproto_compression_threshold = 1024 * 1024}
+        t.assert_equals(box.cfg.iproto_compression_threshold, 1024 * 1024)
+        t.assert_error_msg_content_equals(
+            "Incorrect value for option 'iproto_compression_threshold': " ..
+            "the value must be >= 0 and <= 4294967295",
+            box.cfg, {iproto_compression_threshold = -1})
+    end)
+end
+-- The size of a decompressed request is checked before allocating
+-- a buffer for it.
+g.test_max_decompressed_size = function(cg)
+    cg.server:exec(function()
+        box.cfg{iproto_max_decompressed_size = 64 * 1024}
+    end)
+    local conn = net.connect(cg.server.net_box_uri, {compression = true})
+    t.assert_error_msg_contains(
+        'exceeds iproto_max_decompressed_size', conn.space.test.replace,
+        conn.space.test, {1, string.rep('x', 128 * 1024)})
+    conn.space.test:replace({1, string.rep('x', 32 * 1024)})
+    t.assert_equals(conn.space.test:count(), 1)
+    conn:close()
+    cg.server:exec(function()
+        local t = require('luatest')
+        t.assert_error_msg_content_equals(
+            "Incorrect value for option 'iproto_max_decompressed_size': " ..
+            "the value must be > 0 and <= 4294967295",
+            box.cfg, {iproto_max_decompressed_size = 0})
+    end)
+end
+
+-- Small bodies are sent as is.
+g.test_small = function(cg)
+    local conn = net.connect(cg.server.net_box_uri, {compression = true})
+    conn.space.test:replace({1, 'foo'})
+    t.assert_equals(conn.space.test:select(), {{1, 'foo'}})
+    conn:close()
+end
+
+local IPROTO_REQUEST_TYPE = 0x00
+local IPROTO_SYNC = 0x01
+local IPROTO_COMPRESSION = 0x0b
+local IPROTO_PING = 0x40
+
+g.test_invalid_body = function(cg)
+    local conn = net.connect(cg.server.net_box_uri)
+    local function inject(compression, body)
+        local header = msgpack.encode({
+            [IPROTO_REQUEST_TYPE] = IPROTO_PING,
+            [IPROTO_SYNC] = conn:_next_sync(),
+            [IPROTO_COMPRESSION] = compression,
+        })
+        local size = msgpack.encode(#header + #body)
+        return conn:_inject(size .. header .. body)
+    end
+    local bin = '\xc4\x03abc'
+    t.assert_error_msg_content_equals(
+        'Decompression error: unknown compression 2', inject, 2, bin)
+    t.assert_error_msg_content_equals(
+        'Invalid MsgPack - compressed body', inject, 1, msgpack.encode({}))
+    t.assert_error_msg_content_equals(
+        'Decompression error: invalid frame content size', inject, 1, bin)
+    -- The connection is still alive.
+    t.assert(conn:ping())
+    conn:close()
+end
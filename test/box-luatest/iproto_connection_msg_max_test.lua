@@ -0,0 +1,93 @@
+local net = require('net.box')
+local server = require('test.luatest_helpers.server')
+local t = require('luatest')
+
+local g = t.group()
+
+g.before_all(function(cg)
+    cg.server = server:new({alias = 'master'})
+    cg.server:start()
+    cg.server:exec(function()
+        box.schema.user.grant('guest', 'super')
+        local fiber = require('fiber')
+        rawset(_G, 'in_progress', 0)
+        rawset(_G, 'max_in_progress', 0)
+        rawset(_G, 'cond', fiber.cond())
+        -- Waits for wakeup() and reports the maximal number of
+        -- concurrent calls.
+        rawset(_G, 'wait', function()
+            _G.in_progress = _G.in_progress + 1
+            _G.max_in_progress = math.max(_G.max_in_progress,
+                                          _G.in_progress)
+            _G.cond:wait()
+            _G.in_progress = _G.in_progress - 1
+        end)
+        rawset(_G, 'wakeup', function()
+            _G.cond:broadcast()
+        end)
+    end)
+end)
+
+g.after_all(function(cg)
+    cg.server:drop()
+end)
+
+g.after_each(function(cg)
+    cg.server:exec(function()
+        box.cfg{iproto_connection_msg_max = 0}
+        _G.max_in_progress = 0
+    end)
+end)
+
+-- Sends requests blocked in tx until all of them are done.
+-- Returns the maximal number of requests processed at once.
+local function flood(cg, count)
+    local conn = net.connect(cg.server.net_box_uri)
+    local other = net.connect(cg.server.net_box_uri)
+    local futures = {}
+    for _ = 1, count do
+        table.insert(futures, conn:call('wait', {}, {is_async = true}))
+    end
+    local done = 0
+    while done < count do
+        -- Requests of other connections are not blocked.
+        other:call('wakeup')
+        done = 0
+        for _, future in ipairs(futures) do
+            if future:is_ready() then
+                done = done + 1
+            end
+        end
+    end
+    for _, future in ipairs(futures) do
+        local _, err = future:result()
+        t.assert_equals(err, nil)
+    end
+    conn:close()
+    other:close()
+    return cg.server:exec(function() return _G.max_in_progress end)
+end
+
+g.test_limit = function(cg)
+    cg.server:exec(function()
+        box.cfg{iproto_connection_msg_max = 2}
+    end)
+    t.assert_equals(flood(cg, 20), 2)
+end
+
+g.test_no_limit = function(cg)
+    t.assert_gt(flood(cg, 20), 2)
+end
+
+g.test_cfg = function(cg)
+    cg.server:exec(function()
+        local t = require('luatest')
+        t.assert_equals(box.cfg.iproto_connection_msg_max, 0)
+        box.cfg{iproto_connection_msg_max = 10}
+        t.assert_equals(box.cfg.iproto_connection_msg_max, 10)
+        t.assert_error_msg_content_equals(
+            "Incorrect value for option 'iproto_connection_msg_max': " ..
+            "the value must not be less than zero",
+            box.cfg, {iproto_connection_msg_max = -1})
+    end)
+end
@@ -0,0 +1,151 @@
+local net = require('net.box')
+local server = require('test.luatest_helpers.server')
+local t = require('luatest')
+
+local g = t.group()
+
+g.before_all(function(cg)
+    cg.server = server:new({alias = 'master'})
+    cg.server:start()
+    cg.server:exec(function()
+        local s = box.schema.space.create('test')
+        s:create_index('primary')
+        s:insert({1})
+        box.schema.user.grant('guest', 'super')
+        -- Blocks tx thread without yielding.
+        rawset(_G, 'busy', function(timeout)
+            local clock = require('clock')
+            local deadline = clock.monotonic() + timeout
+            while clock.monotonic() < deadline do end
+        end)
+    end)
+end)
+
+g.after_all(function(cg)
+    cg.server:drop()
+end)
+
+g.after_each(function(cg)
+    cg.server:exec(function()
+        box.cfg{iproto_queue_delay_target = 0}
+    end)
+end)
+
+local function rejected_count(cg)
+    return cg.server:exec(function()
+        return box.stat.net().REQUESTS_REJECTED.total
+    end)
+end
+
+-- Sends requests while tx is busy so that a standing queue is
+-- built. Returns the number of rejected requests.
+local function overload(conn)
+    local futures = {}
+    for _ = 1, 3 do
+        conn:call('busy', {0.3}, {is_async = true})
+        for _ = 1, 10 do
+            table.insert(futures,
+                         conn.space.test:get(1, {is_async = true}))
+        end
+    end
+    local rejected = 0
+    for _, future in ipairs(futures) do
+        local res, err = future:wait_result()
+        if res == nil then
+            t.assert_equals(err.code, box.error.OVERLOADED)
+            rejected = rejected + 1
+        else
+            t.assert_equals(res, {1})
+        end
+    end
+    return rejected
+end
+
+g.test_disabled = function(cg)
+    local conn = net.connect(cg.server.net_box_uri)
+    local before = rejected_count(cg)
+    t.assert_equals(overload(conn), 0)
+    t.assert_equals(rejected_count(cg), before)
+    conn:close()
+end
+
+g.test_shedding = function(cg)
+    cg.server:exec(function()
+        box.cfg{iproto_queue_delay_target = 0.05}
+    end)
+    local conn = net.connect(cg.server.net_box_uri)
+    local before = rejected_count(cg)
+    local rejected = overload(conn)
+    t.assert_gt(rejected, 0)
+    t.assert_equals(rejected_count(cg) - before, rejected)
+    -- Requests are accepted again once the queue is drained.
+    t.assert_equals(conn.space.test:get(1), {1})
+    t.assert(conn:ping())
+    conn:close()
+end
+
+g.test_stat = function(cg)
+    local conn = net.connect(cg.server.net_box_uri)
+    t.assert(conn:ping())
+    local stat = cg.server:exec(function()
+        return {
+            total = box.stat.net().QUEUE_DELAY,
+            total_index = box.stat.net.QUEUE_DELAY,
+            thread = box.stat.net.thread()[1].QUEUE_DELAY,
+            thread_index = box.stat.net.thread[1].QUEUE_DELAY,
+        }
+    end)
+    for _, v in pairs(stat) do
+        t.assert_type(v.current, 'number')
+        t.assert_type(v.min, 'number')
+        t.assert_lt(v.current, 0.3)
+    end
+    -- Requests queued behind a busy tx thread are delayed. Every
+    -- request sees a standing queue so the minimum grows as well.
+    for _ = 1, 3 do
+        conn:call('busy', {0.3}, {is_async = true})
+    end
+    local delay = conn:eval('return box.stat.net().QUEUE_DELAY')
+    t.assert_gt(delay.current, 0.6)
+    t.assert_gt(delay.min, 0.2)
+    -- The delay goes down once the queue is drained.
+    t.helpers.retrying({}, function()
+        t.assert(conn:ping())
+        local delay = cg.server:exec(function()
+            return box.stat.net().QUEUE_DELAY
+        end)
+        t.assert_lt(delay.current, 0.1)
+        t.assert_lt(delay.min, 0.1)
+    end)
+    conn:close()
+end
+
+-- The delays aren't stuck at the last burst on an idle thread.
+g.test_stat_idle = function(cg)
+    local conn = net.connect(cg.server.net_box_uri)
+    for _ = 1, 3 do
+        conn:call('busy', {0.3}, {is_async = true})
+    end
+    local delay = conn:eval('return box.stat.net().QUEUE_DELAY')
+    t.assert_gt(delay.min, 0.2)
+    require('fiber').sleep(0.2)
+    delay = cg.server:exec(function()
+        return box.stat.net().QUEUE_DELAY
+    end)
+    t.assert_lt(delay.current, 0.1)
+    t.assert_lt(delay.min, 0.1)
+    conn:close()
+end
+
+g.test_cfg = function(cg)
+    cg.server:exec(function()
+        local t = require('luatest')
+        t.assert_equals(box.cfg.iproto_queue_delay_target, 0)
+        box.cfg{iproto_queue_delay_target = 0.1}
+        t.assert_equals(box.cfg.iproto_queue_delay_target, 0.1)
+        t.assert_error_msg_content_equals(
+            "Incorrect value for option 'iproto_queue_delay_target': " ..
+            "the value must not be less than zero",
+            box.cfg, {iproto_queue_delay_target = -1})
+    end)
+end
@@ -0,0 +1,164 @@
+local msgpack = require('msgpack')
+local net = require('net.box')
+local server = require('test.luatest_helpers.server')
+local socket = require('socket')
+local uri = require('uri')
+local t = require('luatest')
+
+local g = t.group('iproto_select_chunked',
+                  {{engine = 'memtx'}, {engine = 'vinyl'}})
+
+g.before_all(function(cg)
+    cg.server = server:new({
+        alias = 'master',
+        box_cfg = {memtx_use_mvcc_engine = true},
+    })
+    cg.server:start()
+    cg.server:exec(function(engine)
+        local s = box.schema.space.create('test', {engine = engine})
+        s:create_index('pk')
+        s:create_index('sk', {parts = {2, 'unsigned'}, unique = false})
+        box.schema.user.grant('guest', 'read,write', 'space', 'test')
+        for i = 1, 10 do
+            s:insert({i, i % 2})
+        end
+    end, {cg.params.engine})
+end)
+
+g.after_all(function(cg)
+    cg.server:drop()
+end)
+
+g.before_each(function(cg)
+    cg.conn = net.connect(cg.server.net_box_uri)
+end)
+
+g.after_each(function(cg)
+    cg.conn:close()
+end)
+
+local function collect(space_or_index, key, opts)
+    local result = {}
+    for i, tuple in space_or_index:pairs(key, opts) do
+        t.assert_equals(i, #result + 1)
+        table.insert(result, tuple)
+    end
+    return result
+end
+
+g.test_pairs = function(cg)
+    local space = cg.conn.space.test
+    local all = space:select()
+    t.assert_equals(#all, 10)
+    t.assert_equals(collect(space), all)
+    for _, chunk_size in ipairs({1, 3, 5, 10, 100}) do
+        t.assert_equals(collect(space, nil, {chunk_size = chunk_size}), all)
+    end
+    local tuple = collect(space, nil, {chunk_size = 3})[1]
+    t.assert(box.tuple.is(tuple))
+    t.assert_equals(collect(space, {100}, {chunk_size = 3}), {})
+end
+
+g.test_pairs_opts = function(cg)
+    local index = cg.conn.space.test.index.sk
+    local opts = {chunk_size = 2}
+    t.assert_equals(collect(index, {1}, opts), index:select({1}))
+    opts.iterator = 'GE'
+    opts.offset = 1
+    opts.limit = 7
+    t.assert_equals(collect(index, {0}, opts),
+                    index:select({0}, opts))
+    local pk = cg.conn.space.test.index.pk
+    local _, pos = pk:select({}, {limit = 4, fetch_pos = true})
+    t.assert_equals(collect(pk, {}, {chunk_size = 4, after = pos}),
+                    pk:select({}, {after = pos}))
+end
+
+-- The result is sent in IPROTO_CHUNK packets followed by the
+-- final response with the rest of tuples.
+g.test_chunks = function(cg)
+    local space_id = cg.conn.space.test.id
+    local future = cg.conn:_request(net._method.select_chunked,
+                                    {is_async = true}, nil, nil, space_id,
+                                    0, box.index.ALL, 0, 0xFFFFFFFF, {}, nil,
+                                    3)
+    local sizes = {}
+    for _, chunk in future:pairs() do
+        table.insert(sizes, #chunk)
+    end
+    t.assert_equals(sizes, {3, 3, 3, 1})
+    t.assert_equals(#future:result(), 1)
+end
+
+-- A chunked response waits for the output in a transaction too.
+g.test_stream = function(cg)
+    local stream = cg.conn:new_stream()
+    stream:begin()
+    stream.space.test:replace({11, 1})
+    local result = collect(stream.space.test, nil, {chunk_size = 2})
+    t.assert_equals(#result, 11)
+    stream:rollback()
+    t.assert_equals(#collect(cg.conn.space.test), 10)
+end
+
+g.test_error = function(cg)
+    t.assert_error_msg_content_equals(
+        "Unknown iterator type 'FOO'",
+        cg.conn.space.test.pairs, cg.conn.space.test, nil,
+        {iterator = 'FOO'})
+end
+
+local function in_progress(cg)
+    return cg.server:exec(function()
+        return box.stat.net().REQUESTS_IN_PROGRESS.current
+    end)
+end
+
+-- Chunks are not encoded faster than the client reads them.
+g.test_back_pressure = function(cg)
+    local space_id = cg.server:exec(function(engine)
+        local s = box.schema.space.create('big', {engine = engine})
+        s:create_index('pk')
+        box.schema.user.grant('guest', 'read', 'space', 'big')
+        box.begin()
+        for i = 1, 32 * 1024 do
+            s:insert({i, string.rep('x', 1024)})
+            if i % 1000 == 0 then
+                box.commit()
+                box.begin()
+            end
+        end
+        box.commit()
+        return s.id
+    end, {cg.params.engine})
+    local u = uri.parse(cg.server.net_box_uri)
+    local s = socket.tcp_connect(u.host, u.service)
+    t.assert_equals(#s:read(128), 128)
+    -- IPROTO_SELECT with IPROTO_CHUNK_SIZE = 10.
+    local data = msgpack.encode({[0x00] = 1, [0x01] = 1}) ..
+                 msgpack.encode({[0x10] = space_id, [0x11] = 0,
+                                 [0x12] = 0xFFFFFFFF, [0x13] = 0,
+                                 [0x14] = box.index.ALL, [0x20] = {},
+                                 [0x1d] = 10})
+    data = msgpack.encode(#data) .. data
+    t.assert_equals(s:write(data), #data)
+    -- 32 MB do not fit in the socket buffers, so the request
+    -- waits for the client to read the output. The other request
+    -- in progress is the one checking it.
+    require('fiber').sleep(0.5)
+    t.assert_equals(in_progress(cg), 2)
+    local size = 0
+    while true do
+        data = s:read({chunk = 1024 * 1024}, 1)
+        if data == nil or data == '' then
+            break
+        end
+        size = size + #data
+    end
+    t.assert_gt(size, 32 * 1024 * 1024)
+    t.assert_equals(in_progress(cg), 1)
+    s:close()
+    cg.server:exec(function()
+        box.space.big:drop()
+    end)
+end
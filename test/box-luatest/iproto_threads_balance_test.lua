@@ -0,0 +1,53 @@
+local net = require('net.box')
+local server = require('test.luatest_helpers.server')
+local t = require('luatest')
+
+local g = t.group()
+
+local THREADS = 4
+
+g.before_all(function(cg)
+    cg.server = server:new({
+        alias = 'master',
+        box_cfg = {iproto_threads = THREADS},
+    })
+    cg.server:start()
+end)
+
+g.after_all(function(cg)
+    cg.server:drop()
+end)
+
+local function thread_connections(cg)
+    return cg.server:exec(function()
+        local result = {}
+        for _, stat in ipairs(box.stat.net.thread()) do
+            table.insert(result, stat.CONNECTIONS.current)
+        end
+        return result
+    end)
+end
+
+-- New connections go to the least loaded iproto thread.
+g.test_balance = function(cg)
+    local conns = {}
+    for _ = 1, 10 * THREADS do
+        local conn = net.connect(cg.server.net_box_uri)
+        t.assert(conn:ping())
+        table.insert(conns, conn)
+    end
+    local counts = thread_connections(cg)
+    t.assert_equals(#counts, THREADS)
+    local min, max, total = math.huge, 0, 0
+    for _, count in ipairs(counts) do
+        min = math.min(min, count)
+        max = math.max(max, count)
+        total = total + count
+    end
+    -- The connection used by server:exec() is counted too.
+    t.assert_equals(total, #conns + 1)
+    t.assert_le(max - min, 2, 'connections are balanced')
+    for _, conn in ipairs(conns) do
+        conn:close()
+    end
+end
@@ -0,0 +1,94 @@
+local server = require('test.luatest_helpers.server')
+local t = require('luatest')
+
+local g = t.group()
+
+g.before_all(function(cg)
+    cg.server = server:new({
+        alias = 'master',
+        box_cfg = {memtx_checkpoint_threads = 3},
+    })
+    cg.server:start()
+    cg.server:exec(function()
+        for i = 1, 4 do
+            local s = box.schema.space.create('test' .. i)
+            s:create_index('primary')
+            for j = 1, 100 * i do
+                s:insert({j, string.rep('x', 100)})
+            end
+        end
+    end)
+end)
+
+g.after_all(function(cg)
+    cg.server:drop()
+end)
+
+g.test_snapshot_parts = function(cg)
+    cg.server:exec(function()
+        local fio = require('fio')
+        local t = require('luatest')
+        box.snapshot()
+        local parts = fio.glob(fio.pathjoin(box.cfg.memtx_dir, '*.snap.*'))
+        t.assert_equals(#parts, 2)
+        -- Older versions must refuse to recover the snapshot.
+        local main = parts[1]:gsub('%.snap%.%d+$', '.snap')
+        local f = fio.open(main)
+        local header = f:read(64)
+        f:close()
+        t.assert_str_matches(header, 'SNAP\n0%.14\n.*')
+        local files = box.backup.start()
+        box.backup.stop()
+        local snap_count = 0
+        for _, f in ipairs(files) do
+            if f:match('%.snap') then
+                snap_count = snap_count + 1
+            end
+        end
+        t.assert_equals(snap_count, 3)
+    end)
+    cg.server:stop()
+    cg.server:start()
+    cg.server:exec(function()
+        local t = require('luatest')
+        for i = 1, 4 do
+            t.assert_equals(box.space['test' .. i]:count(), 100 * i)
+        end
+    end)
+end
+
+-- Garbage collection removes all the parts of a snapshot even if
+-- one of them is missing.
+g.test_gc_missing_part = function(cg)
+    cg.server:exec(function()
+        local fio = require('fio')
+        local t = require('luatest')
+        box.cfg({checkpoint_count = 1})
+        box.space.test1:replace({1, 'y'})
+        box.snapshot()
+        local signature = box.info.signature
+        local function part(i)
+            return fio.pathjoin(box.cfg.memtx_dir,
+                                string.format('%020d.snap.%d', signature, i))
+        end
+        t.assert(fio.path.exists(part(2)))
+        fio.unlink(part(1))
+        box.space.test1:replace({1, 'z'})
+        box.snapshot()
+        t.helpers.retrying({}, function()
+            t.assert_not(fio.path.exists(part(2)))
+        end)
+        box.cfg({checkpoint_count = 2})
+    end)
+end
+
+g.test_cfg = function(cg)
+    cg.server:exec(function()
+        local t = require('luatest')
+        t.assert_equals(box.cfg.memtx_checkpoint_threads, 3)
+        t.assert_error_msg_content_equals(
+            "Incorrect value for option 'memtx_checkpoint_threads': " ..
+            "must be greater than or equal to 1",
+            box.cfg, {memtx_checkpoint_threads = 0})
+    end)
+end
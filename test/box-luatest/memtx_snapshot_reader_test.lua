@@ -0,0 +1,77 @@
+local fio = require('fio')
+local server = require('test.luatest_helpers.server')
+local t = require('luatest')
+
+local g = t.group()
+
+g.before_each(function(cg)
+    cg.server = server:new({alias = 'master'})
+    cg.server:start()
+end)
+
+g.after_each(function(cg)
+    cg.server:drop()
+end)
+
+-- Fill spaces with about 10 MB of data each, more than read
+-- ahead by a snapshot reader.
+local function fill(cg, space_count)
+    cg.server:exec(function(space_count)
+        local digest = require('digest')
+        for i = 1, space_count do
+            local s = box.schema.space.create('test' .. i)
+            s:create_index('primary')
+            box.begin()
+            for j = 1, 10000 do
+                s:insert({j, digest.base64_encode(digest.urandom(768))})
+                if j % 1000 == 0 then
+                    box.commit()
+                    box.begin()
+                end
+            end
+            box.commit()
+        end
+        box.snapshot()
+    end, {space_count})
+end
+
+g.test_read_ahead = function(cg)
+    cg.server:exec(function()
+        box.cfg{memtx_checkpoint_threads = 3}
+    end)
+    fill(cg, 4)
+    cg.server:stop()
+    cg.server:start()
+    cg.server:exec(function()
+        local t = require('luatest')
+        for i = 1, 4 do
+            t.assert_equals(box.space['test' .. i]:count(), 10000)
+        end
+    end)
+end
+
+g.test_corrupted_tx = function(cg)
+    fill(cg, 1)
+    local snap = cg.server:exec(function()
+        local fio = require('fio')
+        local files = fio.glob(fio.pathjoin(box.cfg.memtx_dir, '*.snap'))
+        return files[#files]
+    end)
+    cg.server:stop()
+    -- Damage a tx in the middle of the user space data.
+    local f = fio.open(snap, {'O_RDWR'})
+    local size = f:stat().size
+    f:pwrite(string.rep('\0', 64), math.floor(size / 2))
+    f:close()
+
+    cg.server.box_cfg = {force_recovery = true}
+    cg.server:start()
+    t.assert(cg.server:grep_log("can't open tx"))
+    cg.server:exec(function()
+        local t = require('luatest')
+        t.assert_equals(box.info.status, 'running')
+        local count = box.space.test1:count()
+        t.assert_lt(count, 10000)
+        t.assert_gt(count, 0)
+    end)
+end
@@ -0,0 +1,117 @@
+local net = require('net.box')
+local server = require('test.luatest_helpers.server')
+local t = require('luatest')
+
+local g = t.group('select_iterator_position',
+                  {{engine = 'memtx'}, {engine = 'vinyl'}})
+
+g.before_all(function(cg)
+    cg.server = server:new({alias = 'master'})
+    cg.server:start()
+    cg.server:exec(function(engine)
+        local s = box.schema.space.create('test', {engine = engine})
+        s:create_index('pk')
+        s:create_index('sk', {parts = {2, 'unsigned'}, unique = false})
+        for i = 1, 10 do
+            s:insert({i, i % 3})
+        end
+        box.schema.user.grant('guest', 'read', 'space', 'test')
+    end, {cg.params.engine})
+end)
+
+g.after_all(function(cg)
+    cg.server:drop()
+end)
+
+g.test_local_select = function(cg)
+    cg.server:exec(function()
+        local t = require('luatest')
+        local s = box.space.test
+
+        -- Page through the primary index.
+        local tuples, pos = s:select({}, {limit = 3, fetch_pos = true})
+        t.assert_equals(tuples, {{1, 1}, {2, 2}, {3, 0}})
+        t.assert_type(pos, 'string')
+        tuples, pos = s:select({}, {limit = 3, after = pos, fetch_pos = true})
+        t.assert_equals(tuples, {{4, 1}, {5, 2}, {6, 0}})
+        tuples = s:select({}, {limit = 3, after = pos})
+        t.assert_equals(tuples, {{7, 1}, {8, 2}, {9, 0}})
+
+        -- Reverse iteration.
+        tuples, pos = s:select({}, {iterator = 'LE', limit = 2,
+                                    fetch_pos = true})
+        t.assert_equals(tuples, {{10, 1}, {9, 0}})
+        tuples = s:select({}, {iterator = 'LE', limit = 2, after = pos})
+        t.assert_equals(tuples, {{8, 2}, {7, 1}})
+
+        -- Non-unique index: the position includes primary key parts.
+        local sk = s.index.sk
+        tuples, pos = sk:select({1}, {limit = 2, fetch_pos = true})
+        t.assert_equals(tuples, {{1, 1}, {4, 1}})
+        tuples, pos = sk:select({1}, {limit = 2, after = pos,
+                                      fetch_pos = true})
+        t.assert_equals(tuples, {{7, 1}, {10, 1}})
+        tuples, pos = sk:select({1}, {limit = 2, after = pos,
+                                      fetch_pos = true})
+        t.assert_equals(tuples, {})
+        t.assert_type(pos, 'string')
+        tuples, pos = sk:select({1}, {iterator = 'REQ', limit = 1,
+                                      fetch_pos = true})
+        t.assert_equals(tuples, {{10, 1}})
+        tuples = sk:select({1}, {iterator = 'REQ', limit = 1, after = pos})
+        t.assert_equals(tuples, {{7, 1}})
+
+        -- Empty result without a position.
+        tuples, pos = s:select({100}, {fetch_pos = true})
+        t.assert_equals(tuples, {})
+        t.assert_equals(pos, nil)
+
+        -- Position that doesn't match the search key.
+        local _
+        _, pos = s:select({5}, {limit = 1, fetch_pos = true})
+        t.assert_error_msg_content_equals(
+            'Iterator position is invalid', sk.select, sk, {2},
+            {after = pos})
+        t.assert_error_msg_content_equals(
+            'Iterator position is invalid', s.select, s, {7},
+            {iterator = 'GE', after = pos})
+        t.assert_error_msg_content_equals(
+            'Iterator position is invalid', s.select, s, {},
+            {after = 'garbage'})
+        t.assert_error_msg_content_equals(
+            'Iterator position is invalid', s.select, s, {},
+            {after = 1})
+    end)
+end
+
+g.test_unsupported = function(cg)
+    t.skip_if(cg.params.engine ~= 'memtx', 'memtx only')
+    cg.server:exec(function()
+        local t = require('luatest')
+        local s = box.schema.space.create('test_hash')
+        s:create_index('pk', {type = 'hash'})
+        t.assert_error_msg_content_equals(
+            "Index 'pk' does not support iterator position",
+            s.select, s, {}, {fetch_pos = true})
+        s:drop()
+    end)
+end
+
+g.test_net_box = function(cg)
+    local c = net.connect(cg.server.net_box_uri)
+    local s = c.space.test
+    local tuples, pos = s:select({}, {limit = 4, fetch_pos = true})
+    t.assert_equals(tuples, {{1, 1}, {2, 2}, {3, 0}, {4, 1}})
+    t.assert_type(pos, 'string')
+    tuples, pos = s:select({}, {limit = 4, after = pos, fetch_pos = true})
+    t.assert_equals(tuples, {{5, 2}, {6, 0}, {7, 1}, {8, 2}})
+    tuples = s:select({}, {after = pos})
+    t.assert_equals(tuples, {{9, 0}, {10, 1}})
+    local fut = s.index.sk:select({2}, {limit = 2, fetch_pos = true,
+                                        is_async = true})
+    local res = fut:wait_result()
+    t.assert_equals(res[1], {{2, 2}, {5, 2}})
+    tuples = s.index.sk:select({2}, {after = res[2]})
+    t.assert_equals(tuples, {{8, 2}})
+    c:close()
+end
@@ -0,0 +1,80 @@
+local server = require('test.luatest_helpers.server')
+local t = require('luatest')
+
+local g = t.group('wal_compression', t.helpers.matrix({threads = {0, 2}}))
+
+g.before_all(function(cg)
+    cg.server = server:new({
+        alias = 'master',
+        box_cfg = {wal_compression_threads = cg.params.threads},
+    })
+    cg.server:start()
+end)
+
+g.after_all(function(cg)
+    cg.server:drop()
+end)
+
+g.test_compression_stat = function(cg)
+    cg.server:exec(function()
+        local t = require('luatest')
+        local s = box.schema.space.create('test')
+        s:create_index('primary')
+        local before = box.info.wal().compression
+        -- Small transactions are not compressed.
+        s:insert({1, 'foo'})
+        t.assert_equals(box.info.wal().compression.blocks, before.blocks)
+        s:insert({2, string.rep('x', 64 * 1024)})
+        local after = box.info.wal().compression
+        t.assert_equals(after.blocks, before.blocks + 1)
+        t.assert_gt(after.bytes_in - before.bytes_in, 64 * 1024)
+        t.assert_lt(after.bytes_out - before.bytes_out, 4 * 1024)
+        t.assert_gt(after.ratio, 1)
+        t.assert_ge(after.time, before.time)
+        s:drop()
+    end)
+end
+
+-- Concurrent transactions get into one WAL write, which is split
+-- into several blocks, mixing compressed and small ones.
+g.test_recovery = function(cg)
+    cg.server:exec(function()
+        local fiber = require('fiber')
+        local s = box.schema.space.create('test')
+        s:create_index('primary')
+        local fibers = {}
+        for i = 1, 100 do
+            local f = fiber.new(function()
+                local size = i % 2 == 0 and 10 or 200 * 1024
+                s:insert({i, string.rep(tostring(i), size)})
+            end)
+            f:set_joinable(true)
+            table.insert(fibers, f)
+        end
+        for _, f in ipairs(fibers) do
+            f:join()
+        end
+    end)
+    cg.server:stop()
+    cg.server:start()
+    cg.server:exec(function()
+        local t = require('luatest')
+        local s = box.space.test
+        t.assert_equals(s:count(), 100)
+        for i = 1, 100 do
+            local size = i % 2 == 0 and 10 or 200 * 1024
+            t.assert_equals(s:get(i)[2], string.rep(tostring(i), size))
+        end
+        s:drop()
+    end)
+end
+
+g.test_cfg = function(cg)
+    cg.server:exec(function(threads)
+        local t = require('luatest')
+        t.assert_equals(box.cfg.wal_compression_threads, threads)
+        t.assert_error_msg_content_equals(
+            "Can't set option 'wal_compression_threads' dynamically",
+            box.cfg, {wal_compression_threads = threads + 1})
+    end, {cg.params.threads})
+end
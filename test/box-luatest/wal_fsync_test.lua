@@ -0,0 +1,79 @@
+local server = require('test.luatest_helpers.server')
+local t = require('luatest')
+
+local g = t.group()
+
+g.before_all(function(cg)
+    cg.server = server:new({alias = 'master'})
+    cg.server:start()
+    cg.server:exec(function()
+        box.schema.space.create('test')
+        box.space.test:create_index('primary')
+    end)
+end)
+
+g.after_all(function(cg)
+    cg.server:drop()
+end)
+
+g.after_each(function(cg)
+    cg.server:exec(function()
+        box.cfg{wal_fsync_interval = 0, wal_fsync_bytes = 0}
+        box.space.test:truncate()
+    end)
+end)
+
+-- Inserts a row and waits until it's synced to disk.
+local function insert_and_wait(cg)
+    cg.server:exec(function()
+        local t = require('luatest')
+        box.space.test:insert({1})
+        local vclock = box.info.vclock
+        vclock[0] = nil
+        t.helpers.retrying({}, function()
+            local synced = box.info.wal().synced_vclock
+            synced[0] = nil
+            t.assert_equals(synced, vclock)
+        end)
+    end)
+end
+
+g.test_interval = function(cg)
+    cg.server:exec(function()
+        box.cfg{wal_fsync_interval = 0.01}
+    end)
+    insert_and_wait(cg)
+end
+
+g.test_bytes = function(cg)
+    cg.server:exec(function()
+        box.cfg{wal_fsync_bytes = 1}
+    end)
+    insert_and_wait(cg)
+end
+
+-- The synced vclock isn't tracked if the WAL isn't synced.
+g.test_disabled = function(cg)
+    cg.server:exec(function()
+        local t = require('luatest')
+        t.assert_equals(box.cfg.wal_mode, 'write')
+        box.space.test:insert({1})
+        t.assert_equals(box.info.wal().synced_vclock, nil)
+    end)
+end
+
+g.test_cfg = function(cg)
+    cg.server:exec(function()
+        local t = require('luatest')
+        t.assert_equals(box.cfg.wal_fsync_interval, 0)
+        t.assert_equals(box.cfg.wal_fsync_bytes, 0)
+        t.assert_error_msg_content_equals(
+            "Incorrect value for option 'wal_fsync_interval': " ..
+            "the value must not be less than zero",
+            box.cfg, {wal_fsync_interval = -1})
+        t.assert_error_msg_content_equals(
+            "Incorrect value for option 'wal_fsync_bytes': " ..
+            "the value must not be less than zero",
+            box.cfg, {wal_fsync_bytes = -1})
+    end)
+end
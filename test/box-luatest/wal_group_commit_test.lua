@@ -0,0 +1,83 @@
+local misc = require('test.luatest_helpers.misc')
+local server = require('test.luatest_helpers.server')
+local t = require('luatest')
+
+local g = t.group()
+
+g.before_all(function(cg)
+    cg.server = server:new({alias = 'master'})
+    cg.server:start()
+    cg.server:exec(function()
+        box.schema.space.create('test')
+        box.space.test:create_index('primary')
+    end)
+end)
+
+g.after_all(function(cg)
+    cg.server:drop()
+end)
+
+g.after_each(function(cg)
+    cg.server:exec(function()
+        box.cfg{wal_group_commit_max_delay = 0}
+        box.space.test:truncate()
+    end)
+end)
+
+-- Commits a transaction that is stuck in WAL and then 'count'
+-- transactions in separate event loop iterations. Returns the
+-- number of WAL writes and the batch size histogram.
+local function write(cg, count)
+    return cg.server:exec(function(count)
+        local fiber = require('fiber')
+        local s = box.space.test
+        local batch_count = box.info.wal().batch_count
+        box.error.injection.set('ERRINJ_WAL_DELAY', true)
+        local fibers = {}
+        for i = 0, count do
+            local f = fiber.new(s.insert, s, {i})
+            f:set_joinable(true)
+            table.insert(fibers, f)
+            fiber.sleep(0.01)
+        end
+        box.error.injection.set('ERRINJ_WAL_DELAY', false)
+        for _, f in ipairs(fibers) do
+            assert(f:join())
+        end
+        local info = box.info.wal()
+        return info.batch_count - batch_count, info.batch_size_histogram
+    end, {count})
+end
+
+g.test_disabled = function(cg)
+    misc.skip_if_not_debug()
+    local batch_count = write(cg, 10)
+    t.assert_equals(batch_count, 11)
+end
+
+-- Transactions committed while the previous write is in progress
+-- are written at once.
+g.test_group_commit = function(cg)
+    misc.skip_if_not_debug()
+    cg.server:exec(function()
+        box.cfg{wal_group_commit_max_delay = 10}
+    end)
+    local batch_count, hist = write(cg, 10)
+    t.assert_equals(batch_count, 2)
+    t.assert_str_contains(hist, '[9-16]:1')
+end
+
+g.test_cfg = function(cg)
+    cg.server:exec(function()
+        local t = require('luatest')
+        t.assert_equals(box.cfg.wal_group_commit_max_delay, 0)
+        t.assert_error_msg_content_equals(
+            "Incorrect value for option 'wal_group_commit_max_delay': " ..
+            "the value must not be less than zero",
+            box.cfg, {wal_group_commit_max_delay = -1})
+        local info = box.info.wal()
+        t.assert_type(info.batch_count, 'number')
+        t.assert_type(info.batch_size_histogram, 'string')
+        t.assert_type(info.batch_wait_histogram, 'string')
+    end)
+end
@@ -0,0 +1,114 @@
+local t = require('luatest')
+local cluster = require('test.luatest_helpers.cluster')
+local server = require('test.luatest_helpers.server')
+
+local g = t.group()
+
+g.before_all(function(cg)
+    cg.cluster = cluster:new({})
+    cg.master = cg.cluster:build_server({
+        alias = 'master',
+        box_cfg = {replication_relay_threads = 1},
+    })
+    local replica_cfg = {
+        replication = {server.build_instance_uri('master')},
+        read_only = true,
+    }
+    cg.replica1 = cg.cluster:build_server({
+        alias = 'replica1',
+        box_cfg = replica_cfg,
+    })
+    cg.replica2 = cg.cluster:build_server({
+        alias = 'replica2',
+        box_cfg = replica_cfg,
+    })
+    cg.cluster:add_server(cg.master)
+    cg.cluster:add_server(cg.replica1)
+    cg.cluster:add_server(cg.replica2)
+    cg.cluster:start()
+    cg.master:exec(function()
+        box.schema.space.create('test')
+        box.space.test:create_index('primary')
+    end)
+end)
+
+g.after_all(function(cg)
+    cg.cluster:drop()
+end)
+
+-- Both relays are served by a single relay thread.
+g.test_relay_threads = function(cg)
+    cg.master:exec(function()
+        for i = 1, 1000 do
+            box.space.test:insert({i})
+        end
+    end)
+    for _, replica in ipairs({cg.replica1, cg.replica2}) do
+        replica:wait_vclock_of(cg.master)
+        t.assert_equals(replica:exec(function()
+            return box.space.test:count()
+        end), 1000)
+    end
+    -- A relay restarts in the relay thread after reconnect.
+    cg.replica1:stop()
+    cg.master:exec(function()
+        for i = 1001, 2000 do
+            box.space.test:insert({i})
+        end
+    end)
+    cg.replica1:start()
+    cg.replica1:wait_vclock_of(cg.master)
+    t.assert_equals(cg.replica1:exec(function()
+        return box.space.test:count()
+    end), 2000)
+    cg.master:exec(function()
+        local t = require('luatest')
+        for _, r in pairs(box.info.replication) do
+            if r.downstream ~= nil then
+                t.assert_equals(r.downstream.status, 'follow')
+            end
+        end
+    end)
+end
+
+-- A relay reading old WAL files doesn't stall a caught-up relay
+-- served by the same relay thread.
+g.test_lagging_relay = function(cg)
+    cg.replica2:stop()
+    cg.master:exec(function()
+        local data = string.rep('x', 1000)
+        for i = 1, 20 do
+            box.begin()
+            for j = 1, 1000 do
+                box.space.test:replace({j, data, i})
+            end
+            box.commit()
+        end
+    end)
+    cg.replica1:wait_vclock_of(cg.master)
+    cg.replica2:start({wait_for_readiness = false})
+    cg.master:exec(function()
+        box.space.test:replace({0})
+    end)
+    cg.replica1:exec(function()
+        local t = require('luatest')
+        t.helpers.retrying({timeout = 1}, function()
+            t.assert_equals(box.space.test:get(0), {0})
+        end)
+    end)
+    cg.replica2:wait_for_readiness()
+    cg.replica2:wait_vclock_of(cg.master)
+    t.assert_equals(cg.replica2:exec(function()
+        return box.space.test:get(0)
+    end), {0})
+end
+
+g.test_cfg = function(cg)
+    cg.master:exec(function()
+        local t = require('luatest')
+        t.assert_equals(box.cfg.replication_relay_threads, 1)
+        t.assert_error_msg_content_equals(
+            "Can't set option 'replication_relay_threads' dynamically",
+            box.cfg, {replication_relay_threads = 2})
+    end)
+end
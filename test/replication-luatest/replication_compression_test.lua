@@ -0,0 +1,138 @@
+local t = require('luatest')
+local cluster = require('test.luatest_helpers.cluster')
+local server = require('test.luatest_helpers.server')
+
+local g = t.group()
+
+g.before_all(function(cg)
+    cg.cluster = cluster:new({})
+    cg.master = cg.cluster:build_server({alias = 'master'})
+    cg.replica = cg.cluster:build_server({
+        alias = 'replica',
+        box_cfg = {
+            replication = {server.build_instance_uri('master')},
+            replication_compression = true,
+            read_only = true,
+        },
+    })
+    cg.cluster:add_server(cg.master)
+    cg.cluster:add_server(cg.replica)
+    cg.cluster:start()
+    cg.master:exec(function()
+        box.schema.space.create('test')
+        box.space.test:create_index('primary')
+    end)
+end)
+
+g.after_all(function(cg)
+    cg.cluster:drop()
+end)
+
+local function insert(cg, from, to)
+    cg.master:exec(function(from, to)
+        local json = require('json')
+        for i = from, to do
+            box.space.test:insert({i, json.encode({
+                id = i, name = 'name' .. i, tags = {'a', 'b', 'c'},
+                description = string.rep('lorem ipsum ', 10),
+            })})
+        end
+    end, {from, to})
+end
+
+local function downstream(cg)
+    local id = cg.replica:exec(function() return box.info.id end)
+    return cg.master:exec(function(id)
+        return box.info.replication[id].downstream
+    end, {id})
+end
+
+g.test_compression = function(cg)
+    insert(cg, 1, 1000)
+    cg.replica:wait_vclock_of(cg.master)
+    t.assert_equals(cg.replica:exec(function()
+        return box.space.test:count()
+    end), 1000)
+    local stat = downstream(cg).compression
+    t.assert_not_equals(stat, nil)
+    t.assert_gt(stat.bytes_in, 100 * 1000)
+    t.assert_lt(stat.bytes_out, stat.bytes_in / 2)
+    t.assert(cg.replica:grep_log('replication stream is compressed'))
+end
+
+-- The option takes effect on reconnect.
+g.test_disable = function(cg)
+    cg.replica:exec(function()
+        local replication = box.cfg.replication
+        box.cfg{replication_compression = false}
+        box.cfg{replication = {}}
+        box.cfg{replication = replication}
+    end)
+    insert(cg, 1001, 1100)
+    cg.replica:wait_vclock_of(cg.master)
+    t.helpers.retrying({}, function()
+        local stat = downstream(cg)
+        t.assert_equals(stat.status, 'follow')
+        t.assert_equals(stat.compression, nil)
+    end)
+    t.assert_equals(cg.replica:exec(function()
+        return box.space.test:count()
+    end), 1100)
+end
+
+local g_error = t.group('replication_compression_error')
+
+g_error.before_all(function(cg)
+    cg.cluster = cluster:new({})
+    cg.master = cg.cluster:build_server({
+        alias = 'master',
+        box_cfg = {checkpoint_count = 10},
+    })
+    cg.replica = cg.cluster:build_server({
+        alias = 'replica',
+        box_cfg = {
+            replication = {server.build_instance_uri('master')},
+            replication_compression = true,
+            replication_timeout = 0.1,
+            replication_sync_timeout = 0.1,
+            read_only = true,
+        },
+    })
+    cg.cluster:add_server(cg.master)
+    cg.cluster:add_server(cg.replica)
+    cg.cluster:start()
+    cg.master:exec(function()
+        box.schema.space.create('test')
+        box.space.test:create_index('primary')
+    end)
+    cg.replica:wait_vclock_of(cg.master)
+end)
+
+g_error.after_all(function(cg)
+    cg.cluster:drop()
+end)
+
+-- The error the relay fails with is sent through the compressed
+-- stream, so the replica gets it and keeps reconnecting.
+g_error.test_relay_error = function(cg)
+    cg.replica:stop()
+    cg.master:exec(function()
+        local fio = require('fio')
+        box.snapshot()
+        box.space.test:insert({1})
+        local files = fio.glob(fio.pathjoin(box.cfg.wal_dir, '*.xlog'))
+        table.sort(files)
+        local gap = files[#files]
+        box.snapshot()
+        box.space.test:insert({2})
+        fio.unlink(gap)
+    end)
+    cg.replica:start()
+    t.helpers.retrying({}, function()
+        t.assert(cg.replica:grep_log('Missing .xlog file'))
+    end)
+    t.assert_not(cg.replica:grep_log('Decompression error'))
+    t.assert_not_equals(cg.replica:exec(function()
+        return box.info.replication[1].upstream.status
+    end), 'stopped')
+end
@@ -0,0 +1,158 @@
+local t = require('luatest')
+local cluster = require('test.luatest_helpers.cluster')
+local server = require('test.luatest_helpers.server')
+
+local g = t.group()
+
+g.before_all(function(cg)
+    cg.cluster = cluster:new({})
+    cg.master = cg.cluster:build_server({
+        alias = 'master',
+        box_cfg = {
+            checkpoint_count = 1,
+            replication_feed_size = 16 * 1024 * 1024,
+        },
+    })
+    local replica_cfg = {
+        replication = {server.build_instance_uri('master')},
+        read_only = true,
+    }
+    cg.replica1 = cg.cluster:build_server({
+        alias = 'replica1',
+        box_cfg = replica_cfg,
+    })
+    cg.replica2 = cg.cluster:build_server({
+        alias = 'replica2',
+        box_cfg = replica_cfg,
+    })
+    cg.cluster:add_server(cg.master)
+    cg.cluster:add_server(cg.replica1)
+    cg.cluster:add_server(cg.replica2)
+    cg.cluster:start()
+    cg.master:exec(function()
+        box.schema.space.create('test')
+        box.space.test:create_index('primary')
+    end)
+end)
+
+g.after_all(function(cg)
+    cg.cluster:drop()
+end)
+
+-- Insert rows one by one, so that each gets into a WAL write of
+-- its own.
+local function insert(cg, count)
+    cg.master:exec(function(count)
+        local s = box.space.test
+        local max = s.index.primary:max()
+        local from = max == nil and 1 or max[1] + 1
+        for i = from, from + count - 1 do
+            s:insert({i})
+        end
+    end, {count})
+end
+
+local function check(cg, replica)
+    replica:wait_vclock_of(cg.master)
+    local count = cg.master:exec(function()
+        return box.space.test:count()
+    end)
+    t.assert_equals(replica:exec(function()
+        return box.space.test:count()
+    end), count)
+end
+
+-- Feed statistics of the relays, by replica id.
+local function feed_stat(cg)
+    return cg.master:exec(function()
+        local stat = {}
+        for id, r in pairs(box.info.replication) do
+            if r.downstream ~= nil and r.downstream.feed ~= nil then
+                stat[id] = r.downstream.feed
+            end
+        end
+        return stat
+    end)
+end
+
+-- Caught up relays send the rows encoded by the WAL thread.
+g.test_hits = function(cg)
+    local before = feed_stat(cg)
+    insert(cg, 100)
+    for _, replica in ipairs({cg.replica1, cg.replica2}) do
+        check(cg, replica)
+    end
+    local after = feed_stat(cg)
+    for _, replica in ipairs({cg.replica1, cg.replica2}) do
+        local id = replica:instance_id()
+        t.assert_ge(after[id].hits - before[id].hits, 50)
+    end
+end
+
+-- A relay that lags behind the rows in memory reads the files.
+g.test_misses = function(cg)
+    cg.replica1:stop()
+    cg.master:exec(function()
+        box.cfg{replication_feed_size = 1024}
+    end)
+    insert(cg, 1000)
+    cg.replica1:start()
+    check(cg, cg.replica1)
+    check(cg, cg.replica2)
+    local id = cg.replica1:instance_id()
+    t.assert_gt(feed_stat(cg)[id].misses, 0)
+    -- It's served from memory again once it has caught up.
+    local before = feed_stat(cg)[id].hits
+    insert(cg, 100)
+    check(cg, cg.replica1)
+    t.assert_gt(feed_stat(cg)[id].hits, before)
+    cg.master:exec(function()
+        box.cfg{replication_feed_size = 16 * 1024 * 1024}
+    end)
+end
+
+-- Relays don't read the WAL files, but still let GC remove them.
+g.test_gc = function(cg)
+    for _ = 1, 3 do
+        cg.master:exec(function()
+            box.snapshot()
+        end)
+        insert(cg, 100)
+    end
+    for _, replica in ipairs({cg.replica1, cg.replica2}) do
+        check(cg, replica)
+    end
+    cg.master:exec(function()
+        box.snapshot()
+    end)
+    insert(cg, 100)
+    for _, replica in ipairs({cg.replica1, cg.replica2}) do
+        check(cg, replica)
+    end
+    t.helpers.retrying({}, function()
+        cg.master:exec(function()
+            local t = require('luatest')
+            local fio = require('fio')
+            local files = fio.glob(fio.pathjoin(box.cfg.wal_dir, '*.xlog'))
+            t.assert_equals(#files, 1)
+        end)
+    end)
+end
+
+g.test_cfg = function(cg)
+    cg.master:exec(function()
+        local t = require('luatest')
+        t.assert_error_msg_content_equals(
+            "Incorrect value for option 'replication_feed_size': " ..
+            "the value must be greater than or equal to 0",
+            box.cfg, {replication_feed_size = -1})
+        box.cfg{replication_feed_size = 0}
+    end)
+    insert(cg, 10)
+    check(cg, cg.replica1)
+    -- Relays don't count misses while the feeds are disabled.
+    t.assert_equals(feed_stat(cg), {})
+    cg.master:exec(function()
+        box.cfg{replication_feed_size = 16 * 1024 * 1024}
+    end)
+end
@@ -0,0 +1,105 @@
+local t = require('luatest')
+local cluster = require('test.luatest_helpers.cluster')
+local server = require('test.luatest_helpers.server')
+
+local g = t.group()
+
+g.before_all(function(cg)
+    cg.cluster = cluster:new({})
+    cg.master = cg.cluster:build_server({alias = 'master'})
+    cg.replica = cg.cluster:build_server({
+        alias = 'replica',
+        box_cfg = {
+            replication = {server.build_instance_uri('master')},
+            replication_spaces = {1000},
+            replication_anon = true,
+            read_only = true,
+        },
+    })
+    cg.cluster:add_server(cg.master)
+    cg.cluster:add_server(cg.replica)
+    cg.cluster:start()
+    cg.master:exec(function()
+        box.schema.space.create('a', {id = 1000})
+        box.space.a:create_index('primary')
+        box.schema.space.create('b', {id = 1001})
+        box.space.b:create_index('primary')
+    end)
+end)
+
+g.after_all(function(cg)
+    cg.cluster:drop()
+end)
+
+local function insert(cg, from, to)
+    cg.master:exec(function(from, to)
+        for i = from, to do
+            box.begin()
+            box.space.a:insert({i})
+            box.space.b:insert({i})
+            box.commit()
+        end
+    end, {from, to})
+end
+
+local function count(cg)
+    return cg.replica:exec(function()
+        return {box.space.a:count(), box.space.b:count()}
+    end)
+end
+
+-- Rows of other spaces are relayed as NOPs, so the replica's
+-- vclock still catches up with the master's one.
+g.test_filter = function(cg)
+    insert(cg, 1, 100)
+    cg.replica:wait_vclock_of(cg.master)
+    t.assert_equals(count(cg), {100, 0})
+end
+
+-- Rows of the filtered out spaces were skipped, so the filter
+-- can't be widened without a rebootstrap.
+g.test_widen = function(cg)
+    cg.replica:exec(function()
+        local t = require('luatest')
+        local msg = "Incorrect value for option 'replication_spaces': " ..
+                    "can't replicate spaces that were filtered out, " ..
+                    "rebootstrap the replica"
+        t.assert_error_msg_content_equals(msg, box.cfg,
+                                          {replication_spaces = {}})
+        t.assert_error_msg_content_equals(msg, box.cfg,
+                                          {replication_spaces = {1000, 1001}})
+        t.assert_equals(box.cfg.replication_spaces, {1000})
+        local replication = box.cfg.replication
+        box.cfg{replication = {}}
+        box.cfg{replication = replication}
+    end)
+    insert(cg, 101, 200)
+    cg.replica:wait_vclock_of(cg.master)
+    t.assert_equals(count(cg), {200, 0})
+end
+
+g.test_cfg = function(cg)
+    cg.replica:exec(function()
+        local t = require('luatest')
+        local msg = "Incorrect value for option 'replication_spaces': " ..
+                    "must be a space id or an array of space ids"
+        t.assert_error_msg_content_equals(msg, box.cfg,
+                                          {replication_spaces = 0})
+        t.assert_error_msg_content_equals(msg, box.cfg,
+                                          {replication_spaces = {'a'}})
+        t.assert_error_msg_content_equals(msg, box.cfg,
+                                          {replication_spaces = {1.5}})
+        -- The filter is allowed only on anonymous replicas.
+        t.assert_error_msg_content_equals(
+            "Incorrect value for option 'replication_anon': the value " ..
+            "may be set to false only when replication_spaces is empty",
+            box.cfg, {replication_anon = false})
+    end)
+    cg.master:exec(function()
+        local t = require('luatest')
+        t.assert_error_msg_content_equals(
+            "Incorrect value for option 'replication_spaces': the value " ..
+            "may be set only when replication_anon is true",
+            box.cfg, {replication_spaces = {1000}})
+    end)
+end
@@ -0,0 +1,66 @@
+local t = require('luatest')
+local cluster = require('test.luatest_helpers.cluster')
+local server = require('test.luatest_helpers.server')
+
+local g = t.group()
+
+g.before_all(function(cg)
+    cg.cluster = cluster:new({})
+    cg.master = cg.cluster:build_server({alias = 'master'})
+    cg.replica = cg.cluster:build_server({
+        alias = 'replica',
+        box_cfg = {
+            replication = {server.build_instance_uri('master')},
+            read_only = true,
+        },
+    })
+    cg.cluster:add_server(cg.master)
+    cg.cluster:add_server(cg.replica)
+    cg.cluster:start()
+    cg.master:exec(function()
+        box.schema.space.create('test')
+        box.space.test:create_index('primary')
+    end)
+end)
+
+g.after_all(function(cg)
+    cg.cluster:drop()
+end)
+
+-- Inserts rows [from, to] 1 KB each.
+local function insert(cg, from, to)
+    cg.master:exec(function(from, to)
+        local s = box.space.test
+        local data = string.rep('x', 1024)
+        for i = from, to, 100 do
+            box.begin()
+            for j = i, math.min(i + 99, to) do
+                s:insert({j, data})
+            end
+            box.commit()
+        end
+    end, {from, to})
+end
+
+-- A replica reconnecting to the middle of a closed WAL file gets
+-- the rest of the file without the master reading it from the
+-- beginning.
+g.test_relay_skip = function(cg)
+    insert(cg, 1, 3000)
+    cg.replica:wait_vclock_of(cg.master)
+    cg.replica:stop()
+    insert(cg, 3001, 4000)
+    cg.master:exec(function()
+        local fio = require('fio')
+        local t = require('luatest')
+        box.snapshot()
+        local files = fio.glob(fio.pathjoin(box.cfg.wal_dir, '*.xlog.index'))
+        t.assert_equals(#files, 1)
+    end)
+    cg.replica:start()
+    cg.replica:wait_vclock_of(cg.master)
+    t.assert_equals(cg.replica:exec(function()
+        return box.space.test:count()
+    end), 4000)
+    t.assert(cg.master:grep_log("skipped %d+ bytes of .* using the index"))
+end